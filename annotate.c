@@ -0,0 +1,241 @@
+/**
+   @file annotate.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for executable that annotates saved games. Every move of every game
+   is scored with the alpha-beta engine and compared against the engine's best move, and missed
+   wins are flagged. Games are spread over worker threads, and results are written in the order
+   the files were given as soon as every earlier game is done.
+   Output is tab separated. Each game starts with a line "G <file> <moves> <winner>" (or
+   "E <file>" if the file cannot be read), followed by one line per move:
+   "<move number> <move> <score> <best move> <best score>" and a final "M" column when the move
+   missed a win. Scores are for the player making the move.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "error-codes.h"
+#include "game.h"
+#include "io.h"
+#include "position.h"
+#include "search.h"
+#include "mcts.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Default depth of the search for every move */
+#define DEFAULT_DEPTH 2
+/** Length of a formal coordinate including the null terminator */
+#define COORD_LENGTH 4
+
+/**
+   Work shared by all annotation threads. Fields are described as follows:
+   paths - saved game files to annotate.
+   count - number of files.
+   depth - search depth per move.
+   next - index of the next file a thread should take.
+   results - annotation text of each finished file, NULL until the file is done.
+   lengths - length of each result.
+   printed - number of files written to output so far.
+   moves - total number of moves annotated.
+   output - stream results are written to.
+   lock - guards results, printed, moves and output.
+*/
+typedef struct {
+    char** paths;
+    int count;
+    int depth;
+    int next;
+    char** results;
+    size_t* lengths;
+    int printed;
+    long moves;
+    FILE* output;
+    pthread_mutex_t lock;
+} batch;
+
+// Prototypes for static functions run by the annotation threads.
+static void* annotateWorker( void* arg );
+static size_t annotateGame( searcher* s, const char* path, int depth, char** text, long* moves );
+
+/**
+   Annotates every saved game named on the command line. Optional key arguments come first: "-d"
+   followed by the search depth per move, "-j" followed by the number of threads, and "-o"
+   followed by an output file (standard output otherwise). Throughput is reported on stderr.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status
+*/
+int main(int argc, char **argv)
+{
+    int depth = DEFAULT_DEPTH;
+    int threads = ( int )sysconf( _SC_NPROCESSORS_ONLN );
+    char *outputPath = NULL;
+
+    // Key arguments in pairs, then the saved games.
+    int first = 1;
+    while ( first < argc - 1 && argv[ first ][0] == '-' ) {
+        if ( strcmp( argv[ first ], "-d" ) == 0 && atoi( argv[ first + 1 ] ) > 0 &&
+             atoi( argv[ first + 1 ] ) <= SEARCH_MAX_DEPTH ) {
+            depth = atoi( argv[ first + 1 ] );
+        }
+        else if ( strcmp( argv[ first ], "-j" ) == 0 && atoi( argv[ first + 1 ] ) > 0 ) {
+            threads = atoi( argv[ first + 1 ] );
+        }
+        else if ( strcmp( argv[ first ], "-o" ) == 0 ) {
+            outputPath = argv[ first + 1 ];
+        }
+        else {
+            goto error;
+        }
+        first += 2;
+    }
+    if ( first >= argc ) {
+        goto error;
+    }
+
+    batch work;
+    work.paths = argv + first;
+    work.count = argc - first;
+    work.depth = depth;
+    work.next = 0;
+    work.results = ( char ** )calloc( work.count, sizeof( char * ) );
+    work.lengths = ( size_t * )calloc( work.count, sizeof( size_t ) );
+    work.printed = 0;
+    work.moves = 0;
+    work.output = outputPath == NULL ? stdout : fopen( outputPath, "w" );
+    if ( work.output == NULL ) {
+        exit( FILE_OUTPUT_ERR );
+    }
+    pthread_mutex_init( &work.lock, NULL );
+
+    // No point in more threads than games.
+    if ( threads > work.count ) {
+        threads = work.count;
+    }
+    long long start = mcts_now();
+    pthread_t *workers = ( pthread_t * )malloc( threads * sizeof( pthread_t ) );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_create( &workers[i], NULL, annotateWorker, &work );
+    }
+    annotateWorker( &work );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+    double seconds = ( mcts_now() - start ) / 1000.0;
+    free( workers );
+
+    pthread_mutex_destroy( &work.lock );
+    free( work.results );
+    free( work.lengths );
+    if ( work.output != stdout && fclose( work.output ) != 0 ) {
+        exit( FILE_OUTPUT_ERR );
+    }
+    fprintf( stderr, "%d games, %ld moves in %.2f s (%.1f games/s)\n", work.count, work.moves,
+             seconds, seconds > 0 ? work.count / seconds : 0.0 );
+    return SUCCESS;
+
+    error:
+    printf( "usage: ./annotate [-d <depth>] [-j <threads>] [-o <output-file>]\n" );
+    printf( "       <saved-match.gmk>...\n" );
+    exit( ARGUMENT_ERR );
+}
+
+/**
+   Thread entry point. Takes files one at a time until none are left, and writes out every result
+   whose earlier files are all written.
+   @param arg is pointer to shared batch.
+   @return is always NULL.
+*/
+static void* annotateWorker( void* arg )
+{
+    batch *work = ( batch * )arg;
+    searcher *s = search_create( ORDER_FULL );
+
+    int index;
+    while ( ( index = __atomic_fetch_add( &work->next, 1, __ATOMIC_RELAXED ) ) < work->count ) {
+        char *text;
+        long moves = 0;
+        size_t length = annotateGame( s, work->paths[ index ], work->depth, &text, &moves );
+
+        pthread_mutex_lock( &work->lock );
+        work->results[ index ] = text;
+        work->lengths[ index ] = length;
+        work->moves += moves;
+        while ( work->printed < work->count && work->results[ work->printed ] != NULL ) {
+            fwrite( work->results[ work->printed ], 1, work->lengths[ work->printed ],
+                    work->output );
+            free( work->results[ work->printed ] );
+            work->printed++;
+        }
+        pthread_mutex_unlock( &work->lock );
+    }
+
+    search_delete( s );
+    return NULL;
+}
+
+/**
+   Annotates one saved game. Each move is compared against a search of the position before it.
+   The played move is only searched on its own (one ply less, from the opponent's side) when it
+   differs from the best move.
+   @param s is pointer to this thread's searcher.
+   @param path is string for file path location.
+   @param depth is search depth per move.
+   @param text stores the dynamically allocated annotation text, which the caller frees.
+   @param moves is pointer to number of moves annotated, increased by this game's moves.
+   @return is length of text.
+*/
+static size_t annotateGame( searcher* s, const char* path, int depth, char** text, long* moves )
+{
+    size_t length;
+    FILE *stream = open_memstream( text, &length );
+
+    unsigned char status;
+    game *g = game_load( path, false, &status );
+    if ( g == NULL ) {
+        fprintf( stream, "E\t%s\n", path );
+        fclose( stream );
+        return length;
+    }
+    fprintf( stream, "G\t%s\t%zu\t%d\n", path, g->moves_count, g->winner );
+
+    position p;
+    position_init( &p, g->board->size, g->type );
+    for ( size_t i = 0; i < g->moves_count && p.winner == EMPTY_INTERSECTION; i++ ) {
+        unsigned short played = POSITION_INDEX( g->moves[i].x, g->moves[i].y );
+        unsigned short best = search_run( s, &p, depth, 0 );
+        int bestScore = s->score;
+
+        // Score the played move, reusing the best move's score when they are the same.
+        int score = bestScore;
+        unsigned char mover = p.stone;
+        position_play( &p, played );
+        if ( played != best ) {
+            if ( p.winner != EMPTY_INTERSECTION ) {
+                score = p.winner == mover ? EVAL_WIN : -EVAL_WIN;
+            }
+            else if ( position_is_full( &p ) ) {
+                score = 0;
+            }
+            else {
+                search_run( s, &p, depth > 1 ? depth - 1 : 1, 0 );
+                score = -s->score;
+            }
+        }
+
+        char playedCoord[ COORD_LENGTH ];
+        char bestCoord[ COORD_LENGTH ];
+        board_formal_coord( g->board, g->moves[i].x, g->moves[i].y, playedCoord );
+        board_formal_coord( g->board, POSITION_X( best ), POSITION_Y( best ), bestCoord );
+        bool missedWin = bestScore >= SEARCH_WIN_THRESHOLD && score < SEARCH_WIN_THRESHOLD;
+        fprintf( stream, "%zu\t%s\t%d\t%s\t%d%s\n", i + 1, playedCoord, score, bestCoord,
+                 bestScore, missedWin ? "\tM" : "" );
+        ( *moves )++;
+    }
+
+    game_delete( g );
+    fclose( stream );
+    return length;
+}
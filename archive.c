@@ -0,0 +1,487 @@
+/**
+   @file archive.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for executable that manages game databases. Saved games are added to
+   a database, and games in it are listed, shown or saved back to their own file. Games from RIF
+   and PSQ archives are imported into a database, and a database is packed into a compressed
+   archive for storage or transfer and unpacked again. A position index can be built over a
+   database to find every game that reached a position.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "error-codes.h"
+#include "board.h"
+#include "game.h"
+#include "io.h"
+#include "gamedb.h"
+#include "posindex.h"
+#include "importer.h"
+#include "gamepack.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Fewest command line arguments of any command */
+#define MIN_ARGUMENTS 3
+/** Longest formal coordinate including the null terminator */
+#define MAX_COORD_LENGTH 4
+/** Option that marks PSQ games as Renju games */
+#define RENJU_OPTION "-r"
+/** Slot of the result counts for games that did not finish, after the three winner slots */
+#define UNFINISHED_RESULTS 3
+
+// Prototypes for static functions, one per command.
+static int addGames( const char* path, int count, char** files );
+static int importGames( const char* path, int count, char** archives );
+static int packGames( const char* path, const char* file );
+static int unpackGames( const char* file, const char* path );
+static int listGames( const char* path );
+static int showGame( const char* path, const char* id );
+static int getGame( const char* path, const char* id, const char* file );
+static int indexGames( const char* path, const char* plies );
+static int findGames( const char* path, int count, char** moves );
+static void printMatches( const gamedb* db, const posindex* x, const position* p,
+                          size_t* results );
+static gamedb* openDatabase( const char* path, const char* id, size_t* number );
+
+/**
+   Runs one database command: "add" followed by the database and saved games, "import" followed
+   by the database, optionally RENJU_OPTION, and RIF or PSQ archives, "pack" followed by the
+   database and a packed archive to create, "unpack" followed by a packed archive and the
+   database to add its games to, "list" followed by the database, "show" followed by the
+   database and a game number, "get" followed by the database, a game number and a path to save
+   the game to, "index" followed by the database and optionally the number of moves per game to
+   index, or "find" followed by the database and the moves of a position in formal coordinates.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status
+*/
+int main(int argc, char **argv)
+{
+    if ( argc < MIN_ARGUMENTS ) {
+        goto error;
+    }
+    if ( strcmp( argv[1], "add" ) == 0 && argc > MIN_ARGUMENTS ) {
+        return addGames( argv[2], argc - MIN_ARGUMENTS, argv + MIN_ARGUMENTS );
+    }
+    if ( strcmp( argv[1], "import" ) == 0 && argc > MIN_ARGUMENTS ) {
+        return importGames( argv[2], argc - MIN_ARGUMENTS, argv + MIN_ARGUMENTS );
+    }
+    if ( strcmp( argv[1], "pack" ) == 0 && argc == MIN_ARGUMENTS + 1 ) {
+        return packGames( argv[2], argv[3] );
+    }
+    if ( strcmp( argv[1], "unpack" ) == 0 && argc == MIN_ARGUMENTS + 1 ) {
+        return unpackGames( argv[2], argv[3] );
+    }
+    if ( strcmp( argv[1], "list" ) == 0 && argc == MIN_ARGUMENTS ) {
+        return listGames( argv[2] );
+    }
+    if ( strcmp( argv[1], "show" ) == 0 && argc == MIN_ARGUMENTS + 1 ) {
+        return showGame( argv[2], argv[3] );
+    }
+    if ( strcmp( argv[1], "get" ) == 0 && argc == MIN_ARGUMENTS + 2 ) {
+        return getGame( argv[2], argv[3], argv[4] );
+    }
+    if ( strcmp( argv[1], "index" ) == 0 && argc <= MIN_ARGUMENTS + 1 ) {
+        return indexGames( argv[2], argc > MIN_ARGUMENTS ? argv[3] : NULL );
+    }
+    if ( strcmp( argv[1], "find" ) == 0 && argc > MIN_ARGUMENTS ) {
+        return findGames( argv[2], argc - MIN_ARGUMENTS, argv + MIN_ARGUMENTS );
+    }
+
+    error:
+    printf( "usage: ./archive add <database> <saved-match.gmk>...\n" );
+    printf( "       ./archive import <database> [-r] <archive.rif|archive.psq>...\n" );
+    printf( "       ./archive pack <database> <archive.gpk>\n" );
+    printf( "       ./archive unpack <archive.gpk> <database>\n" );
+    printf( "       ./archive list <database>\n" );
+    printf( "       ./archive show <database> <game>\n" );
+    printf( "       ./archive get <database> <game> <saved-match.gmk>\n" );
+    printf( "       ./archive index <database> [<plies>]\n" );
+    printf( "       ./archive find <database> <move>...\n" );
+    exit( ARGUMENT_ERR );
+}
+
+/**
+   Adds saved games to the end of a database, creating it if needed. Files that are not saved
+   games are reported and skipped.
+   @param path is string for database path location.
+   @param count is number of saved games.
+   @param files is array of saved game paths.
+   @return is exit status
+*/
+static int addGames( const char* path, int count, char** files )
+{
+    gamedb_writer *w = gamedb_writer_open( path );
+    if ( w == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    int added = 0;
+    for ( int i = 0; i < count; i++ ) {
+        unsigned char status;
+        game *g = game_load( files[i], false, &status );
+        if ( g == NULL ) {
+            fprintf( stderr, "skipped %s\n", files[i] );
+            continue;
+        }
+        status = gamedb_writer_add( w, g );
+        game_delete( g );
+        if ( status != SUCCESS ) {
+            exit( status );
+        }
+        added++;
+    }
+    unsigned char status = gamedb_writer_close( w );
+    if ( status != SUCCESS ) {
+        exit( status );
+    }
+    printf( "added %d games\n", added );
+    return SUCCESS;
+}
+
+/**
+   Adds every game of RIF and PSQ archives to the end of a database, creating it if needed. PSQ
+   games are freestyle games, or Renju games if the archives follow RENJU_OPTION. Archives that
+   can't be read and games that break the rules are reported and skipped.
+   @param path is string for database path location.
+   @param count is number of archives, including any RENJU_OPTION.
+   @param archives is array of archive paths, optionally starting with RENJU_OPTION.
+   @return is exit status
+*/
+static int importGames( const char* path, int count, char** archives )
+{
+    unsigned char type = GAME_FREESTYLE;
+    if ( strcmp( archives[0], RENJU_OPTION ) == 0 ) {
+        type = GAME_RENJU;
+        archives++;
+        count--;
+    }
+    gamedb_writer *w = gamedb_writer_open( path );
+    if ( w == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    size_t added = 0;
+    size_t skipped = 0;
+    for ( int i = 0; i < count; i++ ) {
+        importer *im = importer_open( archives[i], type );
+        if ( im == NULL ) {
+            fprintf( stderr, "skipped %s\n", archives[i] );
+            continue;
+        }
+        game *g;
+        unsigned char status;
+        while ( importer_next( im, &g, &status ) ) {
+            if ( g == NULL ) {
+                fprintf( stderr, "skipped %s game %zu\n", archives[i], im->games );
+                skipped++;
+                continue;
+            }
+            status = gamedb_writer_add( w, g );
+            game_delete( g );
+            if ( status != SUCCESS ) {
+                exit( status );
+            }
+            added++;
+        }
+        if ( status != SUCCESS ) {
+            fprintf( stderr, "could not finish reading %s\n", archives[i] );
+        }
+        importer_close( im );
+    }
+    unsigned char status = gamedb_writer_close( w );
+    if ( status != SUCCESS ) {
+        exit( status );
+    }
+    printf( "imported %zu games, skipped %zu\n", added, skipped );
+    return SUCCESS;
+}
+
+/**
+   Compresses every game of a database into a new packed archive. Games that are damaged in the
+   database are reported and skipped.
+   @param path is string for database path location.
+   @param file is string for packed archive path location.
+   @return is exit status
+*/
+static int packGames( const char* path, const char* file )
+{
+    gamedb *db = gamedb_open( path );
+    if ( db == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    gamepack *p = gamepack_create( file );
+    if ( p == NULL ) {
+        exit( FILE_OUTPUT_ERR );
+    }
+    for ( size_t i = 0; i < db->count; i++ ) {
+        unsigned char status;
+        game *g = gamedb_game( db, i, &status );
+        if ( g == NULL ) {
+            fprintf( stderr, "skipped game %zu\n", i );
+            continue;
+        }
+        status = gamepack_add( p, g );
+        game_delete( g );
+        if ( status == FILE_OUTPUT_ERR ) {
+            exit( status );
+        }
+        if ( status != SUCCESS ) {
+            fprintf( stderr, "skipped game %zu\n", i );
+        }
+    }
+    size_t packed = p->games;
+    unsigned char status = gamepack_close( p );
+    if ( status != SUCCESS ) {
+        exit( status );
+    }
+    printf( "packed %zu games\n", packed );
+    gamedb_close( db );
+    return SUCCESS;
+}
+
+/**
+   Adds every game of a packed archive to the end of a database, creating it if needed. A damaged
+   archive is an error once the games before the damage have been added.
+   @param file is string for packed archive path location.
+   @param path is string for database path location.
+   @return is exit status
+*/
+static int unpackGames( const char* file, const char* path )
+{
+    gamepack *p = gamepack_open( file );
+    if ( p == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    gamedb_writer *w = gamedb_writer_open( path );
+    if ( w == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    game *g;
+    unsigned char status;
+    while ( gamepack_next( p, &g, &status ) ) {
+        status = gamedb_writer_add( w, g );
+        game_delete( g );
+        if ( status != SUCCESS ) {
+            exit( status );
+        }
+    }
+    unsigned char closed = gamedb_writer_close( w );
+    size_t unpacked = p->games;
+    gamepack_close( p );
+    if ( status != SUCCESS || closed != SUCCESS ) {
+        exit( status != SUCCESS ? status : closed );
+    }
+    printf( "unpacked %zu games\n", unpacked );
+    return SUCCESS;
+}
+
+/**
+   Prints one tab separated line per game from the index alone: number, board size, type, state,
+   winner and number of moves.
+   @param path is string for database path location.
+   @return is exit status
+*/
+static int listGames( const char* path )
+{
+    gamedb *db = gamedb_open( path );
+    if ( db == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    for ( size_t i = 0; i < db->count; i++ ) {
+        const gamedb_entry *entry = &db->entries[i];
+        printf( "%zu\t%d\t%d\t%d\t%d\t%d\n", i, entry->size, entry->type, entry->state,
+                entry->winner, entry->moves );
+    }
+    gamedb_close( db );
+    return SUCCESS;
+}
+
+/**
+   Prints the moves of one game in formal coordinates, read in place from the database.
+   @param path is string for database path location.
+   @param id is string holding the game number.
+   @return is exit status
+*/
+static int showGame( const char* path, const char* id )
+{
+    size_t number;
+    gamedb *db = openDatabase( path, id, &number );
+    const gamedb_entry *entry = &db->entries[ number ];
+
+    // Coordinates are converted with a board of the game's size.
+    board *b = board_create( entry->size );
+    for ( size_t i = 0; i < entry->moves; i++ ) {
+        unsigned short index = gamedb_move( db, number, i );
+        char formal_coord[ MAX_COORD_LENGTH ];
+        board_formal_coord( b, index % entry->size, index / entry->size, formal_coord );
+        printf( "%s%c", formal_coord, i + 1 < entry->moves ? ' ' : '\n' );
+    }
+    board_delete( b );
+    gamedb_close( db );
+    return SUCCESS;
+}
+
+/**
+   Saves one game of a database to its own file.
+   @param path is string for database path location.
+   @param id is string holding the game number.
+   @param file is string for file location to save the game to.
+   @return is exit status
+*/
+static int getGame( const char* path, const char* id, const char* file )
+{
+    size_t number;
+    gamedb *db = openDatabase( path, id, &number );
+    unsigned char status;
+    game *g = gamedb_game( db, number, &status );
+    gamedb_close( db );
+    if ( g == NULL ) {
+        exit( status );
+    }
+    game_export( g, file );
+    game_delete( g );
+    return SUCCESS;
+}
+
+/**
+   Builds the position index of a database on all cores, next to the database.
+   @param path is string for database path location.
+   @param plies is string holding the number of moves per game to index, NULL for every move.
+   @return is exit status
+*/
+static int indexGames( const char* path, const char* plies )
+{
+    int maxPlies = plies != NULL ? atoi( plies ) : 0;
+    if ( plies != NULL && maxPlies <= 0 ) {
+        exit( ARGUMENT_ERR );
+    }
+    gamedb *db = gamedb_open( path );
+    if ( db == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    char index[ strlen( path ) + strlen( POSINDEX_EXTENSION ) + 1 ];
+    strcpy( index, path );
+    strcat( index, POSINDEX_EXTENSION );
+    unsigned char status = posindex_build( db, index, maxPlies,
+                                           ( int )sysconf( _SC_NPROCESSORS_ONLN ) );
+    if ( status != SUCCESS ) {
+        exit( status );
+    }
+    printf( "indexed %zu games\n", db->count );
+    gamedb_close( db );
+    return SUCCESS;
+}
+
+/**
+   Prints every game that reached the position after the given moves, on any board size and in
+   any orientation, then a line with how those games ended.
+   @param path is string for database path location.
+   @param count is number of moves.
+   @param moves is array of moves in formal coordinates.
+   @return is exit status
+*/
+static int findGames( const char* path, int count, char** moves )
+{
+    gamedb *db = gamedb_open( path );
+    if ( db == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    char index[ strlen( path ) + strlen( POSINDEX_EXTENSION ) + 1 ];
+    strcpy( index, path );
+    strcat( index, POSINDEX_EXTENSION );
+    posindex *x = posindex_open( index );
+    if ( x == NULL || x->games > db->count ) {
+        exit( FILE_INPUT_ERR );
+    }
+    if ( x->games < db->count ) {
+        fprintf( stderr, "index covers %zu of %zu games\n", x->games, db->count );
+    }
+
+    // Keys depend on board size and game type, so the position is looked up in each.
+    const unsigned char sizes[] = { BOARD_SIZE_15, BOARD_SIZE_17, BOARD_SIZE_19 };
+    const unsigned char types[] = { GAME_FREESTYLE, GAME_RENJU };
+    size_t results[ UNFINISHED_RESULTS + 1 ] = { 0 };
+    bool valid = false;
+    for ( size_t s = 0; s < sizeof( sizes ); s++ ) {
+        board *b = board_create( sizes[s] );
+        for ( size_t t = 0; t < sizeof( types ); t++ ) {
+            position p;
+            position_init( &p, sizes[s], types[t] );
+            bool legal = true;
+            for ( int i = 0; i < count && legal; i++ ) {
+                unsigned char column;
+                unsigned char row;
+                legal = board_coord( b, moves[i], &column, &row ) == SUCCESS &&
+                        p.cells[ POSITION_INDEX( column, row ) ] == EMPTY_INTERSECTION;
+                if ( legal ) {
+                    position_play( &p, POSITION_INDEX( column, row ) );
+                }
+            }
+            if ( legal ) {
+                printMatches( db, x, &p, results );
+                valid = true;
+            }
+        }
+        board_delete( b );
+    }
+    if ( !valid ) {
+        exit( ARGUMENT_ERR );
+    }
+    printf( "games %zu: black %zu, white %zu, draws %zu, unfinished %zu\n",
+            results[ BLACK_STONE ] + results[ WHITE_STONE ] + results[ EMPTY_INTERSECTION ] +
+            results[ UNFINISHED_RESULTS ], results[ BLACK_STONE ], results[ WHITE_STONE ],
+            results[ EMPTY_INTERSECTION ], results[ UNFINISHED_RESULTS ] );
+    posindex_close( x );
+    gamedb_close( db );
+    return SUCCESS;
+}
+
+/**
+   Prints one tab separated line per game that reached a position: game number, the move the
+   position was reached at, board size, type, winner and number of moves. Results are counted
+   by winner, with games that did not finish counted separately.
+   @param db is pointer to database.
+   @param x is pointer to the database's position index.
+   @param p is pointer to position.
+   @param results is array of counts, by winner stone, then unfinished games.
+*/
+static void printMatches( const gamedb* db, const posindex* x, const position* p,
+                          size_t* results )
+{
+    const posindex_entry *first;
+    size_t matches = posindex_find( x, p, &first );
+    for ( size_t i = 0; i < matches; i++ ) {
+        const gamedb_entry *entry = &db->entries[ first[i].game ];
+        printf( "%u\t%d\t%d\t%d\t%d\t%d\n", first[i].game, first[i].ply, entry->size,
+                entry->type, entry->winner, entry->moves );
+        if ( entry->state == GAME_STATE_FINISHED ) {
+            results[ entry->winner ]++;
+        }
+        else {
+            results[ UNFINISHED_RESULTS ]++;
+        }
+    }
+}
+
+/**
+   Opens a database and reads a game number for it. Exits with error if the database can't be
+   opened or has no game with that number.
+   @param path is string for database path location.
+   @param id is string holding the game number.
+   @param number stores the game number.
+   @return is pointer to database.
+*/
+static gamedb* openDatabase( const char* path, const char* id, size_t* number )
+{
+    gamedb *db = gamedb_open( path );
+    if ( db == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    char *end;
+    *number = strtoul( id, &end, 10 );
+    if ( *id == '\0' || *end != '\0' || *number >= db->count ) {
+        exit( ARGUMENT_ERR );
+    }
+    return db;
+}
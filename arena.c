@@ -0,0 +1,243 @@
+/**
+   @file arena.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for executable that plays engine-versus-engine games. Games run in
+   parallel on a pool of threads, each with its own pair of single threaded players, until the
+   requested number of games is done. Players swap colours every game, and each opening of the
+   suite is played once with each colour.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "error-codes.h"
+#include "game.h"
+#include "io.h"
+#include "gamedb.h"
+#include "selfplay.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Default number of games */
+#define DEFAULT_GAMES 100
+/** Games between progress reports */
+#define PROGRESS_INTERVAL 100
+/** Longest path of an exported game */
+#define MAX_PATH_LENGTH 4096
+
+/**
+   Work and results shared by all game threads. Fields are described as follows:
+   players - descriptions of player 1 and player 2.
+   size - board size.
+   type - game type. (GAME_FREESTYLE or GAME_RENJU)
+   openings - opening suite, NULL to start from an empty board.
+   opening_count - number of openings.
+   directory - directory games are exported to, NULL to not export.
+   database - database games are added to, NULL to not add them.
+   games - number of games to play.
+   next - number of the next game a thread should take.
+   finished - number of games done.
+   wins - games won by player 1 and player 2.
+   draws - drawn games.
+   stopped - games that ended without a result.
+   black_wins - games won by black.
+   start - time the first game started, from mcts_now().
+   lock - guards the results.
+*/
+typedef struct {
+    player_spec players[2];
+    unsigned char size;
+    unsigned char type;
+    const opening* openings;
+    int opening_count;
+    const char* directory;
+    gamedb_writer* database;
+    int games;
+    int next;
+    int finished;
+    int wins[2];
+    int draws;
+    int stopped;
+    int black_wins;
+    long long start;
+    pthread_mutex_t lock;
+} arena;
+
+// Prototypes for static functions run by the game threads.
+static void* arenaWorker( void* arg );
+static void printResults( const arena* a, FILE* stream );
+
+/**
+   Plays games between the two players named last on the command line. Optional key arguments
+   come first: "-b" followed by the board size 15/17/19, "-t" followed by "freestyle" or "renju",
+   "-g" followed by the number of games, "-j" followed by the number of threads, "-p" followed by
+   an opening suite, "-o" followed by a directory to export every game to and "-d" followed by a
+   game database to add every game to.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status
+*/
+int main(int argc, char **argv)
+{
+    arena a;
+    memset( &a, 0, sizeof( arena ) );
+    a.size = BOARD_SIZE_15;
+    a.type = GAME_FREESTYLE;
+    a.games = DEFAULT_GAMES;
+    int threads = ( int )sysconf( _SC_NPROCESSORS_ONLN );
+    const char *openingsPath = NULL;
+
+    // Key arguments in pairs, then the two players.
+    int first = 1;
+    while ( first < argc - 2 && argv[ first ][0] == '-' ) {
+        char *value = argv[ first + 1 ];
+        if ( strcmp( argv[ first ], "-b" ) == 0 ) {
+            a.size = atoi( value );
+            if ( a.size != BOARD_SIZE_15 && a.size != BOARD_SIZE_17 && a.size != BOARD_SIZE_19 ) {
+                exit( BOARD_SIZE_ERR );
+            }
+        }
+        else if ( strcmp( argv[ first ], "-t" ) == 0 && strcmp( value, "freestyle" ) == 0 ) {
+            a.type = GAME_FREESTYLE;
+        }
+        else if ( strcmp( argv[ first ], "-t" ) == 0 && strcmp( value, "renju" ) == 0 ) {
+            a.type = GAME_RENJU;
+        }
+        else if ( strcmp( argv[ first ], "-g" ) == 0 && atoi( value ) > 0 ) {
+            a.games = atoi( value );
+        }
+        else if ( strcmp( argv[ first ], "-j" ) == 0 && atoi( value ) > 0 ) {
+            threads = atoi( value );
+        }
+        else if ( strcmp( argv[ first ], "-p" ) == 0 ) {
+            openingsPath = value;
+        }
+        else if ( strcmp( argv[ first ], "-o" ) == 0 ) {
+            a.directory = value;
+        }
+        else if ( strcmp( argv[ first ], "-d" ) == 0 && a.database == NULL ) {
+            a.database = gamedb_writer_open( value );
+            if ( a.database == NULL ) {
+                exit( FILE_INPUT_ERR );
+            }
+        }
+        else {
+            goto error;
+        }
+        first += 2;
+    }
+    if ( first != argc - 2 || !selfplay_parse_player( argv[ first ], &a.players[0] ) ||
+         !selfplay_parse_player( argv[ first + 1 ], &a.players[1] ) ) {
+        goto error;
+    }
+
+    opening *openings = NULL;
+    if ( openingsPath != NULL ) {
+        openings = selfplay_read_openings( openingsPath, a.size, &a.opening_count );
+        a.openings = openings;
+    }
+    pthread_mutex_init( &a.lock, NULL );
+
+    // No point in more threads than games.
+    if ( threads > a.games ) {
+        threads = a.games;
+    }
+    a.start = mcts_now();
+    pthread_t *workers = ( pthread_t * )malloc( threads * sizeof( pthread_t ) );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_create( &workers[i], NULL, arenaWorker, &a );
+    }
+    arenaWorker( &a );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+    free( workers );
+
+    printResults( &a, stdout );
+    pthread_mutex_destroy( &a.lock );
+    if ( a.database != NULL && gamedb_writer_close( a.database ) != SUCCESS ) {
+        exit( FILE_OUTPUT_ERR );
+    }
+    free( openings );
+    return SUCCESS;
+
+    error:
+    printf( "usage: ./arena [-b <15|17|19>] [-t <freestyle|renju>] [-g <games>] [-j <threads>]\n" );
+    printf( "       [-p <openings>] [-o <directory>] [-d <database>] <player1> <player2>\n" );
+    printf( "       players are mcts:<playouts>, mcts:<millis>ms, ab:<depth>,\n" );
+    printf( "       ab:<depth>:<ordering> or ext:<millis>:<program>\n" );
+    exit( ARGUMENT_ERR );
+}
+
+/**
+   Thread entry point. Plays games until all of them are taken. Player 1 is black in even
+   numbered games, and consecutive pairs of games share an opening.
+   @param arg is pointer to shared arena.
+   @return is always NULL.
+*/
+static void* arenaWorker( void* arg )
+{
+    arena *a = ( arena * )arg;
+    player *players[2] = { selfplay_create_player( &a->players[0] ),
+                           selfplay_create_player( &a->players[1] ) };
+
+    int number;
+    while ( ( number = __atomic_fetch_add( &a->next, 1, __ATOMIC_RELAXED ) ) < a->games ) {
+        int blackPlayer = number % 2;
+        const opening *start = NULL;
+        if ( a->openings != NULL ) {
+            start = &a->openings[ ( number / 2 ) % a->opening_count ];
+        }
+        game *g = selfplay_play( players[ blackPlayer ], players[ 1 - blackPlayer ], a->size,
+                                 a->type, start );
+
+        if ( a->directory != NULL ) {
+            char path[ MAX_PATH_LENGTH ];
+            snprintf( path, sizeof( path ), "%s/game-%06d.gmk", a->directory, number );
+            game_export( g, path );
+        }
+
+        // Record the result from the players' point of view, and the game itself.
+        pthread_mutex_lock( &a->lock );
+        if ( a->database != NULL && gamedb_writer_add( a->database, g ) != SUCCESS ) {
+            exit( FILE_OUTPUT_ERR );
+        }
+        if ( g->state == GAME_STATE_STOPPED ) {
+            a->stopped++;
+        }
+        else if ( g->winner == EMPTY_INTERSECTION ) {
+            a->draws++;
+        }
+        else {
+            int winner = g->winner == BLACK_STONE ? blackPlayer : 1 - blackPlayer;
+            a->wins[ winner ]++;
+            a->black_wins += g->winner == BLACK_STONE;
+        }
+        if ( ++a->finished % PROGRESS_INTERVAL == 0 && a->finished < a->games ) {
+            printResults( a, stderr );
+        }
+        pthread_mutex_unlock( &a->lock );
+        game_delete( g );
+    }
+
+    selfplay_delete_player( players[0] );
+    selfplay_delete_player( players[1] );
+    return NULL;
+}
+
+/**
+   Prints games played, games per second and the result rates.
+   @param a is pointer to arena.
+   @param stream is stream to print to.
+*/
+static void printResults( const arena* a, FILE* stream )
+{
+    double seconds = ( mcts_now() - a->start ) / 1000.0;
+    int scored = a->finished - a->stopped;
+    double percent = scored > 0 ? 100.0 / scored : 0.0;
+    fprintf( stream, "games %d (%.2f games/s): player1 %.1f%%, player2 %.1f%%, draws %.1f%%, "
+             "black %.1f%%, stopped %d\n", a->finished, seconds > 0 ? a->finished / seconds : 0.0,
+             a->wins[0] * percent, a->wins[1] * percent, a->draws * percent,
+             a->black_wins * percent, a->stopped );
+}
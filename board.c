@@ -8,15 +8,44 @@
 
 #include "board.h"
 #include "error-codes.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h> 
+#include <unistd.h>
 
 /** Smallest 2 digit number possible */
 #define LOWEST_TWO_DIGITS 10
 /** Longest string length allowed (not including null terminator */
 #define MAX_STRING_LENGTH 3
 
+/** Width in columns of the row number and the space after it */
+#define ROW_LABEL_WIDTH 3
+/** Longest update of one intersection: cursor movement to it and its glyph */
+#define CELL_UPDATE_MAX ( sizeof( "\033[19;39H" ) - 1 + 3 )
+/** Longest movement to the line below the board plus the clear of the rest of the display */
+#define STATUS_UPDATE_MAX sizeof( "\033[21;1H\033[J" )
+
+/** Glyph of every intersection state: empty, black stone, white stone, in UTF-8 */
+static const char GLYPHS[][ 4 ] = { "+", "\u25CF", "\u25CB" };
+/** Length in bytes of every glyph */
+static const unsigned char GLYPH_LENGTHS[] = { 1, 3, 3 };
+
+/** Column of every character used as a coordinate letter, plus one. 0 for other characters. */
+static const unsigned char COLUMNS[ 256 ] = {
+    [ 'A' ] = 1, [ 'B' ] = 2, [ 'C' ] = 3, [ 'D' ] = 4, [ 'E' ] = 5, [ 'F' ] = 6, [ 'G' ] = 7,
+    [ 'H' ] = 8, [ 'I' ] = 9, [ 'J' ] = 10, [ 'K' ] = 11, [ 'L' ] = 12, [ 'M' ] = 13,
+    [ 'N' ] = 14, [ 'O' ] = 15, [ 'P' ] = 16, [ 'Q' ] = 17, [ 'R' ] = 18, [ 'S' ] = 19
+};
+/** Value of every digit character, plus one. 0 for other characters. */
+static const unsigned char DIGITS[ 256 ] = {
+    [ '0' ] = 1, [ '1' ] = 2, [ '2' ] = 3, [ '3' ] = 4, [ '4' ] = 5, [ '5' ] = 6, [ '6' ] = 7,
+    [ '7' ] = 8, [ '8' ] = 9, [ '9' ] = 10
+};
+
+// Prototypes for static functions.
+static void writeFrame( const char* frame, size_t length );
+
 // Create a board struct and return pointer to it.
 board* board_create(unsigned char size)
 {
@@ -56,46 +85,106 @@ void board_delete( board* b)
     free( b );
 }
 
+// Empties a board for reuse at a new size.
+void board_reset( board* b, unsigned char size)
+{
+    if ( size != BOARD_SIZE_15 && size != BOARD_SIZE_17 && size != BOARD_SIZE_19 ) { 
+        exit( BOARD_SIZE_ERR );
+    }
+    b->size = size;
+    memset( b->grid, EMPTY_INTERSECTION, size * size );
+}
+
 // Prints the board.
 void board_print( board* b, bool in_place)
 {
+    char frame[ BOARD_FRAME_MAX ];
+    writeFrame( frame, board_render( b, in_place, frame ) );
+}
+
+// Renders the board into a buffer.
+size_t board_render( board* b, bool in_place, char* frame)
+{
+    char *next = frame;
+    
     // Clear terminal if in_place is true
     if ( in_place ) {
-        clear();
+        memcpy( next, BOARD_CLEAR_SEQUENCE, strlen( BOARD_CLEAR_SEQUENCE ) );
+        next += strlen( BOARD_CLEAR_SEQUENCE );
     }
     
     // Cast grid pointer to a 2D array.
     unsigned char (*grid)[b->size] = ( unsigned char (*)[b->size] ) b->grid; 
     
-    // Print board 
+    // Render board 
     for ( int i = 0; i < b->size; i++ ) {
-        printf( "%2d ", b->size - i );    // print row number
-        // Go through row and print out grid values
+        // Row number, right aligned in 2 characters.
+        int row = b->size - i;
+        *next++ = row < LOWEST_TWO_DIGITS ? ' ' : '0' + row / LOWEST_TWO_DIGITS;
+        *next++ = '0' + row % LOWEST_TWO_DIGITS;
+        *next++ = ' ';
+        // Go through row and copy in grid glyphs, with a dash between columns.
         for ( int j = 0; j < b->size; j++ ) {
-            if ( grid[i][j] == EMPTY_INTERSECTION ) {
-                printf( "+" );
-            }
-            else if ( grid[i][j] == BLACK_STONE ) {
-                printf( "\u25CF" );
-            }
-            else {  // WHITE_STONE
-                printf( "\u25CB" );
+            memcpy( next, GLYPHS[ grid[i][j] ], GLYPH_LENGTHS[ grid[i][j] ] );
+            next += GLYPH_LENGTHS[ grid[i][j] ];
+            *next++ = j < b->size - 1 ? '-' : '\n';
+        }
+    }
+    // Letters for columns
+    *next++ = ' ';
+    *next++ = ' ';
+    *next++ = ' ';
+    for ( int j = 0; j < b->size; j++ ) {
+        *next++ = 'A' + j;
+        *next++ = j < b->size - 1 ? ' ' : '\n';
+    }
+    return next - frame;
+}
+
+// Forget what the terminal shows.
+void board_view_reset( board_view* v)
+{
+    v->drawn = false;
+}
+
+// Renders the changes since the last frame.
+size_t board_render_changes( board_view* v, board* b, char* frame)
+{
+    // Whole frame the first time, or when the board on screen is a different board.
+    if ( v->drawn && v->size == b->size ) {
+        char *next = frame;
+        for ( int i = 0; i < b->size * b->size; i++ ) {
+            if ( v->grid[i] == b->grid[i] ) {
+                continue;
             }
-            // Don't print dash if at last column
-            if ( j < b->size - 1 ) {
-                printf( "-" );
+            // Whole frame is shorter once most intersections changed.
+            if ( next - frame + CELL_UPDATE_MAX + STATUS_UPDATE_MAX > BOARD_FRAME_MAX ) {
+                next = NULL;
+                break;
             }
+            // Row i is line i + 1 and column j starts after the label and j glyph-dash pairs.
+            next += sprintf( next, "\033[%d;%dH", i / b->size + 1,
+                             ROW_LABEL_WIDTH + 2 * ( i % b->size ) + 1 );
+            memcpy( next, GLYPHS[ b->grid[i] ], GLYPH_LENGTHS[ b->grid[i] ] );
+            next += GLYPH_LENGTHS[ b->grid[i] ];
+        }
+        if ( next != NULL ) {
+            memcpy( v->grid, b->grid, b->size * b->size );
+            next += sprintf( next, "\033[%d;1H\033[J", b->size + 2 );
+            return next - frame;
         }
-        printf( "\n" );
-    }
-    // Print letters for columns
-    printf( "   " );
-    unsigned char ch;
-    for ( ch = 'A'; ch < 'A' + b->size - 1; ch++ ) {
-        printf( "%c ", ch );
     }
-    // Fence post for last letter.
-    printf( "%c\n", ch);
+    v->drawn = true;
+    v->size = b->size;
+    memcpy( v->grid, b->grid, b->size * b->size );
+    return board_render( b, true, frame );
+}
+
+// Prints the changes since the last frame.
+void board_redraw( board_view* v, board* b)
+{
+    char frame[ BOARD_FRAME_MAX ];
+    writeFrame( frame, board_render_changes( v, b, frame ) );
 }
 
 // Converts x and y cordinates to formal letter+number format.                                                             
@@ -122,6 +211,7 @@ unsigned char board_formal_coord( board* b, unsigned char x, unsigned char y, ch
     else { // y is 10 or greater
         formal_coord[1] = '1';  // First character will always be '1'.
         formal_coord[2] = y - LOWEST_TWO_DIGITS + '0';    // Convert ones digit of y coordinate to its literal character.
+        formal_coord[3] = '\0';
     }
     
     return SUCCESS;
@@ -130,20 +220,36 @@ unsigned char board_formal_coord( board* b, unsigned char x, unsigned char y, ch
 // Converts formal coordinate to x and y.
 unsigned char board_coord( board* b, const char* formal_coord, unsigned char* x, unsigned char* y)
 {
-    int row;    // used to get multiple characters at once without converting ASCII.
-    // Check for correct # of matches for input.
-    if ( sscanf( formal_coord, "%c%d", x, &row ) != 2 ) {
+    // Letter must be one of the board's columns, and the coordinate no longer than "A10".
+    const unsigned char *next = ( const unsigned char * )formal_coord;
+    unsigned char column = COLUMNS[ *next ];
+    if ( column == 0 || column > b->size || strlen( formal_coord ) > MAX_STRING_LENGTH ) {
         return FORMAL_COORDINATE_ERR;
     }
     
-    // Error Check - 1st character is letter, following characters are numbers.
-    if ( *x < 'A' || *x >= 'A' + b->size || 
-         row < 1 || row > b->size || strlen( formal_coord ) > MAX_STRING_LENGTH ) {
-             return FORMAL_COORDINATE_ERR;
+    // Row is read the way "%d" reads it: optional white space and sign, then at least one digit.
+    // Anything after the digits is ignored.
+    next++;
+    while ( isspace( *next ) ) {
+        next++;
+    }
+    bool negative = *next == '-';
+    if ( *next == '+' || *next == '-' ) {
+        next++;
+    }
+    if ( DIGITS[ *next ] == 0 ) {
+        return FORMAL_COORDINATE_ERR;
+    }
+    int row = 0;
+    for ( ; DIGITS[ *next ] != 0; next++ ) {
+        row = row * 10 + DIGITS[ *next ] - 1;
+    }
+    if ( negative || row < 1 || row > b->size ) {
+        return FORMAL_COORDINATE_ERR;
     }
     
     // Convert formal coordinates to x and y values/indeces for grid.
-    *x = formal_coord[0] - 'A'; // get letter into number range 0-size.
+    *x = column - 1;
     *y = b->size - row;  // get "numbers" from coordinate into one singular value. Subtract from size to get correct "orientation" since (0,0) with (x,y) starts at top left.
     
     return SUCCESS;
@@ -185,4 +291,28 @@ bool board_is_full( board* b)
         }
     }
     return true;
-}
\ No newline at end of file
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Writes a rendered frame to standard output at once, behind whatever stdout still holds.
+   @param frame is start of the frame.
+   @param length is number of bytes in the frame.
+*/
+static void writeFrame( const char* frame, size_t length )
+{
+    fflush( stdout );
+    while ( length > 0 ) {
+        ssize_t count = write( STDOUT_FILENO, frame, length );
+        if ( count <= 0 ) {
+            break;
+        }
+        frame += count;
+        length -= count;
+    }
+}
@@ -10,6 +10,7 @@
 #ifndef _BOARD_H_
 #define _BOARD_H_
 #include <stdbool.h>
+#include <stddef.h>
 
 /** Represents an empty spot on the board */
 #define EMPTY_INTERSECTION 0
@@ -17,14 +18,19 @@
 #define BLACK_STONE 1
 /** Represents a white stone for the board */
 #define WHITE_STONE 2
+/** Terminal sequence that moves the cursor home and clears the display */
+#define BOARD_CLEAR_SEQUENCE "\033[H\033[J"
 /** Used to clear the terminal display */
-#define clear() printf("\033[H\033[J")
+#define clear() printf( BOARD_CLEAR_SEQUENCE )
 /** For 15x15 board size */
 #define BOARD_SIZE_15 15   
 /** For 17x17 board size */ 
 #define BOARD_SIZE_17 17   
 /** For 19x19 board size */  
 #define BOARD_SIZE_19 19 
+/** Longest rendered board: clear sequence, 19 rows of label, 3 byte glyphs and dashes, labels */
+#define BOARD_FRAME_MAX ( sizeof( BOARD_CLEAR_SEQUENCE ) + \
+                          BOARD_SIZE_19 * ( 3 + BOARD_SIZE_19 * 4 ) + 3 + BOARD_SIZE_19 * 2 )
 
 /**
    Struct holds behavior for board used in the game. Fields include board size and a dynamically 
@@ -36,6 +42,19 @@ typedef struct {
     unsigned char* grid;
 } board;
 
+/**
+   What a terminal shows of a board, so the next frame only updates what changed. Fields are
+   described as follows:
+   drawn - true once a whole frame has been drawn. False draws the next frame whole.
+   size - board size of the frame on screen.
+   grid - intersection states on screen, like board.grid.
+*/
+typedef struct {
+    bool drawn;
+    unsigned char size;
+    unsigned char grid[ BOARD_SIZE_19 * BOARD_SIZE_19 ];
+} board_view;
+
 /**
    Creates a new dynamically allocated board struct and initializes board.size with the parameter
    size. Initializes board.grid with a new dynamically allocated array and initializes all grid
@@ -54,12 +73,62 @@ board* board_create(unsigned char size);
 void board_delete(board* b);
 
 /**
-   Prints the board. If in_place param is true, terminal is cleared first.
+   Reuses a board for a new game of the given size, with every intersection empty. Nothing is
+   allocated, so the board must have been created with a size at least as large.
+   If invalid size is given, program exits with error code.
+   @param b is pointer to board struct.
+   @param size is the size to set the board.
+*/
+void board_reset(board* b, unsigned char size);
+
+/**
+   Prints the board. If in_place param is true, terminal is cleared first. The whole frame is
+   rendered with board_render() and written to standard output at once, after anything already
+   waiting in stdout.
    @param b is board struct holding game.
    @param in_place indicates if the latest piece is placed, thus the latest board can be printed.
 */
 void board_print(board* b, bool in_place);
 
+/**
+   Renders the board the way board_print() shows it into a buffer, without printing anything.
+   The buffer is not null terminated.
+   @param b is board struct holding game.
+   @param in_place is true to start with the sequence that clears the terminal.
+   @param frame is buffer of at least BOARD_FRAME_MAX bytes.
+   @return is number of bytes rendered.
+*/
+size_t board_render(board* b, bool in_place, char* frame);
+
+/**
+   Forgets what the terminal shows, so the next board_redraw() draws the whole frame. Used when a
+   view is set up, and when something else may have drawn over the board.
+   @param v is pointer to view.
+*/
+void board_view_reset(board_view* v);
+
+/**
+   Renders what it takes to bring the terminal from the frame in view v to board b. The first
+   frame, or one with most intersections changed, is the whole frame from board_render() with
+   the clear sequence. Otherwise it is a cursor movement and glyph for each changed intersection,
+   then a movement to the line below the column letters and a clear of the rest of the display,
+   where messages and prompts are printed again. The view is updated to board b. The frame on
+   screen must still start at the top left, as board_print() and board_redraw() leave it.
+   @param v is pointer to view.
+   @param b is board struct holding game.
+   @param frame is buffer of at least BOARD_FRAME_MAX bytes.
+   @return is number of bytes rendered.
+*/
+size_t board_render_changes(board_view* v, board* b, char* frame);
+
+/**
+   Prints the changes from the frame in view v to board b, rendered by board_render_changes(),
+   with a single write like board_print().
+   @param v is pointer to view.
+   @param b is board struct holding game.
+*/
+void board_redraw(board_view* v, board* b);
+
 /**
    Converts the horizontal/x and vertical/y coordinates for a board.grid to a "letter + number" 
    formal coordinate, and stores the result in the buffer formal_coord. Returns SUCCESS.
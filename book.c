@@ -0,0 +1,129 @@
+/**
+   @file book.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for the memory-mapped opening book.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "book.h"
+#include "error-codes.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Map a book file into memory.
+book* book_open( const char* path )
+{
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        return NULL;
+    }
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || ( size_t )info.st_size < sizeof( book_header ) ) {
+        close( fd );
+        return NULL;
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    void *mapping = mmap( NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( mapping == MAP_FAILED ) {
+        return NULL;
+    }
+
+    // Check header and that the file holds exactly the entries it claims to.
+    const book_header *header = ( const book_header * )mapping;
+    size_t length = info.st_size;
+    if ( memcmp( header->magic, BOOK_MAGIC, sizeof( header->magic ) ) != 0 ||
+         header->version != BOOK_VERSION ||
+         ( length - sizeof( book_header ) ) % sizeof( book_entry ) != 0 ||
+         header->count != ( length - sizeof( book_header ) ) / sizeof( book_entry ) ) {
+        munmap( mapping, length );
+        return NULL;
+    }
+
+    book *b = ( book * )malloc( sizeof( book ) );
+    b->entries = ( const book_entry * )( header + 1 );
+    b->count = header->count;
+    b->mapping = mapping;
+    b->length = length;
+    return b;
+}
+
+// Unmap and free a book.
+void book_close( book* b )
+{
+    if ( b == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    munmap( b->mapping, b->length );
+    free( b );
+}
+
+// Find the best book move for a position.
+unsigned short book_probe( const book* b, const position* p )
+{
+    int symmetry;
+    unsigned long long key = position_key( p, &symmetry );
+
+    // Binary search for the first entry with this key.
+    size_t low = 0;
+    size_t high = b->count;
+    while ( low < high ) {
+        size_t middle = low + ( high - low ) / 2;
+        if ( b->entries[ middle ].key < key ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    // Pick the best of this position's entries.
+    const book_entry *best = NULL;
+    for ( size_t i = low; i < b->count && b->entries[i].key == key; i++ ) {
+        const book_entry *entry = &b->entries[i];
+        if ( best == NULL || entry->weight > best->weight ||
+             ( entry->weight == best->weight && entry->games > best->games ) ) {
+            best = entry;
+        }
+    }
+    if ( best == NULL ) {
+        return POSITION_NO_MOVE;
+    }
+
+    // Turn the canonical move back into this position's orientation. Keys can collide, so the
+    // move must also be legal here.
+    unsigned char x = best->move % p->size;
+    unsigned char y = best->move / p->size;
+    if ( y >= p->size ) {
+        return POSITION_NO_MOVE;
+    }
+    position_transform( p->size, position_inverse( symmetry ), &x, &y );
+    unsigned short move = POSITION_INDEX( x, y );
+    return p->cells[ move ] == EMPTY_INTERSECTION ? move : POSITION_NO_MOVE;
+}
+
+// Write sorted entries to a book file.
+unsigned char book_write( const char* path, const book_entry* entries, size_t count )
+{
+    FILE *outputStream = fopen( path, "wb" );
+    if ( outputStream == NULL ) {
+        return FILE_OUTPUT_ERR;
+    }
+
+    book_header header;
+    memcpy( header.magic, BOOK_MAGIC, sizeof( header.magic ) );
+    header.version = BOOK_VERSION;
+    header.count = count;
+    bool written = fwrite( &header, sizeof( header ), 1, outputStream ) == 1 &&
+                   fwrite( entries, sizeof( book_entry ), count, outputStream ) == count;
+    if ( fclose( outputStream ) != 0 || !written ) {
+        return FILE_OUTPUT_ERR;
+    }
+    return SUCCESS;
+}
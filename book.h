@@ -0,0 +1,97 @@
+/**
+   @file book.h
+   @author Michael Warstler (mwwarstl)
+   Header file for the opening book. A book file is a small header followed by an array of
+   entries sorted by canonical Zobrist key. Books are opened with mmap, so every engine process
+   on a machine shares one page-cached copy and nothing has to be parsed before the first probe.
+   Numbers are stored in the byte order of the machine that built the book.
+*/
+
+#ifndef _BOOK_H_
+#define _BOOK_H_
+#include "position.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/** First bytes of every book file */
+#define BOOK_MAGIC "GBK1"
+/** Current book file version */
+#define BOOK_VERSION 1
+
+/**
+   Header at the start of a book file.
+   magic - BOOK_MAGIC, without a null terminator.
+   version - BOOK_VERSION.
+   count - number of entries following the header.
+*/
+typedef struct {
+    char magic[4];
+    unsigned int version;
+    unsigned long long count;
+} book_header;
+
+/**
+   One book move. Fields are described as follows:
+   key - canonical Zobrist key of the position the move is played from.
+   move - move in canonical orientation, stored as y * board size + x.
+   weight - how good the move is, higher is better. Probes pick the highest weight.
+   games - number of games that played this move from this position.
+   wins - number of those games won by the player who made the move.
+   draws - number of those games that were drawn.
+*/
+typedef struct {
+    unsigned long long key;
+    unsigned short move;
+    unsigned short weight;
+    unsigned int games;
+    unsigned int wins;
+    unsigned int draws;
+} book_entry;
+
+/**
+   An open book. Fields are described as follows:
+   entries - mapped array of entries, sorted by key then move.
+   count - number of entries.
+   mapping - start of the mapped file.
+   length - length of the mapped file in bytes.
+*/
+typedef struct {
+    const book_entry* entries;
+    size_t count;
+    void* mapping;
+    size_t length;
+} book;
+
+/**
+   Opens a book file with mmap.
+   @param path is string for file path location.
+   @return is pointer to book, or NULL if the file is missing or is not a valid book.
+*/
+book* book_open( const char* path );
+
+/**
+   Unmaps the book file and frees the book.
+   If parameter is NULL, program exits with error.
+   @param b is pointer to book.
+*/
+void book_close( book* b );
+
+/**
+   Looks up the position in the book with a binary search, and picks the book move with the
+   highest weight (most games on ties).
+   @param b is pointer to book.
+   @param p is pointer to position.
+   @return is position index of the book move, or POSITION_NO_MOVE if position is not in book.
+*/
+unsigned short book_probe( const book* b, const position* p );
+
+/**
+   Writes entries to a new book file. Entries must already be sorted by key, then move.
+   @param path is string for file location to save book to.
+   @param entries is array of entries.
+   @param count is number of entries.
+   @return is SUCCESS, or FILE_OUTPUT_ERR if the file cannot be written.
+*/
+unsigned char book_write( const char* path, const book_entry* entries, size_t count );
+
+#endif
@@ -0,0 +1,196 @@
+/**
+   @file bookgen.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for executable that builds an opening book from a directory of
+   saved games. Every finished game adds the first moves it played, keyed by canonical position,
+   together with the game's outcome for the player who made each move.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "error-codes.h"
+#include "game.h"
+#include "io.h"
+#include "book.h"
+#include "position.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** How many command line arguments allowed at minimum */
+#define MIN_ARGUMENTS 3
+/** How many command line arguments allowed at maximum */
+#define MAX_ARGUMENTS 7
+/** Default number of moves per game added to the book */
+#define DEFAULT_PLIES 12
+/** Default number of games a move needs before it is kept */
+#define DEFAULT_MIN_GAMES 2
+/** Initial number of entries allocated */
+#define INITIAL_NUM_ENTRIES 1024
+/** Largest weight an entry can have */
+#define MAX_WEIGHT 65535
+
+// Prototypes for static functions that collect and merge entries.
+static void addGame( game* g, int plies, book_entry** entries, size_t* count, size_t* capacity );
+static int compareEntries( const void* a, const void* b );
+
+/**
+   Reads every saved game in a directory and writes the opening book. Optional key arguments are
+   "-p" followed by the number of moves per game to add, and "-m" followed by the number of games
+   a move needs to be kept.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status
+*/
+int main(int argc, char **argv)
+{
+    int plies = DEFAULT_PLIES;
+    unsigned int minGames = DEFAULT_MIN_GAMES;
+
+    // Directory and book path come first, then optional key arguments in pairs.
+    if ( argc < MIN_ARGUMENTS || argc > MAX_ARGUMENTS || argc % 2 == 0 ) {
+        goto error;
+    }
+    for ( int i = MIN_ARGUMENTS; i < argc - 1; i += 2 ) {
+        if ( strcmp( argv[i], "-p" ) == 0 && atoi( argv[i + 1] ) > 0 ) {
+            plies = atoi( argv[i + 1] );
+        }
+        else if ( strcmp( argv[i], "-m" ) == 0 && atoi( argv[i + 1] ) > 0 ) {
+            minGames = atoi( argv[i + 1] );
+        }
+        else {
+            goto error;
+        }
+    }
+
+    DIR *directory = opendir( argv[1] );
+    if ( directory == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+
+    // Collect one entry per book move of every game.
+    size_t count = 0;
+    size_t capacity = INITIAL_NUM_ENTRIES;
+    book_entry *entries = ( book_entry * )malloc( capacity * sizeof( book_entry ) );
+    int games = 0;
+    struct dirent *file;
+    while ( ( file = readdir( directory ) ) != NULL ) {
+        size_t length = strlen( file->d_name );
+        if ( !game_has_extension( file->d_name, GAME_EXTENSION ) &&
+             !game_has_extension( file->d_name, GAME_BINARY_EXTENSION ) ) {
+            continue;
+        }
+        char path[ strlen( argv[1] ) + length + 2 ];
+        sprintf( path, "%s/%s", argv[1], file->d_name );
+        // Games are trusted, so results come from the files without checking every move.
+        unsigned char status;
+        game *g = game_load( path, true, &status );
+        if ( g == NULL ) {
+            exit( status );
+        }
+        addGame( g, plies, &entries, &count, &capacity );
+        game_delete( g );
+        games++;
+    }
+    closedir( directory );
+
+    // Sort, then merge entries of the same move from the same position.
+    qsort( entries, count, sizeof( book_entry ), compareEntries );
+    size_t merged = 0;
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( merged > 0 && entries[ merged - 1 ].key == entries[i].key &&
+             entries[ merged - 1 ].move == entries[i].move ) {
+            entries[ merged - 1 ].games += entries[i].games;
+            entries[ merged - 1 ].wins += entries[i].wins;
+            entries[ merged - 1 ].draws += entries[i].draws;
+        }
+        else {
+            entries[ merged++ ] = entries[i];
+        }
+    }
+
+    // Keep moves played often enough. Weight is the move's score: 2 per win and 1 per draw.
+    size_t kept = 0;
+    for ( size_t i = 0; i < merged; i++ ) {
+        if ( entries[i].games >= minGames ) {
+            unsigned int weight = 2 * entries[i].wins + entries[i].draws;
+            entries[i].weight = weight > MAX_WEIGHT ? MAX_WEIGHT : weight;
+            entries[ kept++ ] = entries[i];
+        }
+    }
+
+    unsigned char status = book_write( argv[2], entries, kept );
+    free( entries );
+    if ( status != SUCCESS ) {
+        exit( status );
+    }
+    printf( "%d games, %zu book moves\n", games, kept );
+    return SUCCESS;
+
+    error:
+    printf( "usage: ./bookgen <saved-games-directory> <book-file> [-p <plies>] [-m <min-games>]\n" );
+    exit( ARGUMENT_ERR );
+}
+
+/**
+   Adds one entry per move of a game's opening. Games without a result (stopped games) are
+   skipped since their moves cannot be scored.
+   @param g is pointer to imported game.
+   @param plies is number of moves to add.
+   @param entries is pointer to dynamically allocated array of entries, grown when full.
+   @param count is pointer to number of entries stored.
+   @param capacity is pointer to number of entries allocated.
+*/
+static void addGame( game* g, int plies, book_entry** entries, size_t* count, size_t* capacity )
+{
+    if ( g->state == GAME_STATE_STOPPED || g->state == GAME_STATE_PLAYING ) {
+        return;
+    }
+
+    position p;
+    position_init( &p, g->board->size, g->type );
+    for ( size_t i = 0; i < g->moves_count && i < plies; i++ ) {
+        // Double size of entries array if needed.
+        if ( *count >= *capacity ) {
+            *capacity *= 2;
+            *entries = ( book_entry * )realloc( *entries, *capacity * sizeof( book_entry ) );
+        }
+
+        // Store the move as seen from the canonical orientation. Symmetric positions have
+        // several canonical orientations; the smallest move over all of them is used so the
+        // same move from every game ends up in one entry.
+        book_entry *entry = &( *entries )[ ( *count )++ ];
+        entry->key = position_key( &p, NULL );
+        entry->move = POSITION_MAX_MOVES;
+        for ( int s = 0; s < POSITION_SYMMETRIES; s++ ) {
+            unsigned char x = g->moves[i].x;
+            unsigned char y = g->moves[i].y;
+            position_transform( p.size, s, &x, &y );
+            if ( p.keys[s] == entry->key && y * p.size + x < entry->move ) {
+                entry->move = y * p.size + x;
+            }
+        }
+        entry->weight = 0;
+        entry->games = 1;
+        entry->wins = g->winner == p.stone;
+        entry->draws = g->winner == EMPTY_INTERSECTION;
+
+        position_play( &p, POSITION_INDEX( g->moves[i].x, g->moves[i].y ) );
+    }
+}
+
+/**
+   Orders entries by key, then by move.
+   @param a is pointer to first entry.
+   @param b is pointer to second entry.
+   @return is negative, zero or positive as a sorts before, with or after b.
+*/
+static int compareEntries( const void* a, const void* b )
+{
+    const book_entry *first = ( const book_entry * )a;
+    const book_entry *second = ( const book_entry * )b;
+    if ( first->key != second->key ) {
+        return first->key < second->key ? -1 : 1;
+    }
+    return ( int )first->move - ( int )second->move;
+}
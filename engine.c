@@ -0,0 +1,215 @@
+/**
+   @file engine.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for the computer player. Converts games into positions and hands them
+   to the selected search algorithm.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "engine.h"
+#include "position.h"
+#include "error-codes.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Prototype for the static background search thread.
+static void* ponderWorker( void* arg );
+
+// Create an engine of the given kind.
+engine* engine_create( unsigned char kind, int threads, long millis )
+{
+    engine *e = ( engine * )malloc( sizeof( engine ) );
+    e->kind = kind;
+    e->threads = threads > 0 ? threads : ( int )sysconf( _SC_NPROCESSORS_ONLN );
+    e->millis = millis;
+    e->playouts = 0;
+    e->depth = SEARCH_MAX_DEPTH;
+    e->tree = NULL;
+    e->search = NULL;
+    e->book = NULL;
+    e->pondering = false;
+    e->ponder_best = POSITION_NO_MOVE;
+    e->ponder_depth = 0;
+    if ( kind == ENGINE_ALPHABETA ) {
+        e->search = search_create( ORDER_FULL );
+    }
+    else {
+        e->tree = mcts_create( ENGINE_DEFAULT_NODES, e->threads );
+    }
+    return e;
+}
+
+// Free an engine and its search data.
+void engine_delete( engine* e )
+{
+    if ( e == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    engine_ponder_stop( e );
+    if ( e->tree != NULL ) {
+        mcts_delete( e->tree );
+    }
+    if ( e->search != NULL ) {
+        search_delete( e->search );
+    }
+    free( e );
+}
+
+// Resize the node arena to fit a memory limit.
+void engine_limit_memory( engine* e, size_t bytes )
+{
+    if ( e->tree == NULL ) {
+        return;
+    }
+    size_t nodes = ENGINE_DEFAULT_NODES;
+    if ( bytes > 0 ) {
+        size_t usable = bytes > ENGINE_MEMORY_RESERVE ? bytes - ENGINE_MEMORY_RESERVE : 0;
+        size_t fit = usable / ( 2 * sizeof( mcts_node ) );
+        nodes = fit < nodes ? fit : nodes;
+        nodes = nodes < ENGINE_MIN_NODES ? ENGINE_MIN_NODES : nodes;
+    }
+    if ( nodes != e->tree->capacity ) {
+        int threads = e->tree->threads;
+        mcts_delete( e->tree );
+        e->tree = mcts_create( nodes, threads );
+    }
+}
+
+// Pick a move for the player to move.
+bool engine_choose( engine* e, game* g, unsigned char* x, unsigned char* y )
+{
+    engine_ponder_stop( e );
+    position p;
+    position_from_game( &p, g );
+    if ( p.winner != EMPTY_INTERSECTION || position_is_full( &p ) ) {
+        return false;
+    }
+
+    // Wins and forced blocks need no search, and neither do book moves.
+    unsigned short best = position_urgent( &p );
+    if ( best == POSITION_NO_MOVE && e->book != NULL ) {
+        best = book_probe( e->book, &p );
+    }
+    if ( best == POSITION_NO_MOVE ) {
+        if ( e->kind == ENGINE_ALPHABETA ) {
+            // If the predicted reply was played, the background search already covers this
+            // position: use it if it is deep enough, otherwise deepen it with the move's time.
+            bool hit = e->ponder_depth > 0 && p.count == e->ponder_position.count &&
+                       memcmp( p.history, e->ponder_position.history,
+                               p.count * sizeof( p.history[0] ) ) == 0;
+            if ( hit && e->ponder_depth >= e->depth ) {
+                best = e->ponder_best;
+            }
+            else if ( hit ) {
+                best = search_continue( e->search, e->depth, e->millis );
+            }
+            else {
+                best = search_run( e->search, &p, e->depth, e->millis );
+            }
+            e->ponder_depth = 0;
+        }
+        else {
+            best = mcts_search( e->tree, &p, e->playouts, e->millis );
+        }
+    }
+    if ( best == POSITION_NO_MOVE ) {
+        return false;
+    }
+    *x = POSITION_X( best );
+    *y = POSITION_Y( best );
+    return true;
+}
+
+// Adapter so an engine can be used as a game move source.
+bool engine_move_source( game* g, void* context, unsigned char* x, unsigned char* y )
+{
+    return engine_choose( ( engine * )context, g, x, y );
+}
+
+// Start searching on the human's time.
+void engine_ponder_start( engine* e, game* g )
+{
+    if ( e->pondering ) {
+        return;
+    }
+    position *p = &e->ponder_position;
+    position_from_game( p, g );
+    if ( p->winner != EMPTY_INTERSECTION || position_is_full( p ) ) {
+        return;
+    }
+
+    // Get the search ready on this thread, so a stop requested right after this returns is
+    // never cleared by the background thread.
+    if ( e->kind == ENGINE_ALPHABETA ) {
+        unsigned short reply = position_urgent( p );
+        if ( reply == POSITION_NO_MOVE ) {
+            reply = search_run( e->search, p, ENGINE_PREDICT_DEPTH, 0 );
+        }
+        position_play( p, reply );
+        if ( p->winner != EMPTY_INTERSECTION || position_is_full( p ) ) {
+            return;
+        }
+    }
+    else {
+        mcts_prepare( e->tree, p );
+    }
+    e->ponder_depth = 0;
+    e->pondering = pthread_create( &e->ponder_thread, NULL, ponderWorker, e ) == 0;
+}
+
+// Stop searching on the human's time.
+void engine_ponder_stop( engine* e )
+{
+    if ( !e->pondering ) {
+        return;
+    }
+    if ( e->kind == ENGINE_ALPHABETA ) {
+        search_stop( e->search );
+    }
+    else {
+        mcts_stop( e->tree );
+    }
+    pthread_join( e->ponder_thread, NULL );
+    e->pondering = false;
+
+    // Keep the alpha-beta result, the next search of the same position is compared against it.
+    if ( e->kind == ENGINE_ALPHABETA ) {
+        e->ponder_best = e->search->best;
+        e->ponder_depth = e->search->depth;
+    }
+}
+
+// Adapter so an engine can be used as a game ponder hook.
+void engine_ponder_hook( game* g, void* context, bool start )
+{
+    if ( start ) {
+        engine_ponder_start( ( engine * )context, g );
+    }
+    else {
+        engine_ponder_stop( ( engine * )context );
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Thread entry point for pondering. Searches the ponder position until stopped.
+   @param arg is pointer to engine.
+   @return is always NULL.
+*/
+static void* ponderWorker( void* arg )
+{
+    engine *e = ( engine * )arg;
+    if ( e->kind == ENGINE_ALPHABETA ) {
+        search_deepen( e->search, &e->ponder_position, e->depth, 0 );
+    }
+    else {
+        mcts_run( e->tree, 0, 0 );
+    }
+    return NULL;
+}
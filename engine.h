@@ -0,0 +1,139 @@
+/**
+   @file engine.h
+   @author Michael Warstler (mwwarstl)
+   Header file for the computer player. An engine picks moves for a game using one of the
+   available search algorithms, and can be plugged into a game as its move source.
+*/
+
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+#include "game.h"
+#include "mcts.h"
+#include "search.h"
+#include "book.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+/** Engine searches with Monte Carlo Tree Search */
+#define ENGINE_MCTS 0
+/** Engine searches with iterative deepening alpha-beta */
+#define ENGINE_ALPHABETA 1
+/** Default thinking time per move in milliseconds */
+#define ENGINE_DEFAULT_MILLIS 2000
+/** Default number of nodes in the Monte Carlo search tree */
+#define ENGINE_DEFAULT_NODES 1000000
+/** Bytes of a memory limit kept free for everything except the Monte Carlo node arena */
+#define ENGINE_MEMORY_RESERVE ( 8 * 1024 * 1024 )
+/** Smallest Monte Carlo node arena, used when the memory limit is tiny */
+#define ENGINE_MIN_NODES 1024
+/** Depth of the alpha-beta search that predicts the human's reply before pondering */
+#define ENGINE_PREDICT_DEPTH 2
+
+/**
+   Fields are described as follows:
+   kind - search algorithm used. (ENGINE_MCTS or ENGINE_ALPHABETA)
+   threads - number of search threads. (ENGINE_MCTS only)
+   millis - thinking time per move in milliseconds, 0 if limited by playouts/depth only.
+   playouts - playouts per move for ENGINE_MCTS, 0 if limited by time only.
+   depth - deepest iteration per move for ENGINE_ALPHABETA.
+   tree - Monte Carlo search tree, reused for every move. NULL unless kind is ENGINE_MCTS.
+   search - alpha-beta searcher. NULL unless kind is ENGINE_ALPHABETA.
+   book - opening book probed before searching, NULL if none. Not owned by the engine.
+   pondering - true while a background search runs on the human's time.
+   ponder_thread - thread running the background search.
+   ponder_position - position searched in the background. For ENGINE_MCTS this is the position
+                     the human moves from, so every reply is covered. For ENGINE_ALPHABETA it is
+                     the position after the predicted reply.
+   ponder_best - best move found by the last alpha-beta background search.
+   ponder_depth - deepest iteration completed by the last alpha-beta background search, 0 if
+                  there is no usable result.
+*/
+typedef struct {
+    unsigned char kind;
+    int threads;
+    long millis;
+    long playouts;
+    int depth;
+    mcts* tree;
+    searcher* search;
+    const book* book;
+    bool pondering;
+    pthread_t ponder_thread;
+    position ponder_position;
+    unsigned short ponder_best;
+    int ponder_depth;
+} engine;
+
+/**
+   Creates a new dynamically allocated engine.
+   @param kind is search algorithm to use.
+   @param threads is number of search threads. Values below 1 use every available core.
+   @param millis is thinking time per move in milliseconds.
+   @return is pointer to engine.
+*/
+engine* engine_create( unsigned char kind, int threads, long millis );
+
+/**
+   Frees memory of the engine and its search data.
+   If parameter is NULL, program exits with error.
+   @param e is pointer to engine.
+*/
+void engine_delete( engine* e );
+
+/**
+   Keeps the engine's search data within a memory limit by resizing the Monte Carlo node arena.
+   The arena never grows beyond ENGINE_DEFAULT_NODES. Half of the limit is left for the copy made
+   when a subtree is kept between moves. Alpha-beta engines use a fixed, small amount of memory
+   and are not changed.
+   @param e is pointer to engine, which must not be pondering.
+   @param bytes is memory limit in bytes, 0 for no limit.
+*/
+void engine_limit_memory( engine* e, size_t bytes );
+
+/**
+   Picks a move for the player to move in game g. Immediate wins and blocks of opponent fives
+   are played without searching, then the opening book is tried before searching.
+   @param e is pointer to engine.
+   @param g is pointer to primary game struct.
+   @param x is pointer to x/horizontal coordinate.
+   @param y is pointer to y/vertical coordinate.
+   @return is true if a move was chosen, false if game has no moves left.
+*/
+bool engine_choose( engine* e, game* g, unsigned char* x, unsigned char* y );
+
+/**
+   Move source callback for game.engine. Context must be an engine created by engine_create().
+   @param g is pointer to primary game struct.
+   @param context is pointer to engine.
+   @param x is pointer to x/horizontal coordinate.
+   @param y is pointer to y/vertical coordinate.
+   @return is true if a move was chosen, false otherwise.
+*/
+bool engine_move_source( game* g, void* context, unsigned char* x, unsigned char* y );
+
+/**
+   Starts searching in the background while the human player thinks. Monte Carlo engines search
+   the current position, which covers every reply and is kept by the next search. Alpha-beta
+   engines predict the reply and search the position after it. Does nothing if the engine is
+   already pondering or the game is over.
+   @param e is pointer to engine.
+   @param g is pointer to primary game struct, with the human to move.
+*/
+void engine_ponder_start( engine* e, game* g );
+
+/**
+   Stops the background search started by engine_ponder_start() and waits for it to finish.
+   Does nothing if the engine is not pondering.
+   @param e is pointer to engine.
+*/
+void engine_ponder_stop( engine* e );
+
+/**
+   Ponder hook callback for game.ponder. Context must be an engine created by engine_create().
+   @param g is pointer to primary game struct.
+   @param context is pointer to engine.
+   @param start is true to start pondering, false to stop.
+*/
+void engine_ponder_hook( game* g, void* context, bool start );
+
+#endif
@@ -0,0 +1,251 @@
+/**
+   @file eval.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for the incremental pattern evaluator. Patterns are runs of stones along
+   a line, classified by length and by how many of their ends are empty, and split shapes of two
+   runs with one empty intersection between them (XX.XX, X.XXX, XX.X, X.X). A split shape only
+   counts when it is stronger than both of its runs, and then replaces them. Placing or removing
+   a stone only changes the patterns on the four lines through that intersection, so those lines
+   are uncounted before the change and counted again after it.
+*/
+
+#include "eval.h"
+
+/** The amount of stone connections required to win */
+#define NEEDED_CONNECTIONS 5
+/** Not a pattern (dead or single stone) */
+#define PATTERN_NONE -1
+/** Bonus for having the move, since the player to move acts first on equal threats */
+#define TEMPO_BONUS 50
+
+/** Score of each pattern class */
+static const int patternScores[ PATTERN_CLASSES ] = { EVAL_WIN, 20000, 2000, 2000, 200, 20 };
+
+// Prototypes for static functions that classify and count patterns.
+static int classifyRun( int length, int ends );
+static int classifySplit( int stones, int ends );
+static bool stronger( int pattern, int other );
+static void countLine( evaluator* e, const position* p, int first, int step, int sign );
+static void countLines( evaluator* e, const position* p, unsigned short index, int sign );
+
+// Count every pattern on the board.
+void eval_init( evaluator* e, const position* p )
+{
+    for ( int s = 0; s < 3; s++ ) {
+        for ( int c = 0; c < PATTERN_CLASSES; c++ ) {
+            e->counts[s][c] = 0;
+        }
+    }
+
+    // Each line is counted once, from its first intersection.
+    for ( int i = 0; i < POSITION_AREA; i++ ) {
+        if ( p->cells[i] == POSITION_WALL ) {
+            continue;
+        }
+        for ( int d = 0; d < POSITION_DIRECTIONS; d++ ) {
+            if ( p->cells[ i - position_steps[d] ] == POSITION_WALL ) {
+                countLine( e, p, i, position_steps[d], 1 );
+            }
+        }
+    }
+}
+
+// Make a move and update the counts around it.
+void eval_play( evaluator* e, position* p, unsigned short index )
+{
+    countLines( e, p, index, -1 );
+    position_play( p, index );
+    countLines( e, p, index, 1 );
+}
+
+// Unmake the most recent move and update the counts around it.
+void eval_undo( evaluator* e, position* p )
+{
+    unsigned short index = p->history[ p->count - 1 ];
+    countLines( e, p, index, -1 );
+    position_undo( p );
+    countLines( e, p, index, 1 );
+}
+
+// Score the position for the player to move.
+int eval_score( const evaluator* e, const position* p )
+{
+    unsigned char stone = p->stone;
+    unsigned char opponent = POSITION_OPPONENT( stone );
+    const int *own = e->counts[ stone ];
+    const int *their = e->counts[ opponent ];
+
+    // Decided positions.
+    if ( p->winner != EMPTY_INTERSECTION ) {
+        return p->winner == stone ? EVAL_WIN : -EVAL_WIN;
+    }
+    // A four of the player to move, straight or split, becomes five right away.
+    if ( own[ PATTERN_OPEN_FOUR ] > 0 || own[ PATTERN_FOUR ] > 0 ) {
+        return EVAL_WIN - 1;
+    }
+    // An open four (or two fours) of the opponent cannot be stopped.
+    if ( their[ PATTERN_OPEN_FOUR ] > 0 || their[ PATTERN_FOUR ] > 1 ) {
+        return -( EVAL_WIN - 2 );
+    }
+
+    int score = TEMPO_BONUS;
+    for ( int c = PATTERN_OPEN_FOUR; c < PATTERN_CLASSES; c++ ) {
+        score += patternScores[c] * ( own[c] - their[c] );
+    }
+    return score;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Classifies a run of stones by its length and number of empty ends.
+   @param length is number of stones in a row.
+   @param ends is number of empty ends (0-2).
+   @return is pattern class, or PATTERN_NONE if run does not count.
+*/
+static int classifyRun( int length, int ends )
+{
+    if ( length >= NEEDED_CONNECTIONS ) {
+        return PATTERN_FIVE;
+    }
+    if ( ends == 0 ) {
+        return PATTERN_NONE;
+    }
+    switch ( length ) {
+        case 4:
+            return ends == 2 ? PATTERN_OPEN_FOUR : PATTERN_FOUR;
+        case 3:
+            return ends == 2 ? PATTERN_OPEN_THREE : PATTERN_THREE;
+        case 2:
+            return ends == 2 ? PATTERN_TWO : PATTERN_NONE;
+        default:
+            return PATTERN_NONE;
+    }
+}
+
+/**
+   Classifies a split shape: two runs of the same stones with one empty intersection between
+   them. Filling the gap joins them, so enough stones for a five make a four whatever the ends.
+   @param stones is number of stones in both runs.
+   @param ends is number of empty intersections just outside the shape (0-2).
+   @return is pattern class, or PATTERN_NONE if shape does not count.
+*/
+static int classifySplit( int stones, int ends )
+{
+    if ( stones >= NEEDED_CONNECTIONS - 1 ) {
+        return PATTERN_FOUR;
+    }
+    if ( ends == 0 ) {
+        return PATTERN_NONE;
+    }
+    switch ( stones ) {
+        case 3:
+            return ends == 2 ? PATTERN_OPEN_THREE : PATTERN_THREE;
+        case 2:
+            return ends == 2 ? PATTERN_TWO : PATTERN_NONE;
+        default:
+            return PATTERN_NONE;
+    }
+}
+
+/**
+   Compares two pattern classes. Lower classes are stronger, and any class beats PATTERN_NONE.
+   @param pattern is pattern class, or PATTERN_NONE.
+   @param other is pattern class, or PATTERN_NONE.
+   @return is true if pattern is stronger than other, otherwise false.
+*/
+static bool stronger( int pattern, int other )
+{
+    return pattern != PATTERN_NONE && ( other == PATTERN_NONE || pattern < other );
+}
+
+/**
+   Adds (sign 1) or removes (sign -1) the patterns of both players along one line. Each run
+   counts on its own unless a split shape it is part of is stronger than both of its runs.
+   @param e is pointer to evaluator.
+   @param p is pointer to position.
+   @param first is index of the first intersection of the line, just after a wall.
+   @param step is index step along the line, from position_steps.
+   @param sign is 1 to add patterns, -1 to remove them.
+*/
+static void countLine( evaluator* e, const position* p, int first, int step, int sign )
+{
+    // The line with a wall at each end, so runs can look one intersection past either end.
+    unsigned char cells[ POSITION_MAX_SIZE + 2 ];
+    int length = 0;
+    cells[ length++ ] = POSITION_WALL;
+    for ( int i = first; p->cells[i] != POSITION_WALL; i += step ) {
+        cells[ length++ ] = p->cells[i];
+    }
+    cells[ length ] = POSITION_WALL;
+
+    // Runs in line order, with their own pattern class.
+    int starts[ POSITION_MAX_SIZE ];
+    int lengths[ POSITION_MAX_SIZE ];
+    int patterns[ POSITION_MAX_SIZE ];
+    bool replaced[ POSITION_MAX_SIZE ];
+    int runs = 0;
+    for ( int i = 1; i < length; ) {
+        unsigned char stone = cells[i];
+        if ( stone != BLACK_STONE && stone != WHITE_STONE ) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while ( cells[i] == stone ) {
+            i++;
+        }
+        starts[ runs ] = start;
+        lengths[ runs ] = i - start;
+        patterns[ runs ] = classifyRun( i - start, ( cells[ start - 1 ] == EMPTY_INTERSECTION ) +
+                                                   ( cells[i] == EMPTY_INTERSECTION ) );
+        replaced[ runs++ ] = false;
+    }
+
+    // Split shapes join neighbouring runs of one stone across a single empty intersection.
+    for ( int r = 0; r + 1 < runs; r++ ) {
+        int end = starts[r] + lengths[r];
+        unsigned char stone = cells[ starts[r] ];
+        if ( cells[ starts[ r + 1 ] ] != stone || starts[ r + 1 ] != end + 1 ) {
+            continue;
+        }
+        int after = starts[ r + 1 ] + lengths[ r + 1 ];
+        int split = classifySplit( lengths[r] + lengths[ r + 1 ],
+                                   ( cells[ starts[r] - 1 ] == EMPTY_INTERSECTION ) +
+                                   ( cells[ after ] == EMPTY_INTERSECTION ) );
+        if ( stronger( split, patterns[r] ) && stronger( split, patterns[ r + 1 ] ) ) {
+            e->counts[ stone ][ split ] += sign;
+            replaced[r] = true;
+            replaced[ r + 1 ] = true;
+        }
+    }
+    for ( int r = 0; r < runs; r++ ) {
+        if ( !replaced[r] && patterns[r] != PATTERN_NONE ) {
+            e->counts[ cells[ starts[r] ] ][ patterns[r] ] += sign;
+        }
+    }
+}
+
+/**
+   Adds (sign 1) or removes (sign -1) the patterns of the four lines through index. These are the
+   only patterns that change when the stone at index changes.
+   @param e is pointer to evaluator.
+   @param p is pointer to position.
+   @param index is intersection index that is about to change or just changed.
+   @param sign is 1 to add patterns, -1 to remove them.
+*/
+static void countLines( evaluator* e, const position* p, unsigned short index, int sign )
+{
+    for ( int d = 0; d < POSITION_DIRECTIONS; d++ ) {
+        int step = position_steps[ d ];
+        int first = index;
+        while ( p->cells[ first - step ] != POSITION_WALL ) {
+            first -= step;
+        }
+        countLine( e, p, first, step, sign );
+    }
+}
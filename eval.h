@@ -0,0 +1,69 @@
+/**
+   @file eval.h
+   @author Michael Warstler (mwwarstl)
+   Header file for the static position evaluator. Positions are scored from the number of
+   patterns (fives, open/closed fours, open/closed threes and open twos) each player has, split
+   shapes such as XX.XX and X.XX included. The counts are kept up to date as moves are made and
+   unmade, so scoring a position never scans the board.
+*/
+
+#ifndef _EVAL_H_
+#define _EVAL_H_
+#include "position.h"
+
+/** Five or more stones in a row */
+#define PATTERN_FIVE 0
+/** Four in a row with both ends empty */
+#define PATTERN_OPEN_FOUR 1
+/** Four in a row with one end empty, or a split four such as XX.XX or X.XXX */
+#define PATTERN_FOUR 2
+/** Three in a row or a split three (X.XX) with both ends empty */
+#define PATTERN_OPEN_THREE 3
+/** Three in a row or a split three with one end empty */
+#define PATTERN_THREE 4
+/** Two in a row or a split two (X.X) with both ends empty */
+#define PATTERN_TWO 5
+/** Number of pattern classes */
+#define PATTERN_CLASSES 6
+/** Score of a won position. Scores beyond EVAL_WIN - POSITION_MAX_MOVES are wins. */
+#define EVAL_WIN 1000000
+
+/**
+   Pattern counts for both players. counts is indexed by stone (BLACK_STONE or WHITE_STONE) and
+   then by pattern class.
+*/
+typedef struct {
+    int counts[3][PATTERN_CLASSES];
+} evaluator;
+
+/**
+   Counts every pattern in a position from scratch. Only needed once, before a search starts.
+   @param e is pointer to evaluator to initialize.
+   @param p is pointer to position.
+*/
+void eval_init( evaluator* e, const position* p );
+
+/**
+   Makes a move with position_play() and updates the pattern counts for the lines through it.
+   @param e is pointer to evaluator.
+   @param p is pointer to position.
+   @param index is an empty intersection index.
+*/
+void eval_play( evaluator* e, position* p, unsigned short index );
+
+/**
+   Unmakes the most recent move with position_undo() and updates the pattern counts.
+   @param e is pointer to evaluator.
+   @param p is pointer to position.
+*/
+void eval_undo( evaluator* e, position* p );
+
+/**
+   Scores the position for the player to move. Positive scores favour the player to move.
+   @param e is pointer to evaluator.
+   @param p is pointer to position.
+   @return is score, between -EVAL_WIN and EVAL_WIN.
+*/
+int eval_score( const evaluator* e, const position* p );
+
+#endif
@@ -0,0 +1,310 @@
+/**
+   @file external.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for external players. Output from the program is read through poll() so a
+   program that hangs costs at most its time per move plus a grace period. A program that times
+   out or answers badly is killed and started again, like tournament managers do, so a late
+   answer can never be taken as the answer to a later request.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "external.h"
+#include "mcts.h"
+#include "error-codes.h"
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Longest line sent to or read from the program */
+#define MAX_LINE_LENGTH 256
+/** Gomocup rule value for renju */
+#define RULE_RENJU 4
+/** Milliseconds between checks that a stopping program has ended */
+#define STOP_CHECK_MILLIS 10
+
+// Prototypes for static functions that run and talk to the program.
+static bool launch( external* e );
+static void terminate( external* e );
+static bool requestMove( external* e, game* g, unsigned char* x, unsigned char* y );
+static bool sendLine( external* e, const char* line );
+static bool readLine( external* e, char* line, long long deadline );
+static bool startGame( external* e, unsigned char size, unsigned char type );
+
+// Start an external program.
+external* external_start( const char* program, long millis )
+{
+    external *e = ( external * )malloc( sizeof( external ) );
+    e->program = program;
+    e->millis = millis;
+    if ( !launch( e ) ) {
+        free( e );
+        return NULL;
+    }
+    return e;
+}
+
+// End an external program.
+void external_stop( external* e )
+{
+    if ( e == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    if ( e->pid < 0 ) {
+        free( e );
+        return;
+    }
+    sendLine( e, "END\n" );
+    close( e->to_program );
+    close( e->from_program );
+
+    // Give the program a moment to end by itself.
+    struct timespec pause = { 0, STOP_CHECK_MILLIS * 1000000L };
+    for ( long waited = 0; waited < EXTERNAL_GRACE_MILLIS; waited += STOP_CHECK_MILLIS ) {
+        if ( waitpid( e->pid, NULL, WNOHANG ) != 0 ) {
+            free( e );
+            return;
+        }
+        nanosleep( &pause, NULL );
+    }
+    kill( e->pid, SIGKILL );
+    waitpid( e->pid, NULL, 0 );
+    free( e );
+}
+
+// Ask the program for a move, starting it again if it fails to answer.
+bool external_move_source( game* g, void* context, unsigned char* x, unsigned char* y )
+{
+    external *e = ( external * )context;
+    if ( e->pid < 0 && !launch( e ) ) {
+        return false;
+    }
+    if ( requestMove( e, g, x, y ) ) {
+        return true;
+    }
+    terminate( e );
+    launch( e );
+    return false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Runs the program with pipes for its stdin and stdout. It has not been sent a game yet.
+   @param e is pointer to external player with program set.
+   @return is true if the program was started, false otherwise (pid is then -1).
+*/
+static bool launch( external* e )
+{
+    e->pid = -1;
+    e->size = 0;
+    e->type = GAME_FREESTYLE;
+    e->buffered = 0;
+    int toProgram[2];
+    int fromProgram[2];
+    if ( pipe( toProgram ) != 0 ) {
+        return false;
+    }
+    if ( pipe( fromProgram ) != 0 ) {
+        close( toProgram[0] );
+        close( toProgram[1] );
+        return false;
+    }
+    signal( SIGPIPE, SIG_IGN );
+
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        // Child: the pipes become stdin/stdout of the program.
+        dup2( toProgram[0], STDIN_FILENO );
+        dup2( fromProgram[1], STDOUT_FILENO );
+        close( toProgram[0] );
+        close( toProgram[1] );
+        close( fromProgram[0] );
+        close( fromProgram[1] );
+        execl( e->program, e->program, ( char * )NULL );
+        _exit( FILE_INPUT_ERR );
+    }
+    close( toProgram[0] );
+    close( fromProgram[1] );
+    if ( pid < 0 ) {
+        close( toProgram[1] );
+        close( fromProgram[0] );
+        return false;
+    }
+    e->pid = pid;
+    e->to_program = toProgram[1];
+    e->from_program = fromProgram[0];
+    return true;
+}
+
+/**
+   Kills the program at once and drops whatever it sent, without freeing the external player.
+   @param e is pointer to external player with a running program.
+*/
+static void terminate( external* e )
+{
+    close( e->to_program );
+    close( e->from_program );
+    kill( e->pid, SIGKILL );
+    waitpid( e->pid, NULL, 0 );
+    e->pid = -1;
+    e->buffered = 0;
+}
+
+/**
+   Sends the game to the program, starting a new game in it first whenever board size or game
+   type change, and reads its move.
+   @param e is pointer to external player with a running program.
+   @param g is pointer to primary game struct.
+   @param x is pointer to x/horizontal coordinate.
+   @param y is pointer to y/vertical coordinate.
+   @return is true if the program answered with a move in time, false otherwise.
+*/
+static bool requestMove( external* e, game* g, unsigned char* x, unsigned char* y )
+{
+    if ( ( e->size != g->board->size || e->type != g->type ) &&
+         !startGame( e, g->board->size, g->type ) ) {
+        return false;
+    }
+
+    // Send every move, marking the program's own stones with 1 and the opponent's with 2.
+    char line[ MAX_LINE_LENGTH ];
+    if ( !sendLine( e, "BOARD\n" ) ) {
+        return false;
+    }
+    for ( size_t i = 0; i < g->moves_count; i++ ) {
+        snprintf( line, sizeof( line ), "%d,%d,%d\n", g->moves[i].x, g->moves[i].y,
+                  g->moves[i].stone == g->stone ? 1 : 2 );
+        if ( !sendLine( e, line ) ) {
+            return false;
+        }
+    }
+    if ( !sendLine( e, "DONE\n" ) ) {
+        return false;
+    }
+
+    // Skip MESSAGE and DEBUG lines until the move arrives.
+    long long deadline = mcts_now() + e->millis + EXTERNAL_GRACE_MILLIS;
+    while ( readLine( e, line, deadline ) ) {
+        int column;
+        int row;
+        if ( sscanf( line, "%d,%d", &column, &row ) == 2 ) {
+            if ( column < 0 || row < 0 || column >= g->board->size || row >= g->board->size ) {
+                return false;
+            }
+            *x = column;
+            *y = row;
+            return true;
+        }
+        if ( strncmp( line, "MESSAGE", 7 ) != 0 && strncmp( line, "DEBUG", 5 ) != 0 ) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+   Writes a whole line to the program.
+   @param e is pointer to external player.
+   @param line is string to send, ending in a newline.
+   @return is true if the line was written, false if the program is gone.
+*/
+static bool sendLine( external* e, const char* line )
+{
+    size_t length = strlen( line );
+    while ( length > 0 ) {
+        ssize_t written = write( e->to_program, line, length );
+        if ( written <= 0 ) {
+            return false;
+        }
+        line += written;
+        length -= written;
+    }
+    return true;
+}
+
+/**
+   Reads one line from the program, waiting no later than deadline. The newline (and a carriage
+   return before it) is removed. Lines too long for the buffer are cut short.
+   @param e is pointer to external player.
+   @param line is buffer of MAX_LINE_LENGTH characters for the line.
+   @param deadline is monotonic time in milliseconds to give up at.
+   @return is true if a line was read, false on timeout or if the program is gone.
+*/
+static bool readLine( external* e, char* line, long long deadline )
+{
+    while ( true ) {
+        // Hand out a complete line if one is buffered.
+        char *end = memchr( e->buffer, '\n', e->buffered );
+        if ( end != NULL || e->buffered == sizeof( e->buffer ) ) {
+            size_t length = end != NULL ? ( size_t )( end - e->buffer ) : e->buffered;
+            size_t used = end != NULL ? length + 1 : length;
+            if ( length > 0 && e->buffer[ length - 1 ] == '\r' ) {
+                length--;
+            }
+            if ( length >= MAX_LINE_LENGTH ) {
+                length = MAX_LINE_LENGTH - 1;
+            }
+            memcpy( line, e->buffer, length );
+            line[ length ] = '\0';
+            memmove( e->buffer, e->buffer + used, e->buffered - used );
+            e->buffered -= used;
+            return true;
+        }
+
+        // Otherwise wait for more output.
+        long long remaining = deadline - mcts_now();
+        struct pollfd ready = { e->from_program, POLLIN, 0 };
+        if ( remaining <= 0 || poll( &ready, 1, remaining ) <= 0 ) {
+            return false;
+        }
+        ssize_t count = read( e->from_program, e->buffer + e->buffered,
+                              sizeof( e->buffer ) - e->buffered );
+        if ( count <= 0 ) {
+            return false;
+        }
+        e->buffered += count;
+    }
+}
+
+/**
+   Starts a new game in the program and sends the rule and time per move.
+   @param e is pointer to external player.
+   @param size is size of the board.
+   @param type is type of game being played.
+   @return is true if the program accepted the game, otherwise false.
+*/
+static bool startGame( external* e, unsigned char size, unsigned char type )
+{
+    char line[ MAX_LINE_LENGTH ];
+    snprintf( line, sizeof( line ), "START %d\n", size );
+    if ( !sendLine( e, line ) ) {
+        return false;
+    }
+    long long deadline = mcts_now() + EXTERNAL_GRACE_MILLIS;
+    do {
+        if ( !readLine( e, line, deadline ) ) {
+            return false;
+        }
+    } while ( strncmp( line, "MESSAGE", 7 ) == 0 || strncmp( line, "DEBUG", 5 ) == 0 );
+    if ( strcmp( line, "OK" ) != 0 ) {
+        return false;
+    }
+
+    snprintf( line, sizeof( line ), "INFO rule %d\nINFO timeout_turn %ld\nINFO timeout_match 0\n",
+              type == GAME_RENJU ? RULE_RENJU : 0, e->millis );
+    if ( !sendLine( e, line ) ) {
+        return false;
+    }
+    e->size = size;
+    e->type = type;
+    return true;
+}
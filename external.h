@@ -0,0 +1,74 @@
+/**
+   @file external.h
+   @author Michael Warstler (mwwarstl)
+   Header file for external players: other programs (such as another build of pbrain) that speak
+   the Gomocup stdin/stdout protocol. The program is started once and plays any number of games.
+   Every move sends the whole game with BOARD, so the program never has to track moves itself.
+*/
+
+#ifndef _EXTERNAL_H_
+#define _EXTERNAL_H_
+#include "game.h"
+#include <sys/types.h>
+#include <stdbool.h>
+
+/** Extra milliseconds an external program gets to answer beyond its time per move */
+#define EXTERNAL_GRACE_MILLIS 1000
+/** Size of the buffer holding output read from the program */
+#define EXTERNAL_BUFFER_SIZE 4096
+
+/**
+   A running external program. Fields are described as follows:
+   program - path of the program, kept for starting it again.
+   pid - process id of the program, -1 while it is not running.
+   to_program - descriptor of the pipe to the program's stdin.
+   from_program - descriptor of the pipe from the program's stdout.
+   millis - time per move given to the program.
+   size - board size of the game the program was last started for, 0 if none.
+   type - game type of the game the program was last started for.
+   buffer - output read from the program but not yet used.
+   buffered - number of bytes in buffer.
+*/
+typedef struct {
+    const char* program;
+    pid_t pid;
+    int to_program;
+    int from_program;
+    long millis;
+    unsigned char size;
+    unsigned char type;
+    char buffer[ EXTERNAL_BUFFER_SIZE ];
+    size_t buffered;
+} external;
+
+/**
+   Starts an external program. Writing to a program that has died must not end this process, so
+   SIGPIPE is ignored from then on.
+   @param program is path of the program to run. It must stay valid until external_stop().
+   @param millis is time per move in milliseconds.
+   @return is pointer to external player, or NULL if the program can't be started.
+*/
+external* external_start( const char* program, long millis );
+
+/**
+   Tells the program to end, waits briefly for it (killing it if it does not end), and frees the
+   external player.
+   If parameter is NULL, program exits with error.
+   @param e is pointer to external player.
+*/
+void external_stop( external* e );
+
+/**
+   Move source callback for game.engine and self-play. Context must be an external player created
+   by external_start(). The program is started on a new game whenever board size or game type
+   change, then sent the position with BOARD. A program that does not answer with a move in time
+   is killed and started again, so its late answer is never read as a later move.
+   @param g is pointer to primary game struct.
+   @param context is pointer to external player.
+   @param x is pointer to x/horizontal coordinate.
+   @param y is pointer to y/vertical coordinate.
+   @return is true if the program answered with a move in time, false otherwise.
+*/
+bool external_move_source( game* g, void* context, unsigned char* x, unsigned char* y );
+
+#endif
@@ -5,12 +5,16 @@
    loops a game, places stones, and can replay a previously saved game.
 */
 
+#define _POSIX_C_SOURCE 200809L
 #include "game.h"
 #include "board.h"          
 #include "error-codes.h"    
 #include <unistd.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 /** Represents the initial number of moves allowed */
 #define INITIAL_NUM_MOVES 16
@@ -20,6 +24,31 @@
 #define NEEDED_CONNECTIONS 5
 /** Number of open fours allowed before becoming forbidden */
 #define ALLOWED_OPEN_FOURS 1
+/** Longest token read as one move of a script, longer tokens are split */
+#define SCRIPT_TOKEN_LENGTH 15
+/** SCRIPT_TOKEN_LENGTH as a scanf field width */
+#define SCRIPT_TOKEN_FORMAT "15"
+/** Longest command read while stepping through a replay */
+#define REPLAY_COMMAND_LENGTH 32
+/** Rows of the moves list shown under a replay's board, a black and a white move each */
+#define REPLAY_LIST_ROWS 10
+/** Longest moves list: title, count of earlier moves, then full rows */
+#define REPLAY_LIST_LENGTH ( 64 + REPLAY_LIST_ROWS * 24 )
+
+/**
+   Position of a replay after a number of moves, kept so seeking only replays the moves after it.
+   Fields are described as follows:
+   grid - intersection states, like board.grid.
+   stone - which player places the next stone.
+   state - game state.
+   winner - stone of the winner.
+*/
+typedef struct {
+    unsigned char grid[ BOARD_SIZE_19 * BOARD_SIZE_19 ];
+    unsigned char stone;
+    unsigned char state;
+    unsigned char winner;
+} checkpoint;
 
 // Prototypes for static functions to calculate winner and check for forbidden moves.
 static bool verticalWin( game *g, unsigned char x );
@@ -29,6 +58,18 @@ static bool diagonalUpWin( game *g, unsigned char x, unsigned char y );
 static void doubleOpenFours( game *g, unsigned char x, unsigned char y );
 static bool overline( game *g, unsigned char x, unsigned char y );
 
+// Prototypes for static functions that report and replay games.
+static void printOutcome( const game* g );
+static checkpoint* replayCheckpoints( const game* g, game* replayGame );
+static void replaySeek( const game* g, game* replayGame, const checkpoint* checkpoints,
+                        size_t ply );
+static void replayShow( const game* g, game* replayGame );
+
+// Prototypes for static functions that describe problems found by game_verify().
+static void describeProblem( char* problem, size_t length, const char* format, ... );
+static const char* stateName( unsigned char state );
+static const char* winnerName( unsigned char stone );
+
 // Create a game struct based on game type and board size params.
 game* game_create(unsigned char board_size, unsigned char game_type)
 {
@@ -41,9 +82,33 @@ game* game_create(unsigned char board_size, unsigned char game_type)
     g->moves = ( move * )malloc( INITIAL_NUM_MOVES * sizeof( move ) );
     g->moves_count = 0;
     g->moves_capacity = INITIAL_NUM_MOVES;
+    g->engine = NULL;
+    g->engine_context = NULL;
+    g->engine_stone = EMPTY_INTERSECTION;
+    g->ponder = NULL;
+    g->quiet = false;
+    g->record = NULL;
+    g->record_context = NULL;
+    board_view_reset( &g->view );
     return g;
 }
 
+// Reuse a game struct for a new game.
+void game_reset(game* g, unsigned char board_size, unsigned char game_type)
+{
+    board_reset( g->board, board_size );
+    g->type = game_type;
+    g->stone = BLACK_STONE;
+    g->state = GAME_STATE_PLAYING;
+    g->winner = EMPTY_INTERSECTION;
+    g->moves_count = 0;
+    if ( g->moves_capacity < board_size * board_size ) {
+        g->moves_capacity = board_size * board_size;
+        g->moves = ( move * )realloc( g->moves, g->moves_capacity * sizeof( move ) );
+    }
+    board_view_reset( &g->view );
+}
+
 // Free memory held by game struct and its dynamically allocated fields.
 void game_delete( game* g)
 {
@@ -65,6 +130,18 @@ bool game_update( game* g)
         return false;
     }
     
+    // Computer controlled player picks its own move.
+    if ( g->engine != NULL && g->stone == g->engine_stone ) {
+        unsigned char x;
+        unsigned char y;
+        if ( g->engine( g, g->engine_context, &x, &y ) && game_place_stone( g, x, y ) ) {
+            return true;
+        }
+        g->state = GAME_STATE_STOPPED;
+        printf( "The game is stopped.\n" );
+        return false;
+    }
+    
     // Access current move. (Holds no data currently)
     move *currentMove = &g->moves[ g->moves_count ];
     
@@ -85,8 +162,17 @@ bool game_update( game* g)
             currentMove->stone = WHITE_STONE;
         }
         
+        // Let the computer player think while the human does.
+        bool pondering = g->engine != NULL && g->ponder != NULL;
+        if ( pondering ) {
+            g->ponder( g, g->engine_context, true );
+        }
+
         // Scan user input and break immediately if EOF, otherwise check coordinates.
         matches = scanf( "%s", formal_coord );
+        if ( pondering ) {
+            g->ponder( g, g->engine_context, false );
+        }
         // Immediately break if at EOF
         if ( matches == EOF ) {
             break;
@@ -117,21 +203,70 @@ void game_loop( game* g)
     do {
         // Only print when game state is still playing
         if ( g->state == GAME_STATE_PLAYING ) {
-            board_print( g->board, true);
+            board_redraw( &g->view, g->board );
         }
     } while ( game_update( g ) );
     
     // Display board and text on finished game.
     if ( g->state == GAME_STATE_FINISHED ) {
-        board_print( g->board, true);
+        board_redraw( &g->view, g->board );
         printf( "Game concluded, %s won.\n", g->winner == BLACK_STONE ? "black" : "white" );
     }
     else if ( g->state == GAME_STATE_FORBIDDEN ) {
-        board_print( g->board, true);
+        board_redraw( &g->view, g->board );
         printf( "Game concluded, black made a forbidden move, white won.\n" );
     }
 }
 
+// Plays moves from a script without printing the board or prompts.
+unsigned char game_script( game* g, FILE* script)
+{
+    // Error check, a stopped game carries on.
+    if ( g->state == GAME_STATE_STOPPED ) {
+        g->state = GAME_STATE_PLAYING;
+    }
+    else if ( g->state != GAME_STATE_PLAYING ) {
+        exit( RESUME_ERR );
+    }
+    bool quiet = g->quiet;
+    g->quiet = true;
+    
+    unsigned char status = SUCCESS;
+    char token[ SCRIPT_TOKEN_LENGTH + 1 ];
+    while ( status == SUCCESS ) {
+        unsigned char x;
+        unsigned char y;
+        
+        // Computer controlled player moves on its turn, the script gives every other move.
+        if ( g->state == GAME_STATE_PLAYING && g->engine != NULL && g->stone == g->engine_stone ) {
+            if ( !g->engine( g, g->engine_context, &x, &y ) || !game_place_stone( g, x, y ) ) {
+                break;
+            }
+            continue;
+        }
+        if ( fscanf( script, "%" SCRIPT_TOKEN_FORMAT "s", token ) != 1 ) {
+            break;
+        }
+        if ( board_coord( g->board, token, &x, &y ) != SUCCESS ) {
+            status = FORMAL_COORDINATE_ERR;
+        }
+        else if ( g->state != GAME_STATE_PLAYING || !game_place_stone( g, x, y ) ) {
+            status = COORDINATE_ERR;
+        }
+        if ( status != SUCCESS ) {
+            fprintf( stderr, "move %zu is invalid: %s\n", g->moves_count + 1, token );
+        }
+    }
+    
+    // Script is done, report how the game stands.
+    if ( g->state == GAME_STATE_PLAYING ) {
+        g->state = GAME_STATE_STOPPED;
+    }
+    g->quiet = quiet;
+    printOutcome( g );
+    return status;
+}
+
 // Restarts game loop for saved game.
 void game_resume( game* g)
 {
@@ -145,58 +280,66 @@ void game_resume( game* g)
     game_loop( g );
 }
 
-// Restarts the game loop for a saved game.
+// Replays a saved game at normal speed.
 void game_replay( game* g)
-{    
-    // Begin replay. Create new game struct and copy moves, state, and winner.
+{
+    game_replay_from( g, 1, GAME_REPLAY_MILLIS, false );
+}
+
+// Replays a saved game from a move, at a speed or step by step.
+void game_replay_from( game* g, size_t start, long millis, bool stepping)
+{
+    // Begin replay. Create new game struct that copies state and winner, with room for every move.
     game *replayGame = game_create( g->board->size, g->type );
     replayGame->winner = g->winner;
     replayGame->state = g->state;
+    replayGame->quiet = true;
+    replayGame->moves_capacity = g->moves_count > INITIAL_NUM_MOVES ? g->moves_count :
+                                                                      INITIAL_NUM_MOVES;
+    replayGame->moves = ( move * )realloc( replayGame->moves,
+                                          replayGame->moves_capacity * sizeof( move ) );
+    checkpoint *checkpoints = replayCheckpoints( g, replayGame );
     
-    // Loop through moves array and perform those moves
-    for (int i = 0; i < g->moves_count; i++) {
-        // Place stone on replayGame using moves from saved game
-        game_place_stone( replayGame, g->moves[i].x, g->moves[i].y );
-        
-        // Print latest board of replayGame
-        board_print( replayGame->board, true );
-        
-        // Print out winner or stopped state on last iteration only.
-        if ( i == g->moves_count - 1) {
-            if ( replayGame->winner == WHITE_STONE ) {
-            replayGame->state == GAME_STATE_FORBIDDEN ? printf( "Game concluded, black made a forbidden move, white won.\n" ) :
-                                                        printf( "Game concluded, white won.\n" );
+    // Without stepping, every move from the start on is shown in turn with a pause after it.
+    size_t ply = start < g->moves_count ? start : g->moves_count;
+    if ( !stepping ) {
+        for ( ply = ply > 0 ? ply : 1; ply <= g->moves_count; ply++ ) {
+            replaySeek( g, replayGame, checkpoints, ply );
+            replayShow( g, replayGame );
+            if ( millis > 0 ) {
+                struct timespec pause = { millis / 1000, millis % 1000 * 1000000L };
+                nanosleep( &pause, NULL );
             }
-            else if ( replayGame->winner == BLACK_STONE ) {
-                printf( "Game concluded, black won.\n" );
+        }
+    }
+    
+    // Stepping waits for a command after every move shown: forward, back, a move to jump to.
+    else {
+        char command[ REPLAY_COMMAND_LENGTH ];
+        while ( true ) {
+            replaySeek( g, replayGame, checkpoints, ply );
+            replayShow( g, replayGame );
+            printf( "Move %zu of %zu. Enter for next, b for back, a move number to jump, "
+                    "q to quit: ", ply, g->moves_count );
+            if ( fgets( command, sizeof( command ), stdin ) == NULL || command[0] == 'q' ) {
+                break;
             }
-            else if ( replayGame->state == GAME_STATE_STOPPED ) {
-                printf( "The game is stopped.\n" );
+            char *end;
+            long target = strtol( command, &end, 10 );
+            if ( command[0] == 'b' ) {
+                ply = ply > 0 ? ply - 1 : 0;
             }
-        }
-        
-        // Print moves list. Grows as more moves are replayed.
-        printf( "Moves:\n" );
-        for ( int j = 0; j <= i; j++ ) {
-            // Set up formal coordinates for output                                         
-            char formal_coord[ MAX_STRING_LENGTH + 1 ];
-            
-            // Even moves are always Black.
-            j % 2 == 0 ? printf( "Black: ") : printf( "  White: ");
-            
-            // Convert x/y move to formal coord and print to display.
-            board_formal_coord( replayGame->board, g->moves[j].x, g->moves[j].y, formal_coord );
-            printf( "%3s", formal_coord );
-            
-            // print newline if White or last piece placed
-            if ( j % 2 != 0 || j == g->moves_count - 1 ) {
-                printf( "\n" );
+            else if ( end != command && target >= 0 ) {
+                ply = ( size_t )target < g->moves_count ? ( size_t )target : g->moves_count;
+            }
+            else if ( ply < g->moves_count ) {
+                ply++;
             }
         }
-        
-        // Wait one second before calling again
-        sleep( 1 );
+        printf( "\n" );
     }
+    free( checkpoints );
+    game_delete( replayGame );
 }
 
 // Enforces game rules and places stone when possible.
@@ -204,7 +347,9 @@ bool game_place_stone( game* g, unsigned char x, unsigned char y)
 {
     // Check if space is already occupied.
     if ( board_get( g->board, x, y ) != EMPTY_INTERSECTION ) {
-        printf( "There is already a stone at the coordinate you entered, please try again.\n" );
+        if ( !g->quiet ) {
+            printf( "There is already a stone at the coordinate you entered, please try again.\n" );
+        }
         return false;
     }
     
@@ -248,22 +393,244 @@ bool game_place_stone( game* g, unsigned char x, unsigned char y)
     // If no winner, check for full baord - draw.
     else if ( board_is_full( g->board ) ) {
         g->state = GAME_STATE_FINISHED;
-        board_print( g->board, true );
-        printf( "Game concluded, the board is full, draw.\n" );     // May need to put this by the end of game loop along with a check for winner if some test fail because of this, otherwise leave it here.
+        if ( !g->quiet ) {
+            board_redraw( &g->view, g->board );
+            printf( "Game concluded, the board is full, draw.\n" );     // May need to put this by the end of game loop along with a check for winner if some test fail because of this, otherwise leave it here.
+        }
     }
     // If none of the above returned true, game is ongoing. Just update stone.
     else {
         g->stone = g->stone == BLACK_STONE ? WHITE_STONE : BLACK_STONE;
     }
+    
+    // Record the move once it has taken effect.
+    if ( g->record != NULL ) {
+        g->record( g, g->record_context, &g->moves[ g->moves_count - 1 ] );
+    }
+    return true;
+}
+
+// Places a stone without enforcing game rules.
+bool game_add_stone( game* g, unsigned char x, unsigned char y)
+{
+    if ( board_get( g->board, x, y ) != EMPTY_INTERSECTION ) {
+        return false;
+    }
+    
+    //Add move to end of moves array, double size if needed.
+    if ( g->moves_count >= g->moves_capacity ) {
+        g->moves_capacity *= 2;
+        g->moves = ( move *)realloc( g->moves, g->moves_capacity * sizeof( move ) );
+    }
+    move playerMove = { x, y, g->stone };
+    g->moves[ g->moves_count++ ] = playerMove;
+    board_set( g->board, x, y, g->stone );
+    g->stone = g->stone == BLACK_STONE ? WHITE_STONE : BLACK_STONE;
     return true;
 }
 
+// Checks a game's moves, state and winner against the rules.
+bool game_verify( const game* g, char* problem, size_t length )
+{
+    // Replay from an empty board in play, like importing the game with every rule checked.
+    game *checkGame = game_create( g->board->size, g->type );
+    checkGame->quiet = true;
+    bool valid = true;
+    for ( size_t i = 0; i < g->moves_count && valid; i++ ) {
+        if ( checkGame->state != GAME_STATE_PLAYING ) {
+            describeProblem( problem, length, "game ended at move %zu of %zu", i,
+                             g->moves_count );
+            valid = false;
+        }
+        else if ( !game_place_stone( checkGame, g->moves[i].x, g->moves[i].y ) ) {
+            describeProblem( problem, length, "move %zu is on an occupied intersection", i + 1 );
+            valid = false;
+        }
+        else if ( checkGame->moves[i].stone != g->moves[i].stone ) {
+            describeProblem( problem, length, "move %zu is %s, the rules give %s", i + 1,
+                             winnerName( g->moves[i].stone ),
+                             winnerName( checkGame->moves[i].stone ) );
+            valid = false;
+        }
+    }
+
+    // A replay that has not ended matches a stopped game.
+    unsigned char state = checkGame->state == GAME_STATE_PLAYING ? GAME_STATE_STOPPED :
+                                                                   checkGame->state;
+    if ( valid && ( g->state != state || g->winner != checkGame->winner ) ) {
+        describeProblem( problem, length, "recorded %s, %s won; replay gives %s, %s won",
+                         stateName( g->state ), winnerName( g->winner ), stateName( state ),
+                         winnerName( checkGame->winner ) );
+        valid = false;
+    }
+    game_delete( checkGame );
+    return valid;
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // STATIC METHODS BELOW //
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+/**
+   Writes a description of a problem found by game_verify(), if the caller wants one.
+   @param problem is buffer for the description, NULL if none is wanted.
+   @param length is size of the buffer.
+   @param format is printf format of the description.
+*/
+static void describeProblem( char* problem, size_t length, const char* format, ... )
+{
+    if ( problem == NULL ) {
+        return;
+    }
+    va_list values;
+    va_start( values, format );
+    vsnprintf( problem, length, format, values );
+    va_end( values );
+}
+
+/**
+   Names a game state for problem descriptions.
+   @param state is game state.
+   @return is name of the state.
+*/
+static const char* stateName( unsigned char state )
+{
+    switch ( state ) {
+        case GAME_STATE_PLAYING:
+            return "playing";
+        case GAME_STATE_FORBIDDEN:
+            return "forbidden move";
+        case GAME_STATE_STOPPED:
+            return "stopped";
+        default:
+            return "finished";
+    }
+}
+
+/**
+   Names a stone, or the winner of a game, for problem descriptions.
+   @param stone is stone, EMPTY_INTERSECTION for none.
+   @return is name of the stone.
+*/
+static const char* winnerName( unsigned char stone )
+{
+    return stone == BLACK_STONE ? "black" : stone == WHITE_STONE ? "white" : "nobody";
+}
+
+/**
+   Prints how a game that is no longer playing ended: who won and how, a draw, or stopped.
+   @param g is pointer to primary game struct.
+*/
+static void printOutcome( const game* g )
+{
+    if ( g->winner == WHITE_STONE ) {
+        g->state == GAME_STATE_FORBIDDEN ? printf( "Game concluded, black made a forbidden move, white won.\n" ) :
+                                           printf( "Game concluded, white won.\n" );
+    }
+    else if ( g->winner == BLACK_STONE ) {
+        printf( "Game concluded, black won.\n" );
+    }
+    else if ( g->state == GAME_STATE_FINISHED ) {
+        printf( "Game concluded, the board is full, draw.\n" );
+    }
+    else if ( g->state == GAME_STATE_STOPPED ) {
+        printf( "The game is stopped.\n" );
+    }
+}
+
+/**
+   Replays a whole game once, keeping a checkpoint before the first move and after every
+   GAME_REPLAY_CHECKPOINT moves. The replay game is left after the last move.
+   @param g is pointer to the saved game.
+   @param replayGame is pointer to the replay game, before its first move, with room for every
+                     move of the saved game.
+   @return is array of checkpoints, checkpoint k after k * GAME_REPLAY_CHECKPOINT moves.
+*/
+static checkpoint* replayCheckpoints( const game* g, game* replayGame )
+{
+    size_t count = g->moves_count / GAME_REPLAY_CHECKPOINT + 1;
+    checkpoint *checkpoints = ( checkpoint * )malloc( count * sizeof( checkpoint ) );
+    int cells = g->board->size * g->board->size;
+    for ( size_t i = 0; i <= g->moves_count; i++ ) {
+        if ( i % GAME_REPLAY_CHECKPOINT == 0 ) {
+            checkpoint *c = &checkpoints[ i / GAME_REPLAY_CHECKPOINT ];
+            memcpy( c->grid, replayGame->board->grid, cells );
+            c->stone = replayGame->stone;
+            c->state = replayGame->state;
+            c->winner = replayGame->winner;
+        }
+        if ( i < g->moves_count ) {
+            game_place_stone( replayGame, g->moves[i].x, g->moves[i].y );
+        }
+    }
+    return checkpoints;
+}
+
+/**
+   Moves a replay to the position after a number of moves: back to the nearest checkpoint at or
+   before it, then forward by placing the moves after the checkpoint.
+   @param g is pointer to the saved game.
+   @param replayGame is pointer to the replay game.
+   @param checkpoints is array of checkpoints from replayCheckpoints().
+   @param ply is number of moves to have played, at most the saved game's number of moves.
+*/
+static void replaySeek( const game* g, game* replayGame, const checkpoint* checkpoints,
+                        size_t ply )
+{
+    // Forward from where the replay is when that is closer than the checkpoint.
+    size_t from = ply / GAME_REPLAY_CHECKPOINT * GAME_REPLAY_CHECKPOINT;
+    if ( replayGame->moves_count > ply || replayGame->moves_count < from ) {
+        const checkpoint *c = &checkpoints[ ply / GAME_REPLAY_CHECKPOINT ];
+        memcpy( replayGame->board->grid, c->grid, g->board->size * g->board->size );
+        replayGame->stone = c->stone;
+        replayGame->state = c->state;
+        replayGame->winner = c->winner;
+        replayGame->moves_count = from;
+    }
+    for ( size_t i = replayGame->moves_count; i < ply; i++ ) {
+        game_place_stone( replayGame, g->moves[i].x, g->moves[i].y );
+    }
+}
+
+/**
+   Shows a replay: its board, how the game ended once at the last move, and the last
+   REPLAY_LIST_ROWS rows of the moves so far.
+   @param g is pointer to the saved game.
+   @param replayGame is pointer to the replay game.
+*/
+static void replayShow( const game* g, game* replayGame )
+{
+    // Print latest board of replayGame
+    board_redraw( &replayGame->view, replayGame->board );
+    size_t shown = replayGame->moves_count;
+    
+    // Print out winner, draw or stopped state on last move only.
+    if ( shown == g->moves_count && shown > 0 ) {
+        printOutcome( replayGame );
+    }
+    
+    // Moves list, only its last rows so every move shown prints the same amount. Formatted into
+    // one buffer and printed at once.
+    char list[ REPLAY_LIST_LENGTH ];
+    size_t rows = ( shown + 1 ) / 2;
+    size_t first = rows > REPLAY_LIST_ROWS ? ( rows - REPLAY_LIST_ROWS ) * 2 : 0;
+    int length = sprintf( list, "Moves:\n" );
+    if ( first > 0 ) {
+        length += sprintf( list + length, "(%zu earlier moves)\n", first );
+    }
+    for ( size_t j = first; j < shown; j++ ) {
+        // Set up formal coordinates for output                                         
+        char formal_coord[ MAX_STRING_LENGTH + 1 ];
+        board_formal_coord( replayGame->board, g->moves[j].x, g->moves[j].y, formal_coord );
+        
+        // Even moves are always Black. Newline if White or last piece shown.
+        length += sprintf( list + length, "%s%3s%s", j % 2 == 0 ? "Black: " : "  White: ",
+                           formal_coord, j % 2 != 0 || j == shown - 1 ? "\n" : "" );
+    }
+    fwrite( list, 1, length, stdout );
+}
+
 /** 
    Check if there is a win on a vertical/column for current stone/player.
    @param g is pointer to current game struct.
@@ -361,12 +728,13 @@ static bool diagonalUpWin( game *g, unsigned char x, unsigned char y )
     
     // Get bottom most row/column based on last placed stone. Increment row and decrement column 
     // until bottom of board is reached.
-    while ( y < g->board->size && x > 0 ) {
+    while ( y < g->board->size - 1 && x > 0 ) {
         y++;
         x--;
     }
-    // Loop up diagonal counting connections until end of diagonal reached.
-    while ( y >= 0 && x < g->board->size ) {
+    // Loop up diagonal counting connections until end of diagonal reached. Row is unsigned, so
+    // stepping up from the top row wraps it past the board size.
+    while ( y < g->board->size && x < g->board->size ) {
         if ( board_get( g->board, x, y ) == g->stone ) {
             connections++;
             if ( connections == NEEDED_CONNECTIONS ) {
@@ -477,13 +845,14 @@ static void doubleOpenFours( game *g, unsigned char x, unsigned char y )
         // Reset temp variables for boardX/Y to be parameter placement point.
         boardX = x;
         boardY = y;  
-        while ( boardY < g->board->size && boardX > 0 ) {
+        while ( boardY < g->board->size - 1 && boardX > 0 ) {
             boardY++;
             boardX--;
         }
-        // Loop up diagonal counting connections until end of diagonal reached.
+        // Loop up diagonal counting connections until end of diagonal reached. Row is unsigned,
+        // so stepping up from the top row wraps it past the board size.
         connections = 0;
-        while ( boardY >= 0 && boardX < g->board->size ) {
+        while ( boardY < g->board->size && boardX < g->board->size ) {
             if ( board_get( g->board, boardX, boardY ) == g->stone ) {
                 connections++;
                 // Check if 4 connections. If so, check if spaces before/after 4 are empty.
@@ -583,12 +952,13 @@ static bool overline( game *g, unsigned char x, unsigned char y )
     // Reset temp variables for boardX/Y to be parameter placement point.
     boardX = x;
     boardY = y;  
-    while ( boardY < g->board->size && boardX > 0 ) {
+    while ( boardY < g->board->size - 1 && boardX > 0 ) {
         boardY++;
         boardX--;
     }
-    // Loop up diagonal counting connections until end of diagonal reached.
-    while ( boardY >= 0 && boardX < g->board->size ) {
+    // Loop up diagonal counting connections until end of diagonal reached. Row is unsigned, so
+    // stepping up from the top row wraps it past the board size.
+    while ( boardY < g->board->size && boardX < g->board->size ) {
         if ( board_get( g->board, boardX, boardY ) == g->stone ) {
             connections++;
             if ( connections == NEEDED_CONNECTIONS + 1 ) {
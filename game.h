@@ -10,6 +10,7 @@
 #define _GAME_H
 #include "board.h"
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 /** Represents Gomoku game*/
@@ -24,6 +25,10 @@
 #define GAME_STATE_STOPPED 2
 /** Game state set to finished */
 #define GAME_STATE_FINISHED 3
+/** Pause after each move of a replay at normal speed, in milliseconds */
+#define GAME_REPLAY_MILLIS 1000
+/** Moves between the checkpoints a replay keeps for seeking */
+#define GAME_REPLAY_CHECKPOINT 16
 
 /**
    x and y are horizontal (column) and vertical (row) coordinates on a board. Origin is the top 
@@ -36,6 +41,38 @@ typedef struct {
     unsigned char stone;
 } move;
 
+/** Game struct, declared early so callbacks can take a pointer to it */
+typedef struct game game;
+
+/**
+   Callback that picks the next move for a computer controlled player. Stores the chosen
+   horizontal and vertical coordinates in x and y.
+   @param g is pointer to primary game struct.
+   @param context is the engine_context field of the game.
+   @param x is pointer to x/horizontal coordinate.
+   @param y is pointer to y/vertical coordinate.
+   @return is true if a move was chosen, false if no move is available.
+*/
+typedef bool (*move_source)( game* g, void* context, unsigned char* x, unsigned char* y );
+
+/**
+   Callback told when a human player starts and stops thinking about a move, so the computer
+   player can search in the background meanwhile.
+   @param g is pointer to primary game struct.
+   @param context is the engine_context field of the game.
+   @param start is true when the human starts thinking, false once the move has been entered.
+*/
+typedef void (*ponder_hook)( game* g, void* context, bool start );
+
+/**
+   Callback told about every move game_place_stone() places, once the game's state and winner
+   have been updated, so the move can be recorded as it is played.
+   @param g is pointer to primary game struct.
+   @param context is the record_context field of the game.
+   @param m is pointer to the move, the last one in the game's moves.
+*/
+typedef void (*move_hook)( game* g, void* context, const move* m );
+
 /**
    Fields are described as follows:
    board - pointer to a board struct for the current board.
@@ -47,8 +84,18 @@ typedef struct {
    moves - dynamically allocated array of moves, stores moves made so far.
    moves_count - stores how many moves stored in moves.
    moves_capacity - stores current max number of moves that can be stored in moves.
+   engine - move source for the computer controlled player, NULL if both players are human.
+   engine_context - passed to engine on every call.
+   engine_stone - which player the engine moves for. (BLACK_STONE or WHITE_STONE)
+   ponder - called around the human player's input while an engine is set, NULL if unused.
+   quiet - true if game_place_stone() should not print messages or the board. Used when stdout
+           belongs to a program rather than a person.
+   record - called for every move game_place_stone() places, NULL if moves are not recorded.
+   record_context - passed to record on every call.
+   view - what the terminal shows of the board, so game_loop() and game_replay() only redraw
+          what changed.
 */
-typedef struct {
+struct game {
     board* board;
     unsigned char type;
     unsigned char stone;
@@ -57,7 +104,15 @@ typedef struct {
     move* moves;
     size_t moves_count;
     size_t moves_capacity;
-} game;
+    move_source engine;
+    void* engine_context;
+    unsigned char engine_stone;
+    ponder_hook ponder;
+    bool quiet;
+    move_hook record;
+    void* record_context;
+    board_view view;
+};
 
 /**
    Creates and returns a new dynamically allocated game struct of the specified game type with
@@ -68,6 +123,17 @@ typedef struct {
 */
 game* game_create(unsigned char board_size, unsigned char game_type);
 
+/**
+   Reuses a game struct for a new game of the specified board size and game type, as if it had
+   just been created, except that the engine, ponder and record fields are kept. Nothing is
+   allocated: the game must have been created with a board size at least as large, and its moves
+   array is grown once to hold a full board of that size if it can't already.
+   @param g is pointer to primary game struct.
+   @param board_size is size of board.
+   @param game_type is type of game being played.
+*/
+void game_reset(game* g, unsigned char board_size, unsigned char game_type);
+
 /**
    Frees memory of dynamically allocated game struct. Also frees memory of all dynamically
    allocated game struct fields. Board is freed via board_delete().
@@ -78,9 +144,11 @@ void game_delete( game* g);
 
 /**
    Controls what happens in the game at each turn. Returns false immediately if game state is not
-   GAME_STATE_PLAYING. Otherwise, player is prompted to enter a move (re-prompt if player input is
-   invalid - out of bounds or bad format). If EOF is reached/entered, the game is stopped. Once a 
-   valid move is input, move is enacted through game_place_stone() and function returns true.
+   GAME_STATE_PLAYING. If it is the engine's turn, the move is taken from the engine instead of
+   the player (the game is stopped if the engine has no move). Otherwise, player is prompted to 
+   enter a move (re-prompt if player input is invalid - out of bounds or bad format). If EOF is
+   reached/entered, the game is stopped. Once a valid move is input, move is enacted through
+   game_place_stone() and function returns true.
    @param g is pointer to primary game struct.
    @return is false if game is not currently in playing state, otherwise true if valid move input.
 */
@@ -88,11 +156,26 @@ bool game_update( game* g);
 
 /**
    Controls game loop by printing current board and calling game_update(). Repeats until 
-   game_update() returns false.
+   game_update() returns false. Only the first board is drawn whole, after that only the
+   intersections that changed and the lines below the board are redrawn.
    @param g is pointer to primary game struct.
 */
 void game_loop( game* g);
 
+/**
+   Plays a game headless from a script of moves in formal coordinates separated by white space.
+   Nothing is printed while the moves are placed with game_place_stone(), and the game's engine,
+   if it has one, moves on its turn instead of the script. Once the script ends the game is
+   stopped if it is still playing, and the result is printed on one line. A stopped game is
+   resumed first; a game that has ended exits with error like in game_resume().
+   @param g is pointer to primary game struct.
+   @param script is stream of moves.
+   @return is SUCCESS, FORMAL_COORDINATE_ERR for a move that is not a coordinate, or
+           COORDINATE_ERR for a move on an occupied intersection or after the game ended. The
+           game stops at the bad move, which is reported on stderr.
+*/
+unsigned char game_script( game* g, FILE* script);
+
 /**
    Restarts the game loop for a saved game. If state of parameter game is not GAME_STATE_STOPPED,
    program exits with error. Also exits with error if game type does not match gomoku or renju. If
@@ -103,18 +186,34 @@ void game_resume( game* g);
 
 /**
    Replays a saved game. Creates a new game struct, and re-makes moves saved in parameter game.
-   There is a 1 second pause before making every move.
+   There is a GAME_REPLAY_MILLIS pause after every move. The board only redraws what changed,
+   and the moves list under it only shows its last rows, so each move prints about the same.
    @param g is pointer to primary game struct.
 */
 void game_replay( game* g);
 
+/**
+   Replays a saved game like game_replay(), starting at a chosen move and either pausing for a
+   chosen time after each move or stepping one command at a time. Stepping reads a line from
+   stdin after every move shown: an empty line goes forward one move, "b" back one move, a number
+   jumps to the position after that many moves, and "q" or EOF ends the replay. The whole game is
+   replayed once up front keeping a checkpoint every GAME_REPLAY_CHECKPOINT moves, so any move is
+   reached by replaying fewer than GAME_REPLAY_CHECKPOINT moves.
+   @param g is pointer to primary game struct.
+   @param start is number of moves in the first position shown, moved within the game.
+   @param millis is pause after each move in milliseconds, 0 for none. Unused when stepping.
+   @param stepping is true to step through the game by commands.
+*/
+void game_replay_from( game* g, size_t start, long millis, bool stepping);
+
 /**
    Enforces rules of game. Checks if desired intersection is already occupied, if so it prompts 
    the player and returns false. Checks if any win (or draw) conditions are met based on game type
    and rules, if so, move is saved, prompts player, changes game state accordingly, and returns 
    true. If game does not conclude based on move, then move is saved and returns true. Specified
    moves are placed at the end of the game.moves array, which when full, is reallocated and doubled
-   in size (game.moves_count and game.moves_capacity are updated accordingly).
+   in size (game.moves_count and game.moves_capacity are updated accordingly). The move is then
+   passed to the game's record hook, if it has one.
    @param g is pointer to primary game struct.
    @param x is horizontal coordinate.
    @param y is vertical coordinate.
@@ -122,4 +221,28 @@ void game_replay( game* g);
 */
 bool game_place_stone( game* g, unsigned char x, unsigned char y);
 
+/**
+   Places a stone without checking any rules, for moves known to be legal such as the moves of a
+   game this program saved. The move is saved like in game_place_stone(), and the stone to play
+   next always changes. State and winner are left alone, so they should be set by the caller.
+   Nothing is printed.
+   @param g is pointer to primary game struct.
+   @param x is horizontal coordinate.
+   @param y is vertical coordinate.
+   @return is false if the intersection is already occupied, true otherwise.
+*/
+bool game_add_stone( game* g, unsigned char x, unsigned char y);
+
+/**
+   Checks a game built with game_add_stone() against the rules: every move is replayed with
+   game_place_stone() on a new game in play, and the replay must place every move, with the
+   same stone, without ending early, and end with the game's state and winner. A replay that
+   has not ended matches a stopped game. Games saved by this program always pass.
+   @param g is pointer to primary game struct.
+   @param problem is buffer for a description of the first problem found, NULL if not needed.
+   @param length is size of the problem buffer.
+   @return is true if the rules agree with the game, false otherwise.
+*/
+bool game_verify( const game* g, char* problem, size_t length );
+
 #endif
@@ -0,0 +1,267 @@
+/**
+   @file gamedb.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for game databases.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "gamedb.h"
+#include "io.h"
+#include "error-codes.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Prototypes for static functions that open the database files.
+static char* indexPath( const char* path );
+static void* mapFile( const char* path, const char* magic, size_t* length );
+static bool startFile( FILE* stream, const char* magic, size_t* length );
+static size_t wholeGames( const gamedb_entry* entries, size_t count, size_t dataLength );
+
+// Map a database into memory.
+gamedb* gamedb_open( const char* path )
+{
+    size_t dataLength;
+    void *data = mapFile( path, GAMEDB_DATA_MAGIC, &dataLength );
+    if ( data == NULL ) {
+        return NULL;
+    }
+    char *index = indexPath( path );
+    size_t indexLength;
+    void *mapping = mapFile( index, GAMEDB_INDEX_MAGIC, &indexLength );
+    free( index );
+    if ( mapping == NULL ) {
+        munmap( data, dataLength );
+        return NULL;
+    }
+
+    // A partly written entry at the end is ignored, as are entries past the end of the data.
+    gamedb *db = ( gamedb * )malloc( sizeof( gamedb ) );
+    db->entries = ( const gamedb_entry * )( ( const gamedb_header * )mapping + 1 );
+    db->count = wholeGames( db->entries,
+                            ( indexLength - sizeof( gamedb_header ) ) / sizeof( gamedb_entry ),
+                            dataLength );
+    db->data = ( const unsigned char * )data;
+    db->data_length = dataLength;
+    db->index = mapping;
+    db->index_length = indexLength;
+    return db;
+}
+
+// Unmap and free a database.
+void gamedb_close( gamedb* db )
+{
+    if ( db == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    munmap( ( void * )db->data, db->data_length );
+    munmap( db->index, db->index_length );
+    free( db );
+}
+
+// Find a game's bytes in the data file.
+const unsigned char* gamedb_record( const gamedb* db, size_t id )
+{
+    return db->data + db->entries[ id ].offset;
+}
+
+// Read one move of a game in place.
+unsigned short gamedb_move( const gamedb* db, size_t id, size_t ply )
+{
+    return game_binary_move( gamedb_record( db, id ), ply );
+}
+
+// Rebuild a game from the database.
+game* gamedb_game( const gamedb* db, size_t id, unsigned char* status )
+{
+    return game_decode( gamedb_record( db, id ), db->entries[ id ].length, true, status );
+}
+
+// Open a database for adding games.
+gamedb_writer* gamedb_writer_open( const char* path )
+{
+    char *index = indexPath( path );
+    FILE *dataStream = fopen( path, "a+b" );
+    FILE *indexStream = fopen( index, "a+b" );
+    free( index );
+    size_t dataLength;
+    size_t indexLength;
+    if ( dataStream == NULL || indexStream == NULL ||
+         !startFile( dataStream, GAMEDB_DATA_MAGIC, &dataLength ) ||
+         !startFile( indexStream, GAMEDB_INDEX_MAGIC, &indexLength ) ) {
+        goto error;
+    }
+
+    // Find where the whole games end, reading the entries in order.
+    unsigned long long offset = sizeof( gamedb_header );
+    size_t count = 0;
+    gamedb_entry entry;
+    while ( fread( &entry, sizeof( entry ), 1, indexStream ) == 1 && entry.offset == offset &&
+            offset + entry.length <= dataLength ) {
+        offset += entry.length;
+        count++;
+    }
+
+    // Cut off anything past them. Writes always go to the end of the files after this.
+    if ( fseek( dataStream, 0, SEEK_END ) != 0 || fseek( indexStream, 0, SEEK_END ) != 0 ||
+         ftruncate( fileno( dataStream ), offset ) != 0 ||
+         ftruncate( fileno( indexStream ),
+                    sizeof( gamedb_header ) + count * sizeof( gamedb_entry ) ) != 0 ) {
+        goto error;
+    }
+
+    gamedb_writer *w = ( gamedb_writer * )malloc( sizeof( gamedb_writer ) );
+    w->data = dataStream;
+    w->index = indexStream;
+    w->offset = offset;
+    return w;
+
+    error:
+    if ( dataStream != NULL ) {
+        fclose( dataStream );
+    }
+    if ( indexStream != NULL ) {
+        fclose( indexStream );
+    }
+    return NULL;
+}
+
+// Add a game to the end of a database.
+unsigned char gamedb_writer_add( gamedb_writer* w, const game* g )
+{
+    unsigned char data[ GAME_BINARY_MAX_LENGTH ];
+    size_t length = game_encode( g, data );
+    gamedb_entry entry;
+    memset( &entry, 0, sizeof( entry ) );
+    entry.offset = w->offset;
+    entry.length = length;
+    entry.moves = g->moves_count;
+    entry.size = g->board->size;
+    entry.type = g->type;
+    entry.state = g->state;
+    entry.winner = g->winner;
+    if ( fwrite( data, 1, length, w->data ) != length ||
+         fwrite( &entry, sizeof( entry ), 1, w->index ) != 1 ) {
+        return FILE_OUTPUT_ERR;
+    }
+    w->offset += length;
+    return SUCCESS;
+}
+
+// Finish adding games.
+unsigned char gamedb_writer_close( gamedb_writer* w )
+{
+    if ( w == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    bool written = fclose( w->data ) == 0;
+    written = fclose( w->index ) == 0 && written;
+    free( w );
+    return written ? SUCCESS : FILE_OUTPUT_ERR;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Makes the path of a database's index file.
+   @param path is string for data file path location.
+   @return is allocated string for index file path location, freed by the caller.
+*/
+static char* indexPath( const char* path )
+{
+    char *index = ( char * )malloc( strlen( path ) + strlen( GAMEDB_INDEX_EXTENSION ) + 1 );
+    strcpy( index, path );
+    strcat( index, GAMEDB_INDEX_EXTENSION );
+    return index;
+}
+
+/**
+   Maps a whole database file read only and checks its header.
+   @param path is string for file path location.
+   @param magic is magic the file must start with.
+   @param length stores length of the file in bytes.
+   @return is start of the mapping, or NULL if the file can't be mapped or has the wrong header.
+*/
+static void* mapFile( const char* path, const char* magic, size_t* length )
+{
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        return NULL;
+    }
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || ( size_t )info.st_size < sizeof( gamedb_header ) ) {
+        close( fd );
+        return NULL;
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    void *mapping = mmap( NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( mapping == MAP_FAILED ) {
+        return NULL;
+    }
+    const gamedb_header *header = ( const gamedb_header * )mapping;
+    if ( memcmp( header->magic, magic, sizeof( header->magic ) ) != 0 ||
+         header->version != GAMEDB_VERSION ) {
+        munmap( mapping, info.st_size );
+        return NULL;
+    }
+    *length = info.st_size;
+    return mapping;
+}
+
+/**
+   Checks the header of a database file opened for appending, or writes it if the file is new.
+   The stream is left positioned just past the header.
+   @param stream is file stream opened with "a+b".
+   @param magic is magic the file must start with.
+   @param length stores length of the file in bytes.
+   @return is true if the file is ready, false if it has the wrong header or can't be written.
+*/
+static bool startFile( FILE* stream, const char* magic, size_t* length )
+{
+    if ( fseek( stream, 0, SEEK_END ) != 0 ) {
+        return false;
+    }
+    long end = ftell( stream );
+    gamedb_header header;
+    memset( &header, 0, sizeof( header ) );
+    if ( end == 0 ) {
+        memcpy( header.magic, magic, sizeof( header.magic ) );
+        header.version = GAMEDB_VERSION;
+        *length = sizeof( header );
+        return fwrite( &header, sizeof( header ), 1, stream ) == 1 && fflush( stream ) == 0;
+    }
+    *length = end;
+    return fseek( stream, 0, SEEK_SET ) == 0 &&
+           fread( &header, sizeof( header ), 1, stream ) == 1 &&
+           memcmp( header.magic, magic, sizeof( header.magic ) ) == 0 &&
+           header.version == GAMEDB_VERSION;
+}
+
+/**
+   Counts the games at the start of the index whose bytes are wholly inside the data file, one
+   after another from just past the data file header.
+   @param entries is array of index entries.
+   @param count is number of entries.
+   @param dataLength is length of the data file in bytes.
+   @return is number of leading entries that can be used.
+*/
+static size_t wholeGames( const gamedb_entry* entries, size_t count, size_t dataLength )
+{
+    unsigned long long offset = sizeof( gamedb_header );
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( entries[i].offset != offset || offset + entries[i].length > dataLength ) {
+            return i;
+        }
+        offset += entries[i].length;
+    }
+    return count;
+}
@@ -0,0 +1,160 @@
+/**
+   @file gamedb.h
+   @author Michael Warstler (mwwarstl)
+   Header file for game databases: many games kept in two append-only files instead of one file
+   per game. The data file is a small header followed by every game in binary "GB" format (see
+   io.h), back to back. The index file, named like the data file plus GAMEDB_INDEX_EXTENSION, is
+   a small header followed by one fixed size entry per game, so game n is found without reading
+   anything else. Both files are opened with mmap, and the moves of a game are read straight
+   from the mapped data. Numbers in the headers and entries are stored in the byte order of the
+   machine that wrote the database.
+   An index entry only counts once its game is wholly inside the data file, so a database cut
+   short by a crash only loses the games that were still being added. Only one writer may add
+   to a database at a time.
+*/
+
+#ifndef _GAMEDB_H_
+#define _GAMEDB_H_
+#include "game.h"
+#include <stdio.h>
+#include <stddef.h>
+
+/** First bytes of every data file */
+#define GAMEDB_DATA_MAGIC "GDB1"
+/** First bytes of every index file */
+#define GAMEDB_INDEX_MAGIC "GDX1"
+/** Current database version */
+#define GAMEDB_VERSION 1
+/** Added to the data file path to make the index file path */
+#define GAMEDB_INDEX_EXTENSION ".idx"
+
+/**
+   Header at the start of the data file and of the index file.
+   magic - GAMEDB_DATA_MAGIC or GAMEDB_INDEX_MAGIC, without a null terminator.
+   version - GAMEDB_VERSION.
+*/
+typedef struct {
+    char magic[4];
+    unsigned int version;
+} gamedb_header;
+
+/**
+   Index entry of one game. Fields are described as follows:
+   offset - where the game starts in the data file, in bytes.
+   length - length of the game in the data file, in bytes.
+   moves - number of moves played.
+   size - board size.
+   type - game type. (GAME_FREESTYLE or GAME_RENJU)
+   state - state the game was saved in.
+   winner - stone of the winner, EMPTY_INTERSECTION if none.
+*/
+typedef struct {
+    unsigned long long offset;
+    unsigned short length;
+    unsigned short moves;
+    unsigned char size;
+    unsigned char type;
+    unsigned char state;
+    unsigned char winner;
+} gamedb_entry;
+
+/**
+   An open database. Fields are described as follows:
+   entries - mapped array of index entries, one per game in the order they were added.
+   count - number of games.
+   data - start of the mapped data file.
+   data_length - length of the mapped data file in bytes.
+   index - start of the mapped index file.
+   index_length - length of the mapped index file in bytes.
+*/
+typedef struct {
+    const gamedb_entry* entries;
+    size_t count;
+    const unsigned char* data;
+    size_t data_length;
+    void* index;
+    size_t index_length;
+} gamedb;
+
+/**
+   A database open for adding games. Fields are described as follows:
+   data - stream appending to the data file.
+   index - stream appending to the index file.
+   offset - length of the data file, where the next game goes.
+*/
+typedef struct {
+    FILE* data;
+    FILE* index;
+    unsigned long long offset;
+} gamedb_writer;
+
+/**
+   Opens a database with mmap. Index entries whose game is not wholly inside the data file (the
+   database was cut short while adding) are left out.
+   @param path is string for data file path location.
+   @return is pointer to database, or NULL if the files are missing or are not a database.
+*/
+gamedb* gamedb_open( const char* path );
+
+/**
+   Unmaps the database files and frees the database.
+   If parameter is NULL, program exits with error.
+   @param db is pointer to database.
+*/
+void gamedb_close( gamedb* db );
+
+/**
+   Gives the game's bytes inside the mapped data file. They are in binary format and can be
+   passed on to game_decode() or game_binary_move().
+   @param db is pointer to database.
+   @param id is number of the game, below db->count.
+   @return is start of the game in binary format.
+*/
+const unsigned char* gamedb_record( const gamedb* db, size_t id );
+
+/**
+   Reads one move of a game in place, without building the game.
+   @param db is pointer to database.
+   @param id is number of the game, below db->count.
+   @param ply is number of the move, below the game's number of moves.
+   @return is intersection index of the move, y * size + x.
+*/
+unsigned short gamedb_move( const gamedb* db, size_t id, size_t ply );
+
+/**
+   Rebuilds a whole game from the database. The game's checksum and moves are checked, but
+   games in a database are trusted, so rules are not (see game_load()).
+   @param db is pointer to database.
+   @param id is number of the game, below db->count.
+   @param status stores SUCCESS, FILE_INPUT_ERR if the stored game is damaged, or
+                 COORDINATE_ERR if it repeats an intersection.
+   @return is pointer to primary game struct, or NULL on error.
+*/
+game* gamedb_game( const gamedb* db, size_t id, unsigned char* status );
+
+/**
+   Opens a database for adding games, creating it if it does not exist. Anything left past the
+   last whole game by an earlier crash is cut off first.
+   @param path is string for data file path location.
+   @return is pointer to writer, or NULL if the files can't be opened or are not a database.
+*/
+gamedb_writer* gamedb_writer_open( const char* path );
+
+/**
+   Adds a game to the end of the database. Writes are buffered, so the game may not be in the
+   files before gamedb_writer_close().
+   @param w is pointer to writer.
+   @param g is pointer to primary game struct.
+   @return is SUCCESS, or FILE_OUTPUT_ERR if the game can't be written.
+*/
+unsigned char gamedb_writer_add( gamedb_writer* w, const game* g );
+
+/**
+   Writes out the data file, then the index file, and frees the writer.
+   If parameter is NULL, program exits with error.
+   @param w is pointer to writer.
+   @return is SUCCESS, or FILE_OUTPUT_ERR if the files can't be written.
+*/
+unsigned char gamedb_writer_close( gamedb_writer* w );
+
+#endif
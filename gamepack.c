@@ -0,0 +1,487 @@
+/**
+   @file gamepack.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for packed game archives. The range coder follows the well known LZMA
+   design: 11 bit probabilities that move 1/32 of the way towards each bit coded, a 32 bit
+   range kept above 2^24, and carries resolved through a held back byte.
+*/
+
+#include "gamepack.h"
+#include "board.h"
+#include "error-codes.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Bits of precision of a probability */
+#define PROBABILITY_BITS 11
+/** Probability of a certain bit */
+#define PROBABILITY_ONE ( 1 << PROBABILITY_BITS )
+/** Probabilities move 1 / 2^ADAPT_SHIFT of the way towards each bit coded */
+#define ADAPT_SHIFT 5
+/** The range is widened a byte at a time whenever it falls below this */
+#define RANGE_TOP ( 1u << 24 )
+/** Bytes the coder writes when it finishes, and reads when it starts */
+#define CODER_BYTES 5
+/** Length of the header: magic then version */
+#define HEADER_LENGTH 8
+/** Length of the trailer: number of games then checksum */
+#define TRAILER_LENGTH 12
+/** Modulus of the Adler-32 checksum */
+#define ADLER_MODULUS 65521
+/** Size classes above this share the last model for the next rank */
+#define LAST_CLASS_MODEL 3
+
+/** Board sizes in the order they are coded */
+static const unsigned char SIZES[] = { BOARD_SIZE_15, BOARD_SIZE_17, BOARD_SIZE_19 };
+
+// Prototypes for static functions that run the range coder.
+static gamepack* startArchive( FILE* stream, bool writing );
+static int codeBit( gamepack* p, unsigned short* probability, int bit );
+static int codeTree( gamepack* p, unsigned short* probabilities, int bits, int value );
+static int codeRank( gamepack* p, int* lastClass, int rank );
+static void shiftLow( gamepack* p );
+static void writeCoded( gamepack* p, unsigned char byte );
+static unsigned char readCoded( gamepack* p );
+static void putNumber( unsigned char* bytes, unsigned long long value, int length );
+static unsigned long long getNumber( const unsigned char* bytes, int length );
+
+// Prototypes for static functions that rank moves.
+static void anchors( const move* moves, size_t ply, int size, int* anchor );
+static int walkEmpty( const unsigned char* occupied, int size, const int* anchor, int target,
+                      int rank );
+
+// Create a packed archive for writing.
+gamepack* gamepack_create( const char* path )
+{
+    FILE *stream = fopen( path, "wb" );
+    if ( stream == NULL ) {
+        return NULL;
+    }
+    unsigned char header[ HEADER_LENGTH ];
+    memcpy( header, GAMEPACK_MAGIC, strlen( GAMEPACK_MAGIC ) );
+    putNumber( header + strlen( GAMEPACK_MAGIC ), GAMEPACK_VERSION, 4 );
+    if ( fwrite( header, 1, HEADER_LENGTH, stream ) != HEADER_LENGTH ) {
+        fclose( stream );
+        return NULL;
+    }
+    return startArchive( stream, true );
+}
+
+// Add a game to a packed archive.
+unsigned char gamepack_add( gamepack* p, const game* g )
+{
+    // Each move is ranked among the empty intersections near the last two moves.
+    int size = g->board->size;
+    if ( g->moves_count > size * size ) {
+        return COORDINATE_ERR;
+    }
+    unsigned char occupied[ BOARD_SIZE_19 * BOARD_SIZE_19 ];
+    memset( occupied, 0, size * size );
+    int ranks[ BOARD_SIZE_19 * BOARD_SIZE_19 ];
+    for ( size_t i = 0; i < g->moves_count; i++ ) {
+        int anchor[4];
+        anchors( g->moves, i, size, anchor );
+        int index = g->moves[i].y * size + g->moves[i].x;
+        ranks[i] = walkEmpty( occupied, size, anchor, index, 0 );
+        if ( ranks[i] < 0 ) {
+            return COORDINATE_ERR;
+        }
+        occupied[ index ] = 1;
+    }
+
+    // Then the header and ranks are coded.
+    codeBit( p, &p->model.more, 1 );
+    codeTree( p, p->model.size, 2, size == BOARD_SIZE_15 ? 0 : size == BOARD_SIZE_17 ? 1 : 2 );
+    codeTree( p, p->model.type, 1, g->type );
+    codeTree( p, p->model.state, 2, g->state );
+    codeTree( p, p->model.winner, 2, g->winner );
+    codeTree( p, p->model.moves, 9, g->moves_count );
+    int lastClass = -1;
+    for ( size_t i = 0; i < g->moves_count; i++ ) {
+        codeRank( p, &lastClass, ranks[i] );
+    }
+    p->games++;
+    return p->failed ? FILE_OUTPUT_ERR : SUCCESS;
+}
+
+// Open a packed archive for reading.
+gamepack* gamepack_open( const char* path )
+{
+    FILE *stream = fopen( path, "rb" );
+    if ( stream == NULL ) {
+        return NULL;
+    }
+    unsigned char header[ HEADER_LENGTH ];
+    if ( fread( header, 1, HEADER_LENGTH, stream ) != HEADER_LENGTH ||
+         memcmp( header, GAMEPACK_MAGIC, strlen( GAMEPACK_MAGIC ) ) != 0 ||
+         getNumber( header + strlen( GAMEPACK_MAGIC ), 4 ) != GAMEPACK_VERSION ) {
+        fclose( stream );
+        return NULL;
+    }
+    gamepack *p = startArchive( stream, false );
+    for ( int i = 0; i < CODER_BYTES; i++ ) {
+        p->code = p->code << 8 | readCoded( p );
+    }
+    return p;
+}
+
+// Read the next game of a packed archive.
+bool gamepack_next( gamepack* p, game** g, unsigned char* status )
+{
+    *g = NULL;
+    *status = FILE_INPUT_ERR;
+    if ( p->failed ) {
+        return false;
+    }
+
+    // After the last game, the trailer must match what was read, and end the file.
+    if ( !codeBit( p, &p->model.more, 0 ) ) {
+        unsigned char trailer[ TRAILER_LENGTH ];
+        unsigned int sum = p->sum_high << 16 | p->sum_low;
+        if ( !p->failed && fread( trailer, 1, TRAILER_LENGTH, p->stream ) == TRAILER_LENGTH &&
+             getNumber( trailer, 8 ) == p->games && getNumber( trailer + 8, 4 ) == sum &&
+             fgetc( p->stream ) == EOF ) {
+            *status = SUCCESS;
+        }
+        p->failed = true;
+        return false;
+    }
+    int sizeIndex = codeTree( p, p->model.size, 2, 0 );
+    unsigned char type = codeTree( p, p->model.type, 1, 0 );
+    unsigned char state = codeTree( p, p->model.state, 2, 0 );
+    unsigned char winner = codeTree( p, p->model.winner, 2, 0 );
+    size_t count = codeTree( p, p->model.moves, 9, 0 );
+    if ( sizeIndex >= sizeof( SIZES ) || state == GAME_STATE_PLAYING ||
+         winner > WHITE_STONE || count > SIZES[ sizeIndex ] * SIZES[ sizeIndex ] ) {
+        p->failed = true;
+        return false;
+    }
+
+    // Moves are placed without rule checks, the coder already rules out occupied intersections.
+    int size = SIZES[ sizeIndex ];
+    game *current = game_create( size, type );
+    current->state = state;
+    current->winner = winner;
+    current->quiet = true;
+    unsigned char occupied[ BOARD_SIZE_19 * BOARD_SIZE_19 ];
+    memset( occupied, 0, size * size );
+    int lastClass = -1;
+    for ( size_t i = 0; i < count && !p->failed; i++ ) {
+        int anchor[4];
+        anchors( current->moves, i, size, anchor );
+        int rank = codeRank( p, &lastClass, 0 );
+        int index = rank < 0 ? -1 : walkEmpty( occupied, size, anchor, -1, rank );
+        if ( index < 0 ) {
+            p->failed = true;
+            break;
+        }
+        game_add_stone( current, index % size, index / size );
+        occupied[ index ] = 1;
+    }
+    if ( p->failed ) {
+        game_delete( current );
+        return false;
+    }
+    current->quiet = false;
+    p->games++;
+    *g = current;
+    *status = SUCCESS;
+    return true;
+}
+
+// Finish and close a packed archive.
+unsigned char gamepack_close( gamepack* p )
+{
+    if ( p == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    bool written = true;
+    if ( p->writing ) {
+        // No more games, then push every byte still held in the coder out.
+        codeBit( p, &p->model.more, 0 );
+        for ( int i = 0; i < CODER_BYTES; i++ ) {
+            shiftLow( p );
+        }
+        unsigned char trailer[ TRAILER_LENGTH ];
+        putNumber( trailer, p->games, 8 );
+        putNumber( trailer + 8, p->sum_high << 16 | p->sum_low, 4 );
+        written = !p->failed && fwrite( trailer, 1, TRAILER_LENGTH, p->stream ) == TRAILER_LENGTH;
+    }
+    written = fclose( p->stream ) == 0 && written;
+    free( p );
+    return written ? SUCCESS : FILE_OUTPUT_ERR;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Creates a packed archive with a fresh model and coder for a stream past the header.
+   @param stream is file stream of the archive.
+   @param writing is true to add games, false to read them.
+   @return is pointer to packed archive.
+*/
+static gamepack* startArchive( FILE* stream, bool writing )
+{
+    gamepack *p = ( gamepack * )malloc( sizeof( gamepack ) );
+    p->stream = stream;
+    p->writing = writing;
+
+    // The model holds nothing but probabilities, and each starts out even.
+    unsigned short *probabilities = ( unsigned short * )&p->model;
+    for ( size_t i = 0; i < sizeof( gamepack_model ) / sizeof( unsigned short ); i++ ) {
+        probabilities[i] = PROBABILITY_ONE / 2;
+    }
+    p->low = 0;
+    p->range = 0xFFFFFFFF;
+    p->code = 0;
+    p->cache = 0;
+    p->pending = 1;
+    p->sum_low = 1;
+    p->sum_high = 0;
+    p->games = 0;
+    p->failed = false;
+    return p;
+}
+
+/**
+   Codes one bit and adapts its probability. Writing and reading walk the model the same way, so
+   the functions coding whole values serve both.
+   @param p is pointer to packed archive.
+   @param probability is pointer to the probability that the bit is 0.
+   @param bit is bit to write, ignored when reading.
+   @return is bit written or read.
+*/
+static int codeBit( gamepack* p, unsigned short* probability, int bit )
+{
+    unsigned int bound = ( p->range >> PROBABILITY_BITS ) * *probability;
+    if ( !p->writing ) {
+        bit = p->code >= bound;
+    }
+    if ( bit == 0 ) {
+        p->range = bound;
+        *probability += ( PROBABILITY_ONE - *probability ) >> ADAPT_SHIFT;
+    }
+    else {
+        if ( p->writing ) {
+            p->low += bound;
+        }
+        else {
+            p->code -= bound;
+        }
+        p->range -= bound;
+        *probability -= *probability >> ADAPT_SHIFT;
+    }
+    while ( p->range < RANGE_TOP ) {
+        p->range <<= 8;
+        if ( p->writing ) {
+            shiftLow( p );
+        }
+        else {
+            p->code = p->code << 8 | readCoded( p );
+        }
+    }
+    return bit;
+}
+
+/**
+   Codes a value highest bit first, each bit with its own probability for every bit above it.
+   @param p is pointer to packed archive.
+   @param probabilities is array of 2^bits probabilities.
+   @param bits is number of bits in the value.
+   @param value is value to write, ignored when reading.
+   @return is value written or read.
+*/
+static int codeTree( gamepack* p, unsigned short* probabilities, int bits, int value )
+{
+    int node = 1;
+    for ( int i = bits - 1; i >= 0; i-- ) {
+        node = node * 2 + codeBit( p, &probabilities[ node ], ( value >> i ) & 1 );
+    }
+    return node - ( 1 << bits );
+}
+
+/**
+   Codes the rank of a move as its size class, the number of bits in rank + 1 after the top one,
+   then those bits. The model for the class depends on the previous rank's class, since moves
+   far from the last ones tend to come together.
+   @param p is pointer to packed archive.
+   @param lastClass is size class of the previous rank, -1 for the first move, updated.
+   @param rank is rank to write, ignored when reading.
+   @return is rank written or read, or -1 if the archive is damaged.
+*/
+static int codeRank( gamepack* p, int* lastClass, int rank )
+{
+    int model = *lastClass < 0 ? 0 : 1 + ( *lastClass < LAST_CLASS_MODEL ? *lastClass :
+                                                                          LAST_CLASS_MODEL );
+    int value = rank + 1;
+    int sizeClass = 0;
+    while ( value >> ( sizeClass + 1 ) != 0 ) {
+        sizeClass++;
+    }
+    sizeClass = codeTree( p, p->model.classes[ model ], 4, sizeClass );
+    if ( sizeClass >= GAMEPACK_CLASSES ) {
+        p->failed = true;
+        return -1;
+    }
+    int low = codeTree( p, p->model.low[ sizeClass ], sizeClass, value - ( 1 << sizeClass ) );
+    *lastClass = sizeClass;
+    return ( 1 << sizeClass ) + low - 1;
+}
+
+/**
+   Moves the top byte of the range's start out of the coder. The byte is held back while a carry
+   could still reach it, along with any 0xFF bytes after it.
+   @param p is pointer to packed archive being written.
+*/
+static void shiftLow( gamepack* p )
+{
+    if ( p->low < 0xFF000000ULL || p->low > 0xFFFFFFFFULL ) {
+        unsigned char carry = p->low >> 32;
+        unsigned char held = p->cache;
+        do {
+            writeCoded( p, held + carry );
+            held = 0xFF;
+        } while ( --p->pending != 0 );
+        p->cache = ( p->low >> 24 ) & 0xFF;
+    }
+    p->pending++;
+    p->low = ( p->low & 0x00FFFFFF ) << 8;
+}
+
+/**
+   Writes one coded byte and adds it to the checksum.
+   @param p is pointer to packed archive being written.
+   @param byte is byte to write.
+*/
+static void writeCoded( gamepack* p, unsigned char byte )
+{
+    if ( putc( byte, p->stream ) == EOF ) {
+        p->failed = true;
+    }
+    p->sum_low = ( p->sum_low + byte ) % ADLER_MODULUS;
+    p->sum_high = ( p->sum_high + p->sum_low ) % ADLER_MODULUS;
+}
+
+/**
+   Reads one coded byte and adds it to the checksum. Reading past the end marks the archive as
+   damaged.
+   @param p is pointer to packed archive being read.
+   @return is byte read, 0 past the end.
+*/
+static unsigned char readCoded( gamepack* p )
+{
+    int byte = getc( p->stream );
+    if ( byte == EOF ) {
+        p->failed = true;
+        return 0;
+    }
+    p->sum_low = ( p->sum_low + byte ) % ADLER_MODULUS;
+    p->sum_high = ( p->sum_high + p->sum_low ) % ADLER_MODULUS;
+    return byte;
+}
+
+/**
+   Stores a number little endian.
+   @param bytes is buffer of at least length bytes.
+   @param value is number to store.
+   @param length is number of bytes to store.
+*/
+static void putNumber( unsigned char* bytes, unsigned long long value, int length )
+{
+    for ( int i = 0; i < length; i++ ) {
+        bytes[i] = value >> ( 8 * i );
+    }
+}
+
+/**
+   Loads a little endian number.
+   @param bytes is buffer of at least length bytes.
+   @param length is number of bytes to load.
+   @return is number loaded.
+*/
+static unsigned long long getNumber( const unsigned char* bytes, int length )
+{
+    unsigned long long value = 0;
+    for ( int i = 0; i < length; i++ ) {
+        value |= ( unsigned long long )bytes[i] << ( 8 * i );
+    }
+    return value;
+}
+
+/**
+   Finds the two intersections a move is ranked around: the last move and the one before it.
+   The second move has only one, and the first is ranked around the center.
+   @param moves is array of the moves played so far.
+   @param ply is number of the move to rank.
+   @param size is board size.
+   @param anchor stores x and y of the first anchor, then x and y of the second.
+*/
+static void anchors( const move* moves, size_t ply, int size, int* anchor )
+{
+    const move *first = ply >= 1 ? &moves[ ply - 1 ] : NULL;
+    const move *second = ply >= 2 ? &moves[ ply - 2 ] : first;
+    anchor[0] = first != NULL ? first->x : size / 2;
+    anchor[1] = first != NULL ? first->y : size / 2;
+    anchor[2] = second != NULL ? second->x : anchor[0];
+    anchor[3] = second != NULL ? second->y : anchor[1];
+}
+
+/**
+   Walks the empty intersections in rank order: by distance (the larger of the column and row
+   differences) from the nearer anchor, ring by ring, with intersections as near to both anchors
+   ranked with the first one. Finds either the rank of an intersection or the intersection of a
+   rank.
+   @param occupied is array of size * size flags, nonzero for intersections with a stone.
+   @param size is board size.
+   @param anchor is x and y of the first anchor, then x and y of the second.
+   @param target is index (y * size + x) of the intersection to rank, or -1 to find rank instead.
+   @param rank is rank of the intersection to find, when target is -1.
+   @return is rank of target, or index of the intersection with rank rank, or -1 if there is none.
+*/
+static int walkEmpty( const unsigned char* occupied, int size, const int* anchor, int target,
+                      int rank )
+{
+    bool same = anchor[0] == anchor[2] && anchor[1] == anchor[3];
+    int count = 0;
+    for ( int distance = 0; distance < size; distance++ ) {
+        for ( int a = 0; a < ( same ? 1 : 2 ); a++ ) {
+            int centerX = anchor[ 2 * a ];
+            int centerY = anchor[ 2 * a + 1 ];
+            int otherX = anchor[ 2 - 2 * a ];
+            int otherY = anchor[ 3 - 2 * a ];
+            for ( int y = centerY - distance; y <= centerY + distance; y++ ) {
+                if ( y < 0 || y >= size ) {
+                    continue;
+                }
+
+                // Top and bottom rows of the ring are whole, the rows between only have ends.
+                bool edge = y == centerY - distance || y == centerY + distance;
+                for ( int x = centerX - distance; x <= centerX + distance;
+                      x += edge ? 1 : 2 * distance ) {
+                    int index = y * size + x;
+                    if ( x < 0 || x >= size || occupied[ index ] ) {
+                        continue;
+                    }
+                    int dx = abs( x - otherX );
+                    int dy = abs( y - otherY );
+                    int other = dx > dy ? dx : dy;
+                    if ( !same && ( other < distance || ( a == 1 && other == distance ) ) ) {
+                        continue;
+                    }
+                    if ( index == target ) {
+                        return count;
+                    }
+                    if ( target < 0 && count == rank ) {
+                        return index;
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,132 @@
+/**
+   @file gamepack.h
+   @author Michael Warstler (mwwarstl)
+   Header file for packed game archives: many games compressed into one file that is written and
+   read front to back. Stones are usually played close to the last few stones, so each move is
+   stored as its rank among the empty intersections ordered by distance from the last two moves
+   (the nearest first), and ranks and game headers go through an adaptive binary range coder.
+   The model keeps learning from one game to the next, so games can't be read out of order.
+   A packed archive is the GAMEPACK_MAGIC and version, the coded games, then a trailer with the
+   number of games and an Adler-32 checksum of the coded bytes, which catch a damaged or cut
+   short archive. Numbers in the header and trailer are little endian.
+*/
+
+#ifndef _GAMEPACK_H_
+#define _GAMEPACK_H_
+#include "game.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stddef.h>
+
+/** First bytes of every packed archive */
+#define GAMEPACK_MAGIC "GPK1"
+/** Current packed archive version */
+#define GAMEPACK_VERSION 1
+/** Number of probabilities for a value of up to 9 bits coded as a bit tree */
+#define GAMEPACK_TREE_NINE 512
+/** Number of probabilities for a value of up to 4 bits coded as a bit tree */
+#define GAMEPACK_TREE_FOUR 16
+/** Number of models for the size class of a rank: the first move, then by the last class */
+#define GAMEPACK_CLASS_MODELS 5
+/** Number of rank size classes: rank + 1 is below 2, 4, 8, ..., 512 */
+#define GAMEPACK_CLASSES 9
+/** Number of probabilities for the low bits of a rank in its largest size class */
+#define GAMEPACK_LOW_BITS 256
+
+/**
+   Adaptive probabilities that the next bit is 0, for every decision the coder makes. Fields are
+   described as follows:
+   more - another game follows.
+   size - board size, as 0 for 15x15, 1 for 17x17 and 2 for 19x19.
+   type - game type.
+   state - game state.
+   winner - stone of the winner.
+   moves - number of moves.
+   classes - size class of each rank, by model.
+   low - bits of each rank below its size class's top bit, by size class.
+*/
+typedef struct {
+    unsigned short more;
+    unsigned short size[ GAMEPACK_TREE_FOUR ];
+    unsigned short type[ GAMEPACK_TREE_FOUR ];
+    unsigned short state[ GAMEPACK_TREE_FOUR ];
+    unsigned short winner[ GAMEPACK_TREE_FOUR ];
+    unsigned short moves[ GAMEPACK_TREE_NINE ];
+    unsigned short classes[ GAMEPACK_CLASS_MODELS ][ GAMEPACK_TREE_FOUR ];
+    unsigned short low[ GAMEPACK_CLASSES ][ GAMEPACK_LOW_BITS ];
+} gamepack_model;
+
+/**
+   A packed archive open for writing or reading. Fields are described as follows:
+   stream - file stream of the archive.
+   writing - true if games are being added, false if they are being read.
+   model - probabilities, the same on both sides after the same games.
+   low - start of the coder's range while writing.
+   range - width of the coder's range.
+   code - position inside the range while reading.
+   cache - byte held back while writing until a carry into it is ruled out.
+   pending - number of bytes held back, the cache followed by 0xFF bytes.
+   sum_low - low half of the Adler-32 checksum of the coded bytes.
+   sum_high - high half of the Adler-32 checksum of the coded bytes.
+   games - number of games written or read.
+   failed - true if the archive is damaged, or can't be read or written.
+*/
+typedef struct {
+    FILE* stream;
+    bool writing;
+    gamepack_model model;
+    unsigned long long low;
+    unsigned int range;
+    unsigned int code;
+    unsigned char cache;
+    unsigned long long pending;
+    unsigned int sum_low;
+    unsigned int sum_high;
+    unsigned long long games;
+    bool failed;
+} gamepack;
+
+/**
+   Creates a new packed archive for adding games, replacing any file at path.
+   @param path is string for archive path location.
+   @return is pointer to packed archive, or NULL if the file can't be written.
+*/
+gamepack* gamepack_create( const char* path );
+
+/**
+   Adds a game to the end of a packed archive.
+   @param p is pointer to packed archive created with gamepack_create().
+   @param g is pointer to primary game struct.
+   @return is SUCCESS, COORDINATE_ERR if the game repeats an intersection (nothing is added), or
+           FILE_OUTPUT_ERR if the archive can't be written.
+*/
+unsigned char gamepack_add( gamepack* p, const game* g );
+
+/**
+   Opens a packed archive for reading its games in order.
+   @param path is string for archive path location.
+   @return is pointer to packed archive, or NULL if the file is missing or is not a packed archive.
+*/
+gamepack* gamepack_open( const char* path );
+
+/**
+   Reads the next game of a packed archive. Moves are placed without rule checks like a trusted
+   game_load(), and game_verify() replays them with the rules to check them. The end of the
+   archive is only reached once its trailer has been checked.
+   @param p is pointer to packed archive opened with gamepack_open().
+   @param g stores pointer to the game.
+   @param status stores SUCCESS, or FILE_INPUT_ERR if the archive is damaged or cut short.
+   @return is true if a game was read, false at the end of the archive or on error.
+*/
+bool gamepack_next( gamepack* p, game** g, unsigned char* status );
+
+/**
+   Closes a packed archive and frees it. An archive being written is finished first by writing
+   out the coder's last bytes and the trailer.
+   If parameter is NULL, program exits with error.
+   @param p is pointer to packed archive.
+   @return is SUCCESS, or FILE_OUTPUT_ERR if an archive being written could not be finished.
+*/
+unsigned char gamepack_close( gamepack* p );
+
+#endif
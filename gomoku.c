@@ -9,21 +9,26 @@
 #include "error-codes.h"
 #include "game.h"
 #include "io.h"      
+#include "engine.h"
+#include "journal.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>    
 
-/** How many command line arguments allowed at minimum */
-#define MIN_EXTRA_ARGUMENTS 2
 /** How many command line arguments allowed at maximum */
-#define MAX_EXTRA_ARGUMENTS 4
+#define MAX_EXTRA_ARGUMENTS 12
 
 /**
    Main function takes in command line arguments to see if game should be saved to file location,
    resumed from previous session, or created new with custom grid size. If too many or conflicting
    arguments are detected, program closes with error. Allowed key arguments include "-o" followed by
-   a path location, "-r" followed by a path location, and "-b" followed by the number 15/17/19. Key
-   arguments can be used together except for "-r" and "-b".
+   a path location, "-r" followed by a path location, "-b" followed by the number 15/17/19, "-e"
+   followed by "black" or "white" to let the computer play that stone, "-k" followed by the
+   path of an opening book for the computer, and "-j" followed by the path of a journal that
+   records every move as it is played, which "-r" can resume from after a crash, and "-s"
+   followed by the path of a move script ("-" for stdin) to play headless: the script's moves are
+   played without showing the board or prompting, then the result is printed. Key arguments can
+   be used together except for "-r" and "-b".
    @param argc are # of command line arguments.
    @param **argv is array of character pointers listing all arguments.
    @return is exit status
@@ -37,14 +42,18 @@ int main(int argc, char **argv)
     char *exportPath = NULL;
     char *importPath = NULL;
     unsigned char boardSize = 0;
+    unsigned char engineStone = EMPTY_INTERSECTION;
+    char *bookPath = NULL;
+    char *journalPath = NULL;
+    char *scriptPath = NULL;
     
-    // Check if total arguments is either 1, 3, or 5
-    if ( argc == 1 || argc == MIN_EXTRA_ARGUMENTS + 1 || argc == MAX_EXTRA_ARGUMENTS + 1 ) {
+    // Check if total arguments is either 1, 3, 5, 7, 9, 11 or 13
+    if ( argc % 2 == 1 && argc <= MAX_EXTRA_ARGUMENTS + 1 ) {
         // loop until 2nd to last argument. Increment by 2 to skip past a key argument's requirement.
         for ( int i = 1; i < argc - 1; i++ ) {
             char * keyArgument = argv[i];
             
-            // Check if one of the valid 3 options "-o", "-r", "-b"
+            // Check if one of the valid 7 options "-o", "-r", "-b", "-e", "-k", "-j", "-s"
             if ( strcmp( keyArgument, "-o" ) == 0 ) {
                 exportPath = argv[i + 1];
             }
@@ -74,6 +83,27 @@ int main(int argc, char **argv)
                     goto error; // line 87
                 }
             }
+            else if ( strcmp( keyArgument, "-e" ) == 0 ) {
+                // Computer plays the named stone.
+                if ( strcmp( argv[i + 1], "black" ) == 0 ) {
+                    engineStone = BLACK_STONE;
+                }
+                else if ( strcmp( argv[i + 1], "white" ) == 0 ) {
+                    engineStone = WHITE_STONE;
+                }
+                else {
+                    goto error; // line 87
+                }
+            }
+            else if ( strcmp( keyArgument, "-k" ) == 0 ) {
+                bookPath = argv[i + 1];
+            }
+            else if ( strcmp( keyArgument, "-j" ) == 0 ) {
+                journalPath = argv[i + 1];
+            }
+            else if ( strcmp( keyArgument, "-s" ) == 0 ) {
+                scriptPath = argv[i + 1];
+            }
             // Not allowed key argument
             else {
                 goto error; // line 87
@@ -86,14 +116,31 @@ int main(int argc, char **argv)
     else {
         error:
         printf("usage: ./gomoku [-r <unfinished-match.gmk>] [-o <saved-match.gmk>] [-b <15|17|19>]\n");
+        printf("       [-e <black|white>] [-k <opening-book>] [-j <journal.gmj>]\n");
+        printf("       [-s <move-script|->]\n");
         printf("       -r and -b conflicts with each other\n");
         exit( ARGUMENT_ERR );
     }
     
-    // Resume game from existing file if possible.
+    // Set up computer player if requested.
+    engine *computer = NULL;
+    if ( engineStone != EMPTY_INTERSECTION ) {
+        computer = engine_create( ENGINE_MCTS, 0, ENGINE_DEFAULT_MILLIS );
+    }
+    book *openings = NULL;
+    if ( bookPath != NULL ) {
+        openings = book_open( bookPath );
+        if ( openings == NULL ) {
+            exit( FILE_INPUT_ERR );
+        }
+        if ( computer != NULL ) {
+            computer->book = openings;
+        }
+    }
+    
+    // Load game from existing file (or journal) if possible.
     if ( importPath != NULL ) {
         activeGame = game_import( importPath );
-        game_resume( activeGame );
     }
     // Otherwise create new game using either default or argument board size.
     else {
@@ -103,8 +150,41 @@ int main(int argc, char **argv)
         }
         // Otherwise create game with argument size.
         activeGame = game_create( boardSize, GAME_FREESTYLE );
-        
-        // Loop until game state no longer playing
+    }
+    if ( computer != NULL ) {
+        activeGame->engine = engine_move_source;
+        activeGame->engine_context = computer;
+        activeGame->engine_stone = engineStone;
+        activeGame->ponder = engine_ponder_hook;
+    }
+    
+    // Record every move from here on, after the moves the game already has.
+    journal *log = NULL;
+    if ( journalPath != NULL ) {
+        log = journal_open( activeGame, journalPath );
+        if ( log == NULL ) {
+            exit( FILE_OUTPUT_ERR );
+        }
+        activeGame->record = journal_record_hook;
+        activeGame->record_context = log;
+    }
+    
+    // Play a script headless, resume a loaded game, otherwise loop until game state no longer playing
+    unsigned char scriptStatus = SUCCESS;
+    if ( scriptPath != NULL ) {
+        FILE *script = strcmp( scriptPath, "-" ) == 0 ? stdin : fopen( scriptPath, "r" );
+        if ( script == NULL ) {
+            exit( FILE_INPUT_ERR );
+        }
+        scriptStatus = game_script( activeGame, script );
+        if ( script != stdin ) {
+            fclose( script );
+        }
+    }
+    else if ( importPath != NULL ) {
+        game_resume( activeGame );
+    }
+    else {
         while ( activeGame->state == GAME_STATE_PLAYING ) {
             game_loop( activeGame );
         } 
@@ -114,8 +194,22 @@ int main(int argc, char **argv)
     if ( exportPath != NULL ) {
         game_export( activeGame, exportPath );
     }
+    if ( log != NULL && journal_close( log ) != SUCCESS ) {
+        exit( FILE_OUTPUT_ERR );
+    }
     
-    // Delete game and exit.
+    // A script with a bad move still saves the moves played before it, then reports the error.
+    if ( scriptStatus != SUCCESS ) {
+        exit( scriptStatus );
+    }
+    
+    // Delete game and computer player, then exit.
     game_delete( activeGame );
+    if ( computer != NULL ) {
+        engine_delete( computer );
+    }
+    if ( openings != NULL ) {
+        book_close( openings );
+    }
     return SUCCESS;
 }
\ No newline at end of file
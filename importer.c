@@ -0,0 +1,452 @@
+/**
+   @file importer.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for importing games from RIF and PSQ archives.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "importer.h"
+#include "board.h"
+#include "error-codes.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** First word of every PSQ game */
+#define PSQ_HEADER "Piskvorky"
+/** Board size of every RIF game */
+#define RIF_BOARD_SIZE BOARD_SIZE_15
+/** Part of the (lower case) name of RIF rules that are played as freestyle games */
+#define RIF_FREESTYLE_RULE "gomoku"
+/** Row numbers stop growing past this, which is already off every board */
+#define MAX_ROW 100
+/** Returned when reading past the end of the archive */
+#define END_OF_ARCHIVE -1
+
+// Prototypes for static functions that read the archive and build the games.
+static int peekByte( importer* im );
+static int readByte( importer* im );
+static bool readLine( importer* im );
+static bool readTag( importer* im );
+static bool isTag( const char* tag, const char* name );
+static bool attribute( const char* tag, const char* name, char* value, size_t length );
+static bool nextRif( importer* im, game** g, unsigned char* status );
+static bool nextPsq( importer* im, game** g, unsigned char* status );
+static unsigned char readRifMoves( importer* im, game* g, unsigned char status );
+static void readRule( importer* im );
+static unsigned char playMove( game* g, int x, int y );
+static bool finishGame( game* current, unsigned char result, game** g, unsigned char* status );
+
+// Open an archive and find its format.
+importer* importer_open( const char* path, unsigned char type )
+{
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        return NULL;
+    }
+    importer *im = ( importer * )malloc( sizeof( importer ) );
+    im->fd = fd;
+    im->type = type;
+    memset( im->rule_types, GAME_RENJU, sizeof( im->rule_types ) );
+    im->games = 0;
+    im->failed = false;
+    im->held = false;
+    im->next = im->buffer;
+    im->end = im->buffer;
+
+    // Skip white space and any byte order mark. XML starts with a tag, PSQ with its header line.
+    int c;
+    while ( ( c = peekByte( im ) ) != END_OF_ARCHIVE && ( isspace( c ) || c >= 0x80 ) ) {
+        im->next++;
+    }
+    if ( c == '<' ) {
+        im->format = IMPORTER_FORMAT_RIF;
+        return im;
+    }
+    im->format = IMPORTER_FORMAT_PSQ;
+    im->held = readLine( im );
+    if ( im->held && strncmp( im->line, PSQ_HEADER, strlen( PSQ_HEADER ) ) == 0 ) {
+        return im;
+    }
+    importer_close( im );
+    return NULL;
+}
+
+// Read the next game of an archive.
+bool importer_next( importer* im, game** g, unsigned char* status )
+{
+    if ( im->format == IMPORTER_FORMAT_RIF ) {
+        return nextRif( im, g, status );
+    }
+    return nextPsq( im, g, status );
+}
+
+// Close an archive.
+void importer_close( importer* im )
+{
+    if ( im == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    close( im->fd );
+    free( im );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Looks at the next byte of the archive without reading past it, refilling the buffer if needed.
+   @param im is pointer to importer.
+   @return is next byte, or END_OF_ARCHIVE if there are no more or reading failed.
+*/
+static int peekByte( importer* im )
+{
+    if ( im->next == im->end ) {
+        ssize_t count = read( im->fd, im->buffer, IMPORTER_BUFFER_SIZE );
+        if ( count <= 0 ) {
+            im->failed = im->failed || count < 0;
+            return END_OF_ARCHIVE;
+        }
+        im->next = im->buffer;
+        im->end = im->buffer + count;
+    }
+    return *im->next;
+}
+
+/**
+   Reads the next byte of the archive.
+   @param im is pointer to importer.
+   @return is next byte, or END_OF_ARCHIVE if there are no more or reading failed.
+*/
+static int readByte( importer* im )
+{
+    int c = peekByte( im );
+    if ( c != END_OF_ARCHIVE ) {
+        im->next++;
+    }
+    return c;
+}
+
+/**
+   Reads one line into im->line, without its line ending. The end of a long line is dropped.
+   @param im is pointer to importer.
+   @return is true if a line was read, false at the end of the archive.
+*/
+static bool readLine( importer* im )
+{
+    size_t length = 0;
+    int c = readByte( im );
+    if ( c == END_OF_ARCHIVE ) {
+        return false;
+    }
+    for ( ; c != END_OF_ARCHIVE && c != '\n'; c = readByte( im ) ) {
+        if ( c != '\r' && length < IMPORTER_LINE_LENGTH - 1 ) {
+            im->line[ length++ ] = c;
+        }
+    }
+    im->line[ length ] = '\0';
+    return true;
+}
+
+/**
+   Reads the next XML tag into im->line, without its angle brackets. Text before the tag is
+   skipped. A '>' inside a quoted attribute value does not end the tag, and a comment only ends
+   at "-->". The end of a long tag is dropped.
+   @param im is pointer to importer.
+   @return is true if a tag was read, false at the end of the archive.
+*/
+static bool readTag( importer* im )
+{
+    int c;
+    while ( ( c = readByte( im ) ) != '<' ) {
+        if ( c == END_OF_ARCHIVE ) {
+            return false;
+        }
+    }
+    size_t length = 0;
+    int quote = 0;
+    int previous = 0;
+    int beforePrevious = 0;
+    while ( ( c = readByte( im ) ) != END_OF_ARCHIVE ) {
+        bool comment = length >= 3 && memcmp( im->line, "!--", 3 ) == 0;
+        bool closed = !comment || ( previous == '-' && beforePrevious == '-' );
+        if ( c == '>' && quote == 0 && closed ) {
+            im->line[ length ] = '\0';
+            return true;
+        }
+        if ( !comment && ( c == '"' || c == '\'' ) ) {
+            quote = quote == 0 ? c : quote == c ? 0 : quote;
+        }
+        if ( length < IMPORTER_LINE_LENGTH - 1 ) {
+            im->line[ length++ ] = c;
+        }
+        beforePrevious = previous;
+        previous = c;
+    }
+    return false;
+}
+
+/**
+   Checks the name of a tag.
+   @param tag is tag read by readTag().
+   @param name is name to look for, starting with '/' for a closing tag.
+   @return is true if the tag has that name.
+*/
+static bool isTag( const char* tag, const char* name )
+{
+    size_t length = strlen( name );
+    if ( strncmp( tag, name, length ) != 0 ) {
+        return false;
+    }
+    unsigned char after = tag[ length ];
+    return after == '\0' || after == '/' || isspace( after );
+}
+
+/**
+   Finds the value of an attribute of a tag.
+   @param tag is tag read by readTag().
+   @param name is name of the attribute.
+   @param value stores the value, null terminated and cut short to fit.
+   @param length is number of characters that fit in value, including the null terminator.
+   @return is true if the tag has the attribute.
+*/
+static bool attribute( const char* tag, const char* name, char* value, size_t length )
+{
+    // Skip the tag name, then go through each name="value" pair.
+    const char *next = tag;
+    while ( *next != '\0' && !isspace( ( unsigned char )*next ) ) {
+        next++;
+    }
+    while ( *next != '\0' ) {
+        while ( isspace( ( unsigned char )*next ) ) {
+            next++;
+        }
+        const char *start = next;
+        while ( *next != '\0' && *next != '=' && !isspace( ( unsigned char )*next ) ) {
+            next++;
+        }
+        size_t nameLength = next - start;
+        while ( isspace( ( unsigned char )*next ) || *next == '=' ) {
+            next++;
+        }
+        if ( *next != '"' && *next != '\'' ) {
+            if ( *next != '\0' ) {
+                next++;
+            }
+            continue;
+        }
+        char quote = *next++;
+        bool match = nameLength == strlen( name ) && strncmp( start, name, nameLength ) == 0;
+        size_t count = 0;
+        for ( ; *next != '\0' && *next != quote; next++ ) {
+            if ( match && count < length - 1 ) {
+                value[ count++ ] = *next;
+            }
+        }
+        if ( match ) {
+            value[ count ] = '\0';
+            return true;
+        }
+        if ( *next != '\0' ) {
+            next++;
+        }
+    }
+    return false;
+}
+
+/**
+   Reads the next game of a RIF archive. Rules are remembered as they are read.
+   @param im is pointer to importer.
+   @param g stores pointer to the game, or NULL if it can't be imported.
+   @param status stores reason the game can't be imported, SUCCESS otherwise.
+   @return is true if a game was read, false at the end of the archive.
+*/
+static bool nextRif( importer* im, game** g, unsigned char* status )
+{
+    game *current = NULL;
+    unsigned char result = SUCCESS;
+    while ( readTag( im ) ) {
+        if ( isTag( im->line, "rule" ) ) {
+            readRule( im );
+        }
+        else if ( isTag( im->line, "game" ) ) {
+            // A game that was never closed is dropped.
+            if ( current != NULL ) {
+                game_delete( current );
+            }
+            char value[ IMPORTER_LINE_LENGTH ];
+            int rule = attribute( im->line, "rule", value, sizeof( value ) ) ? atoi( value ) : 0;
+            current = game_create( RIF_BOARD_SIZE, rule >= 0 && rule < IMPORTER_MAX_RULES ?
+                                                   im->rule_types[ rule ] : GAME_RENJU );
+            current->quiet = true;
+            result = SUCCESS;
+            im->games++;
+            if ( im->line[ strlen( im->line ) - 1 ] == '/' ) {
+                return finishGame( current, result, g, status );
+            }
+        }
+        else if ( isTag( im->line, "move" ) && current != NULL ) {
+            result = readRifMoves( im, current, result );
+        }
+        else if ( isTag( im->line, "/game" ) && current != NULL ) {
+            return finishGame( current, result, g, status );
+        }
+    }
+
+    // A game cut short by the end of the archive is dropped.
+    if ( current != NULL ) {
+        game_delete( current );
+    }
+    *status = im->failed ? FILE_INPUT_ERR : SUCCESS;
+    return false;
+}
+
+/**
+   Reads the next game of a PSQ archive.
+   @param im is pointer to importer.
+   @param g stores pointer to the game, or NULL if it can't be imported.
+   @param status stores reason the game can't be imported, SUCCESS otherwise.
+   @return is true if a game was read, false at the end of the archive.
+*/
+static bool nextPsq( importer* im, game** g, unsigned char* status )
+{
+    // Skip to the next header line, which may have been read already.
+    while ( im->held || readLine( im ) ) {
+        im->held = false;
+        if ( strncmp( im->line, PSQ_HEADER, strlen( PSQ_HEADER ) ) != 0 ) {
+            continue;
+        }
+        int width = 0;
+        int height = 0;
+        sscanf( im->line + strlen( PSQ_HEADER ), " %dx%d", &width, &height );
+        im->games++;
+        unsigned char result = BOARD_SIZE_ERR;
+        game *current = NULL;
+        if ( width == height && ( width == BOARD_SIZE_15 || width == BOARD_SIZE_17 ||
+                                  width == BOARD_SIZE_19 ) ) {
+            current = game_create( width, im->type );
+            current->quiet = true;
+            result = SUCCESS;
+        }
+
+        // Every move line is read even after a bad one, the first other line ends the game.
+        while ( readLine( im ) ) {
+            int x;
+            int y;
+            if ( sscanf( im->line, "%d,%d", &x, &y ) != 2 ) {
+                im->held = true;
+                break;
+            }
+            if ( result == SUCCESS ) {
+                result = playMove( current, x - 1, y - 1 );
+            }
+        }
+        return finishGame( current, result, g, status );
+    }
+    *status = im->failed ? FILE_INPUT_ERR : SUCCESS;
+    return false;
+}
+
+/**
+   Reads and plays the text of a RIF <move> element: coordinates like "h8" separated by white
+   space, up to the next tag. After a bad move the rest are only read.
+   @param im is pointer to importer.
+   @param g is pointer to the game being imported.
+   @param status is SUCCESS if the game can still be imported.
+   @return is SUCCESS, or the reason the game can't be imported.
+*/
+static unsigned char readRifMoves( importer* im, game* g, unsigned char status )
+{
+    int c;
+    while ( ( c = peekByte( im ) ) != END_OF_ARCHIVE && c != '<' ) {
+        im->next++;
+        if ( isspace( c ) ) {
+            continue;
+        }
+
+        // A column letter, then the row number counted from the bottom.
+        int x = tolower( c ) - 'a';
+        int row = 0;
+        bool digits = false;
+        while ( ( c = peekByte( im ) ) != END_OF_ARCHIVE && isdigit( c ) ) {
+            im->next++;
+            row = row < MAX_ROW ? row * 10 + c - '0' : row;
+            digits = true;
+        }
+        if ( status == SUCCESS ) {
+            status = digits ? playMove( g, x, g->board->size - row ) : COORDINATE_ERR;
+        }
+    }
+    return status;
+}
+
+/**
+   Remembers the game type of a RIF <rule> element from its name.
+   @param im is pointer to importer, holding the tag.
+*/
+static void readRule( importer* im )
+{
+    char value[ IMPORTER_LINE_LENGTH ];
+    if ( !attribute( im->line, "id", value, sizeof( value ) ) ) {
+        return;
+    }
+    int id = atoi( value );
+    if ( id < 0 || id >= IMPORTER_MAX_RULES ||
+         !attribute( im->line, "name", value, sizeof( value ) ) ) {
+        return;
+    }
+    for ( char *next = value; *next != '\0'; next++ ) {
+        *next = tolower( ( unsigned char )*next );
+    }
+    im->rule_types[ id ] = strstr( value, RIF_FREESTYLE_RULE ) != NULL ? GAME_FREESTYLE :
+                                                                        GAME_RENJU;
+}
+
+/**
+   Plays one imported move with the rules.
+   @param g is pointer to the game being imported.
+   @param x is horizontal coordinate, possibly off the board.
+   @param y is vertical coordinate, possibly off the board.
+   @return is SUCCESS, or COORDINATE_ERR if the move is off the board, on an occupied
+           intersection, or after the game ended.
+*/
+static unsigned char playMove( game* g, int x, int y )
+{
+    if ( x < 0 || y < 0 || x >= g->board->size || y >= g->board->size ||
+         g->state != GAME_STATE_PLAYING || !game_place_stone( g, x, y ) ) {
+        return COORDINATE_ERR;
+    }
+    return SUCCESS;
+}
+
+/**
+   Hands over a game that has been read. A game the rules have not ended is stopped, so it can be
+   resumed. A game that can't be imported is freed.
+   @param current is pointer to the game read, or NULL.
+   @param result is SUCCESS if the game can be imported, otherwise the reason it can't.
+   @param g stores pointer to the game, or NULL if it can't be imported.
+   @param status stores result.
+   @return is always true.
+*/
+static bool finishGame( game* current, unsigned char result, game** g, unsigned char* status )
+{
+    if ( result != SUCCESS && current != NULL ) {
+        game_delete( current );
+        current = NULL;
+    }
+    if ( current != NULL ) {
+        current->quiet = false;
+        if ( current->state == GAME_STATE_PLAYING ) {
+            current->state = GAME_STATE_STOPPED;
+        }
+    }
+    *g = current;
+    *status = result;
+    return true;
+}
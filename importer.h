@@ -0,0 +1,90 @@
+/**
+   @file importer.h
+   @author Michael Warstler (mwwarstl)
+   Header file for importing games from other programs' archives. Two formats are read:
+   RIF - the XML database of the Renju International Federation (RenjuNet). Every <game> element
+         holds its moves as letter + number coordinates in a <move> element, and names one of
+         the <rule> elements. Games under a rule named like "gomoku" are freestyle games, every
+         other game is a Renju game. Boards are always 15x15.
+   PSQ - Piskvork game files, as kept by Gomocup. A game is a "Piskvorky <width>x<height>, ..."
+         line followed by one "x,y,time" line per move, counted from 1 at the top left. Any
+         other line ends the moves. Several games may follow each other in one file. The file
+         does not say which rules were played, so the caller chooses.
+   Archives are read through a small buffer one game at a time, so an archive of any size can be
+   imported. Every move is replayed with the rules, which decide how each game ended: a game
+   that ended some other way, like by resignation, is imported as stopped without a winner.
+*/
+
+#ifndef _IMPORTER_H_
+#define _IMPORTER_H_
+#include "game.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Archive in RenjuNet's RIF XML format */
+#define IMPORTER_FORMAT_RIF 0
+/** Archive of Piskvork PSQ games */
+#define IMPORTER_FORMAT_PSQ 1
+/** Bytes read from the archive at a time */
+#define IMPORTER_BUFFER_SIZE 65536
+/** Longest XML tag or PSQ line kept, longer ones are cut short */
+#define IMPORTER_LINE_LENGTH 1024
+/** Number of RIF rule ids whose game type is remembered, higher ids are Renju */
+#define IMPORTER_MAX_RULES 64
+
+/**
+   An archive open for importing. Fields are described as follows:
+   fd - file descriptor of the archive.
+   format - IMPORTER_FORMAT_RIF or IMPORTER_FORMAT_PSQ.
+   type - game type of PSQ games.
+   rule_types - game type of each RIF rule id.
+   games - number of games read so far, including games that could not be imported.
+   failed - true if reading the archive failed.
+   held - true if line holds a PSQ line that was read but not used yet.
+   line - last XML tag or PSQ line read, null terminated.
+   next - next unread byte in buffer.
+   end - end of the bytes read into buffer.
+   buffer - bytes read from the archive.
+*/
+typedef struct {
+    int fd;
+    unsigned char format;
+    unsigned char type;
+    unsigned char rule_types[ IMPORTER_MAX_RULES ];
+    size_t games;
+    bool failed;
+    bool held;
+    char line[ IMPORTER_LINE_LENGTH ];
+    unsigned char* next;
+    unsigned char* end;
+    unsigned char buffer[ IMPORTER_BUFFER_SIZE ];
+} importer;
+
+/**
+   Opens an archive for importing. The format is found from the start of the file.
+   @param path is string for archive path location.
+   @param type is game type of PSQ games. (GAME_FREESTYLE or GAME_RENJU)
+   @return is pointer to importer, or NULL if the file can't be read or is in neither format.
+*/
+importer* importer_open( const char* path, unsigned char type );
+
+/**
+   Reads the next game of an archive. A game that can't be imported is still read, so the games
+   after it can be, and g is set to NULL with the reason in status.
+   @param im is pointer to importer.
+   @param g stores pointer to the game, or NULL if it can't be imported. Moves are placed quietly.
+   @param status stores SUCCESS, BOARD_SIZE_ERR if the game is on a board size that isn't
+                 supported, COORDINATE_ERR if a move is off the board, on an occupied
+                 intersection or after the game ended, or FILE_INPUT_ERR if reading failed.
+   @return is true if a game was read, false at the end of the archive or if reading failed.
+*/
+bool importer_next( importer* im, game** g, unsigned char* status );
+
+/**
+   Closes the archive and frees the importer.
+   If parameter is NULL, program exits with error.
+   @param im is pointer to importer.
+*/
+void importer_close( importer* im );
+
+#endif
@@ -4,107 +4,499 @@
    Implementation file for input/output functionality on gomoku/renju programs.
 */
 
+#define _POSIX_C_SOURCE 200809L
 #include "board.h"
 #include "game.h"
+#include "io.h"
 #include "error-codes.h" 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h> 
+#include <unistd.h>
 
 /** Max string length allowed excluding the null terminator */
 #define MAX_STRING_LENGTH 3
+/** Modulus of the Adler-32 checksum */
+#define ADLER_MODULUS 65521
+/** Offset of the move count in the binary header */
+#define COUNT_OFFSET 8
+/** Offset of the checksum in the binary header */
+#define CHECKSUM_OFFSET 10
+/** Size of the buffer saved games are read through. Holds any whole binary game. */
+#define READ_BUFFER_SIZE 16384
+/** Numbers read from a text game stop growing here. Every valid header value is smaller. */
+#define MAX_NUMBER 1000
+/** True for the characters isspace() accepts in the "C" locale, without the locale lookup */
+#define IS_SPACE( c ) ( (c) == ' ' || ( (c) >= '\t' && (c) <= '\r' ) )
+/** True for decimal digits */
+#define IS_DIGIT( c ) ( (c) >= '0' && (c) <= '9' )
+
+/**
+   Buffered reader of a saved game file. Fields are described as follows:
+   fd - descriptor of the file.
+   next - position in buffer of the next unread byte.
+   end - number of bytes in buffer.
+   buffer - bytes read from the file.
+*/
+typedef struct {
+    int fd;
+    size_t next;
+    size_t end;
+    unsigned char buffer[ READ_BUFFER_SIZE ];
+} reader;
+
+// Prototypes for static functions used by the binary format.
+static int moveBits( unsigned char size );
+static unsigned int checksum( unsigned int sum, const unsigned char* data, size_t length );
+
+// Prototypes for static functions that read journals.
+static game* recoverJournal( reader* r, unsigned char* status );
+
+// Prototypes for static functions that read text games.
+static int peekByte( reader* r );
+static size_t readToken( reader* r, char* token, size_t capacity );
+static bool readNumber( reader* r, int* value );
 
 // Import a saved game.
 game* game_import(const char* path) 
 {
-    // Open stream if possible
-    FILE *inputStream = fopen( path, "r" );
-    if ( inputStream == NULL ) {
-        exit( FILE_INPUT_ERR );
+    unsigned char status;
+    game *importGame = game_load( path, false, &status );
+    if ( importGame == NULL ) {
+        exit( status );
+    }
+    return importGame;
+}
+
+// Load a saved game, reporting errors to the caller.
+game* game_load(const char* path, bool trusted, unsigned char* status)
+{
+    *status = FILE_INPUT_ERR;
+    
+    // Open file if possible
+    reader r;
+    r.fd = open( path, O_RDONLY );
+    if ( r.fd < 0 ) {
+        return NULL;
     } 
-    else {
-        // Check first line for proper file format
-        char inputLine[MAX_STRING_LENGTH + 1];
-        if ( fscanf( inputStream, "%s", inputLine ) != 1 ) {  
-            exit( FILE_INPUT_ERR );
+    r.next = 0;
+    r.end = 0;
+    
+    // Binary games are read whole and decoded.
+    if ( peekByte( &r ) != EOF && r.end >= strlen( GAME_BINARY_MAGIC ) &&
+         memcmp( r.buffer, GAME_BINARY_MAGIC, strlen( GAME_BINARY_MAGIC ) ) == 0 ) {
+        while ( r.end < sizeof( r.buffer ) ) {
+            ssize_t count = read( r.fd, r.buffer + r.end, sizeof( r.buffer ) - r.end );
+            if ( count <= 0 ) {
+                break;
+            }
+            r.end += count;
         }
-        if ( strcmp( inputLine, "GA" ) != 0 ) {
-            exit( FILE_INPUT_ERR );
+        close( r.fd );
+        return r.end <= GAME_BINARY_MAX_LENGTH ? game_decode( r.buffer, r.end, trusted, status ) :
+                                                 NULL;
+    }
+    
+    // Journals are replayed as far as they were written.
+    if ( r.end >= strlen( GAME_JOURNAL_MAGIC ) &&
+         memcmp( r.buffer, GAME_JOURNAL_MAGIC, strlen( GAME_JOURNAL_MAGIC ) ) == 0 ) {
+        game *recovered = recoverJournal( &r, status );
+        close( r.fd );
+        return recovered;
+    }
+    
+    // Check first line for proper file format
+    char inputLine[MAX_STRING_LENGTH + 1];
+    if ( readToken( &r, inputLine, sizeof( inputLine ) ) > MAX_STRING_LENGTH ||
+         strcmp( inputLine, "GA" ) != 0 ) {
+        close( r.fd );
+        return NULL;
+    }
+    
+    // Check lines 2-5 for correct numerical values.
+    int size;
+    int type;
+    int state;
+    int winner;
+    if ( !readNumber( &r, &size ) || !readNumber( &r, &type ) || !readNumber( &r, &state ) ||
+         !readNumber( &r, &winner ) ||
+         ( size != BOARD_SIZE_15 && size != BOARD_SIZE_17 && size != BOARD_SIZE_19 ) ||
+         ( type != GAME_FREESTYLE && type != GAME_RENJU ) ||
+         ( state != GAME_STATE_FORBIDDEN && state != GAME_STATE_STOPPED &&
+           state != GAME_STATE_FINISHED ) ||
+         ( winner != EMPTY_INTERSECTION && winner != BLACK_STONE && winner != WHITE_STONE ) ) {
+        close( r.fd );
+        return NULL;
+    }
+    
+    // Create game using read in values
+    game *importGame = game_create( size, type );
+    // Update state and winner fields
+    importGame->state = state;
+    importGame->winner = winner;
+    importGame->quiet = true;
+    
+    // Begin reading in moves. Place on board if valid, checking rules unless trusted.
+    bool ( *place )( game*, unsigned char, unsigned char ) = trusted ? game_add_stone :
+                                                                       game_place_stone;
+    char formal_coord[MAX_STRING_LENGTH + 1];
+    unsigned char x;
+    unsigned char y;
+    size_t length;
+    
+    while ( ( length = readToken( &r, formal_coord, sizeof( formal_coord ) ) ) > 0 ) {
+        // Checks for valid coordinates
+        if ( length > MAX_STRING_LENGTH ||
+             board_coord( importGame->board, formal_coord, &x, &y ) != SUCCESS ) {
+            game_delete( importGame );
+            close( r.fd );
+            return NULL;
         }
-        
-        // Check lines 2-5 for correct numerical values.
-        int size;
-        fscanf( inputStream, "%d", &size );
-        if ( size != BOARD_SIZE_15 && size != BOARD_SIZE_17 && size != BOARD_SIZE_19 ) {
-            exit( FILE_INPUT_ERR );
+        // Place on board - saves moves in process. Trusted files never repeat an intersection.
+        if ( !place( importGame, x, y ) && trusted ) {
+            game_delete( importGame );
+            close( r.fd );
+            *status = COORDINATE_ERR;
+            return NULL;
         }
-        int type;
-        fscanf( inputStream, "%d", &type );
-        if ( type != GAME_FREESTYLE && type != GAME_RENJU ) {
-            exit( FILE_INPUT_ERR );
-        }    
-        int state;
-        fscanf( inputStream, "%d", &state );
-        if ( state != GAME_STATE_FORBIDDEN && state != GAME_STATE_STOPPED && state != GAME_STATE_FINISHED ) {
-            exit( FILE_INPUT_ERR );
+    }
+    
+    close( r.fd );
+    importGame->quiet = false;
+    *status = SUCCESS;
+    return importGame;
+}
+
+// Rebuild a game from binary format bytes.
+game* game_decode(const unsigned char* data, size_t length, bool trusted, unsigned char* status)
+{
+    *status = FILE_INPUT_ERR;
+    
+    // Check header values before trusting the move count.
+    if ( length < GAME_BINARY_HEADER ||
+         memcmp( data, GAME_BINARY_MAGIC, strlen( GAME_BINARY_MAGIC ) ) != 0 ||
+         data[2] != GAME_BINARY_VERSION ) {
+        return NULL;
+    }
+    unsigned char size = data[3];
+    unsigned char type = data[4];
+    unsigned char state = data[5];
+    unsigned char winner = data[6];
+    if ( ( size != BOARD_SIZE_15 && size != BOARD_SIZE_17 && size != BOARD_SIZE_19 ) ||
+         ( type != GAME_FREESTYLE && type != GAME_RENJU ) ||
+         ( state != GAME_STATE_FORBIDDEN && state != GAME_STATE_STOPPED &&
+           state != GAME_STATE_FINISHED ) ||
+         ( winner != EMPTY_INTERSECTION && winner != BLACK_STONE && winner != WHITE_STONE ) ) {
+        return NULL;
+    }
+    
+    // Length must match the move count exactly, then the checksum must match the contents.
+    size_t count = data[ COUNT_OFFSET ] | data[ COUNT_OFFSET + 1 ] << 8;
+    int bits = moveBits( size );
+    if ( count > size * size || length != GAME_BINARY_HEADER + ( count * bits + 7 ) / 8 ) {
+        return NULL;
+    }
+    unsigned int stored = data[ CHECKSUM_OFFSET ] | data[ CHECKSUM_OFFSET + 1 ] << 8 |
+                          data[ CHECKSUM_OFFSET + 2 ] << 16 |
+                          ( unsigned int )data[ CHECKSUM_OFFSET + 3 ] << 24;
+    unsigned int sum = checksum( 1, data, CHECKSUM_OFFSET );
+    sum = checksum( sum, data + GAME_BINARY_HEADER, length - GAME_BINARY_HEADER );
+    if ( sum != stored ) {
+        return NULL;
+    }
+    
+    // Create game, then unpack and place every move, checking rules unless trusted.
+    bool ( *place )( game*, unsigned char, unsigned char ) = trusted ? game_add_stone :
+                                                                       game_place_stone;
+    game *importGame = game_create( size, type );
+    importGame->state = state;
+    importGame->winner = winner;
+    importGame->quiet = true;
+    for ( size_t i = 0; i < count; i++ ) {
+        unsigned int index = game_binary_move( data, i );
+        if ( index >= size * size ) {
+            game_delete( importGame );
+            return NULL;
         }
-        int winner;
-        fscanf( inputStream, "%d", &winner );
-        if ( winner != EMPTY_INTERSECTION && winner != BLACK_STONE && winner != WHITE_STONE ) {
-            exit( FILE_INPUT_ERR );
+        if ( !place( importGame, index % size, index / size ) && trusted ) {
+            game_delete( importGame );
+            *status = COORDINATE_ERR;
+            return NULL;
         }
-        
-        // Create game using read in values
-        game *importGame = game_create( size, type );
-        // Update state and winner fields
-        importGame->state = state;
-        importGame->winner = winner;
-        
-        // Begin reading in moves. Place on board if valid.
-        char formal_coord[MAX_STRING_LENGTH + 1];
-        unsigned char x;
-        unsigned char y;
-        
-        while ( fscanf(inputStream, "%s", formal_coord) != EOF ) {
-            // Checks for valid coordinates
-            if ( board_coord( importGame->board, formal_coord, &x, &y ) != SUCCESS ) {
-                exit( FILE_INPUT_ERR );
-            }
-            // Place on board - saves moves in process.
-            game_place_stone( importGame, x, y );
+    }
+    importGame->quiet = false;
+    *status = SUCCESS;
+    return importGame;
+}
+
+// Read one move of a binary game.
+unsigned short game_binary_move(const unsigned char* data, size_t ply)
+{
+    // A move spans at most two bytes, and the second is only read when the move reaches it.
+    int bits = moveBits( data[3] );
+    const unsigned char *moves = data + GAME_BINARY_HEADER;
+    size_t bit = ply * bits;
+    unsigned int window = moves[ bit / 8 ];
+    if ( bit % 8 + bits > 8 ) {
+        window |= moves[ bit / 8 + 1 ] << 8;
+    }
+    return ( window >> ( bit % 8 ) ) & ( ( 1 << bits ) - 1 );
+}
+
+// Write a game in binary format.
+size_t game_encode(const game* g, unsigned char* buffer)
+{
+    unsigned char size = g->board->size;
+    int bits = moveBits( size );
+    size_t length = GAME_BINARY_HEADER + ( g->moves_count * bits + 7 ) / 8;
+    memset( buffer, 0, length );
+    
+    // Header values, then moves packed lowest bits first.
+    memcpy( buffer, GAME_BINARY_MAGIC, strlen( GAME_BINARY_MAGIC ) );
+    buffer[2] = GAME_BINARY_VERSION;
+    buffer[3] = size;
+    buffer[4] = g->type;
+    buffer[5] = g->state;
+    buffer[6] = g->winner;
+    buffer[ COUNT_OFFSET ] = g->moves_count & 0xFF;
+    buffer[ COUNT_OFFSET + 1 ] = g->moves_count >> 8;
+    unsigned char *moves = buffer + GAME_BINARY_HEADER;
+    for ( size_t i = 0; i < g->moves_count; i++ ) {
+        unsigned int index = g->moves[i].y * size + g->moves[i].x;
+        size_t bit = i * bits;
+        moves[ bit / 8 ] |= index << ( bit % 8 );
+        if ( bit % 8 + bits > 8 ) {
+            moves[ bit / 8 + 1 ] |= index >> ( 8 - bit % 8 );
         }
-        
-        fclose( inputStream );
-        return importGame;
     }
+    
+    // Checksum covers the header up to the checksum and all of the moves.
+    unsigned int sum = checksum( 1, buffer, CHECKSUM_OFFSET );
+    sum = checksum( sum, buffer + GAME_BINARY_HEADER, length - GAME_BINARY_HEADER );
+    for ( int i = 0; i < 4; i++ ) {
+        buffer[ CHECKSUM_OFFSET + i ] = sum >> ( 8 * i );
+    }
+    return length;
 }
 
 // Export a completed or stopped game.
 void game_export(game* g, const char* path)
 {
+    unsigned char status = game_save( g, path );
+    if ( status != SUCCESS ) {
+        exit( status );
+    }
+}
+
+// Save a game, reporting errors to the caller.
+unsigned char game_save(game* g, const char* path)
+{
+    // Binary format when the path asks for it.
+    if ( game_has_extension( path, GAME_BINARY_EXTENSION ) ) {
+        unsigned char data[ GAME_BINARY_MAX_LENGTH ];
+        size_t length = game_encode( g, data );
+        FILE *outputStream = fopen( path, "wb" );
+        if ( outputStream == NULL ) {
+            return FILE_OUTPUT_ERR;
+        }
+        bool written = fwrite( data, 1, length, outputStream ) == length;
+        return fclose( outputStream ) == 0 && written ? SUCCESS : FILE_OUTPUT_ERR;
+    }
+    
     // Establish stream
     FILE *outputStream = fopen( path, "w" );
     if ( outputStream == NULL ) {
-        exit( FILE_OUTPUT_ERR );
+        return FILE_OUTPUT_ERR;
     }
-    else {
         
-        // Output first line "GA" magic number
-        fprintf( outputStream, "GA\n" );
-        
-        // Output lines 2-5 using game parameter fields.
-        fprintf( outputStream, "%d\n", (int)g->board->size );
-        fprintf( outputStream, "%d\n", g->type );
-        fprintf( outputStream, "%d\n", g->state );
-        fprintf( outputStream, "%d\n", g->winner );
-        
-        // Print out moves until completion
-        for (int i = 0; i < g->moves_count; i++ ) {
-            // Convert move coordinates to formal coordinate.
-            char formal_coord[MAX_STRING_LENGTH + 1];
-            board_formal_coord( g->board, g->moves[i].x, g->moves[i].y, formal_coord );
-            fprintf( outputStream, "%s\n", formal_coord );
+    // Output first line "GA" magic number
+    fprintf( outputStream, "GA\n" );
+    
+    // Output lines 2-5 using game parameter fields.
+    fprintf( outputStream, "%d\n", (int)g->board->size );
+    fprintf( outputStream, "%d\n", g->type );
+    fprintf( outputStream, "%d\n", g->state );
+    fprintf( outputStream, "%d\n", g->winner );
+    
+    // Print out moves until completion
+    for (int i = 0; i < g->moves_count; i++ ) {
+        // Convert move coordinates to formal coordinate.
+        char formal_coord[MAX_STRING_LENGTH + 1];
+        board_formal_coord( g->board, g->moves[i].x, g->moves[i].y, formal_coord );
+        fprintf( outputStream, "%s\n", formal_coord );
+    }
+    bool written = !ferror( outputStream );
+    return fclose( outputStream ) == 0 && written ? SUCCESS : FILE_OUTPUT_ERR;
+}
+
+// Check whether a file name ends in an extension.
+bool game_has_extension(const char* name, const char* extension)
+{
+    size_t length = strlen( name );
+    return length > strlen( extension ) &&
+           strcmp( name + length - strlen( extension ), extension ) == 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Returns the number of bits each move takes in the binary format.
+   @param size is size of the board.
+   @return is 8 for boards up to 15x15 (225 intersections), otherwise 9.
+*/
+static int moveBits( unsigned char size )
+{
+    return size * size <= 256 ? 8 : 9;
+}
+
+/**
+   Continues an Adler-32 checksum over a block of bytes. A new checksum starts from 1.
+   @param sum is checksum of the bytes before data.
+   @param data is start of the bytes.
+   @param length is number of bytes.
+   @return is checksum, with the running sum in the low 16 bits and the sum of sums above it.
+*/
+static unsigned int checksum( unsigned int sum, const unsigned char* data, size_t length )
+{
+    unsigned int low = sum & 0xFFFF;
+    unsigned int high = sum >> 16;
+    for ( size_t i = 0; i < length; i++ ) {
+        low = ( low + data[i] ) % ADLER_MODULUS;
+        high = ( high + low ) % ADLER_MODULUS;
+    }
+    return high << 16 | low;
+}
+
+/**
+   Rebuilds a game from a journal, placing each move with the rules until the journal ends, a
+   record is damaged or the game is over.
+   @param r is pointer to reader at the start of the journal.
+   @param status stores SUCCESS, or FILE_INPUT_ERR if the header is not a valid journal header.
+   @return is pointer to primary game struct, or NULL on error.
+*/
+static game* recoverJournal( reader* r, unsigned char* status )
+{
+    unsigned char header[ GAME_JOURNAL_HEADER ];
+    for ( int i = 0; i < GAME_JOURNAL_HEADER; i++ ) {
+        int c = peekByte( r );
+        if ( c == EOF ) {
+            return NULL;
         }
-        fclose( outputStream );
+        header[i] = c;
+        r->next++;
     }
-}
\ No newline at end of file
+    unsigned char size = header[3];
+    unsigned char type = header[4];
+    if ( header[2] != GAME_JOURNAL_VERSION ||
+         ( size != BOARD_SIZE_15 && size != BOARD_SIZE_17 && size != BOARD_SIZE_19 ) ||
+         ( type != GAME_FREESTYLE && type != GAME_RENJU ) ) {
+        return NULL;
+    }
+    
+    // Replay from a stopped game, so a move that ends it changes the state.
+    game *recovered = game_create( size, type );
+    recovered->state = GAME_STATE_STOPPED;
+    recovered->quiet = true;
+    while ( recovered->state == GAME_STATE_STOPPED ) {
+        // A record cut short by a crash ends the journal.
+        int low = peekByte( r );
+        if ( low == EOF ) {
+            break;
+        }
+        r->next++;
+        int high = peekByte( r );
+        if ( high == EOF ) {
+            break;
+        }
+        r->next++;
+        unsigned int record = low | high << 8;
+        unsigned int index = record & 0x1FF;
+        if ( record >> 9 != GAME_JOURNAL_SEQUENCE( recovered->moves_count ) ||
+             index >= size * size ||
+             !game_place_stone( recovered, index % size, index / size ) ) {
+            break;
+        }
+    }
+    recovered->quiet = false;
+    *status = SUCCESS;
+    return recovered;
+}
+
+/**
+   Gives the next byte of a file without using it up, reading more of the file when the buffer
+   is used up.
+   @param r is pointer to reader.
+   @return is next byte, or EOF at the end of the file or on a read error.
+*/
+static int peekByte( reader* r )
+{
+    if ( r->next == r->end ) {
+        ssize_t count = read( r->fd, r->buffer, sizeof( r->buffer ) );
+        if ( count <= 0 ) {
+            return EOF;
+        }
+        r->next = 0;
+        r->end = count;
+    }
+    return r->buffer[ r->next ];
+}
+
+/**
+   Reads the next white space separated token the way "%s" does.
+   @param r is pointer to reader.
+   @param token is buffer the token is stored in, null terminated. Long tokens are cut short.
+   @param capacity is size of token buffer.
+   @return is full length of the token, 0 if the file has no more tokens.
+*/
+static size_t readToken( reader* r, char* token, size_t capacity )
+{
+    while ( IS_SPACE( peekByte( r ) ) ) {
+        r->next++;
+    }
+    size_t length = 0;
+    for ( int c = peekByte( r ); c != EOF && !IS_SPACE( c ); c = peekByte( r ) ) {
+        if ( length + 1 < capacity ) {
+            token[ length ] = c;
+        }
+        length++;
+        r->next++;
+    }
+    token[ length + 1 < capacity ? length : capacity - 1 ] = '\0';
+    return length;
+}
+
+/**
+   Reads the next number the way "%d" does: optional white space and sign, then at least one
+   digit. Numbers too large for any header value stop growing at MAX_NUMBER.
+   @param r is pointer to reader.
+   @param value stores the number.
+   @return is true if a number was read, false if the next token does not start with one.
+*/
+static bool readNumber( reader* r, int* value )
+{
+    while ( IS_SPACE( peekByte( r ) ) ) {
+        r->next++;
+    }
+    int sign = 1;
+    if ( peekByte( r ) == '+' || peekByte( r ) == '-' ) {
+        sign = peekByte( r ) == '-' ? -1 : 1;
+        r->next++;
+    }
+    if ( !IS_DIGIT( peekByte( r ) ) ) {
+        return false;
+    }
+    int number = 0;
+    for ( int c = peekByte( r ); IS_DIGIT( c ); c = peekByte( r ) ) {
+        if ( number < MAX_NUMBER ) {
+            number = number * 10 + c - '0';
+        }
+        r->next++;
+    }
+    *value = sign * number;
+    return true;
+}
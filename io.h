@@ -3,11 +3,47 @@
    @author Michael Warstler (mwwarstl)
    Header file for input/output functionality on gomoku/renju programs. This includes 
    importing game from file and exporting game to file.
+   Games are saved in the text "GA" format, or in the compact binary "GB" format when the file
+   name ends in GAME_BINARY_EXTENSION. A binary game is a GAME_BINARY_HEADER byte header followed
+   by every move as an intersection index (y * size + x) packed into 8 bits on 15x15 boards and
+   9 bits on larger ones, lowest bits first. The header holds, in order: the magic "GB", version,
+   board size, game type, state, winner, a zero byte, the number of moves (2 bytes) and an
+   Adler-32 checksum (4 bytes) of everything else in the file. Numbers are little endian.
+   Games being played can also be kept in a journal (see journal.h) that grows by one record per
+   move. A journal is a GAME_JOURNAL_HEADER byte header holding the magic "GJ", version, board
+   size and game type, followed by GAME_JOURNAL_RECORD bytes per move: the intersection index in
+   the low 9 bits and the move's GAME_JOURNAL_SEQUENCE() in the high 7 bits, little endian.
 */
 
 #ifndef _IO_H_
 #define _IO_H_
 #include "game.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** First bytes of a binary saved game */
+#define GAME_BINARY_MAGIC "GB"
+/** Current binary format version */
+#define GAME_BINARY_VERSION 1
+/** Length of the binary header in bytes */
+#define GAME_BINARY_HEADER 14
+/** File extension of saved games in text format */
+#define GAME_EXTENSION ".gmk"
+/** File extension that selects the binary format when saving */
+#define GAME_BINARY_EXTENSION ".gmb"
+/** Longest binary game in bytes: a full 19x19 board at 9 bits per move */
+#define GAME_BINARY_MAX_LENGTH ( GAME_BINARY_HEADER + ( BOARD_SIZE_19 * BOARD_SIZE_19 * 9 + 7 ) / 8 )
+
+/** First bytes of a game journal */
+#define GAME_JOURNAL_MAGIC "GJ"
+/** Current journal version */
+#define GAME_JOURNAL_VERSION 1
+/** Length of the journal header in bytes */
+#define GAME_JOURNAL_HEADER 5
+/** Length of each journal record in bytes */
+#define GAME_JOURNAL_RECORD 2
+/** Sequence number of the move numbered ply (from 0) in a journal record, never 0 */
+#define GAME_JOURNAL_SEQUENCE( ply ) ( (ply) % 127 + 1 )
 
 /**
    Import a saved game from file at path parameter. Returns reconstructed game struct.
@@ -19,11 +55,78 @@
 game* game_import(const char* path);
 
 /**
-   Exports a game to the file at path parameter. Follows specified Save Game File format.
+   Same as game_import(), except errors are returned instead of ending the program, so one bad
+   file does not stop a tool that reads many. Moves are placed quietly.
+   Trusted files, such as files this program saved, can skip the rules: moves are placed with
+   game_add_stone(), state and winner are taken from the file, and the stone to play next
+   follows from the number of moves. game_verify() replays such a game with the rules to check
+   that its moves, state and winner are legal. A trusted file that places two stones on one
+   intersection is an error rather than having the move skipped.
+   A journal is recovered rather than loaded: its moves are always replayed with the rules, up
+   to the first record that is cut short, out of sequence or not a legal move, which is where a
+   crash stopped the journal. The game is stopped unless the recovered moves ended it.
+   @param path is string for file path location
+   @param trusted is true to place moves without checking rules, false to check every move.
+   @param status stores SUCCESS, FILE_INPUT_ERR if the file is missing or not a saved game, or
+                 COORDINATE_ERR if a trusted file repeats an intersection.
+   @return is pointer to primary game struct, or NULL on error.
+*/
+game* game_load(const char* path, bool trusted, unsigned char* status);
+
+/**
+   Rebuilds a game from binary format bytes held in memory. The checksum, header values and
+   every move index are checked. Moves are placed quietly, and rules are skipped for trusted
+   data like in game_load().
+   @param data is start of the binary game.
+   @param length is number of bytes available at data.
+   @param trusted is true to place moves without checking rules, false to check every move.
+   @param status stores SUCCESS, FILE_INPUT_ERR if data is not a valid binary game, or
+                 COORDINATE_ERR if trusted data repeats an intersection.
+   @return is pointer to primary game struct, or NULL on error.
+*/
+game* game_decode(const unsigned char* data, size_t length, bool trusted, unsigned char* status);
+
+/**
+   Reads one move of a binary game in place, without decoding the rest of the game. The data
+   must already be known to be a valid binary game (see game_decode()) holding more than ply
+   moves.
+   @param data is start of the binary game.
+   @param ply is number of the move, starting from 0.
+   @return is intersection index of the move, y * size + x.
+*/
+unsigned short game_binary_move(const unsigned char* data, size_t ply);
+
+/**
+   Writes a game in binary format to a buffer.
+   @param g is pointer to primary game struct.
+   @param buffer is buffer of at least GAME_BINARY_MAX_LENGTH bytes.
+   @return is number of bytes written.
+*/
+size_t game_encode(const game* g, unsigned char* buffer);
+
+/**
+   Exports a game to the file at path parameter. Follows specified Save Game File format, or the
+   binary format if path ends in GAME_BINARY_EXTENSION.
    If file can't be written, program exits with error.
    @param g is pointer to primary game struct.
    @param path is string for file location to save file to.
 */
 void game_export(game* g, const char* path);
 
+/**
+   Same as game_export(), except errors are returned instead of ending the program.
+   @param g is pointer to primary game struct.
+   @param path is string for file location to save file to.
+   @return is SUCCESS, or FILE_OUTPUT_ERR if the file can't be written.
+*/
+unsigned char game_save(game* g, const char* path);
+
+/**
+   Checks whether a file name ends in an extension, with at least one character before it.
+   @param name is file name or path.
+   @param extension is extension including the dot, such as GAME_EXTENSION.
+   @return is true if name ends in extension, otherwise false.
+*/
+bool game_has_extension(const char* name, const char* extension);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,185 @@
+/**
+   @file journal.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for game journals.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "journal.h"
+#include "io.h"
+#include "error-codes.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Added to the journal path to make the path the new journal is written to first */
+#define TEMPORARY_EXTENSION ".tmp"
+/** Longest journal in bytes: a full 19x19 board */
+#define MAX_JOURNAL_LENGTH ( GAME_JOURNAL_HEADER + \
+                             BOARD_SIZE_19 * BOARD_SIZE_19 * GAME_JOURNAL_RECORD )
+
+// Prototypes for static functions.
+static size_t putRecord( unsigned char* buffer, unsigned char size, size_t ply, const move* m );
+static bool writeAll( int fd, const unsigned char* data, size_t length );
+static void* syncWorker( void* arg );
+
+// Start a journal for a game.
+journal* journal_open( const game* g, const char* path )
+{
+    // The header and every move so far, written in one go.
+    unsigned char data[ MAX_JOURNAL_LENGTH ];
+    unsigned char size = g->board->size;
+    memcpy( data, GAME_JOURNAL_MAGIC, strlen( GAME_JOURNAL_MAGIC ) );
+    data[2] = GAME_JOURNAL_VERSION;
+    data[3] = size;
+    data[4] = g->type;
+    size_t length = GAME_JOURNAL_HEADER;
+    for ( size_t i = 0; i < g->moves_count; i++ ) {
+        length += putRecord( data + length, size, i, &g->moves[i] );
+    }
+
+    // Written beside the old journal, then put in its place once it is safely on disk.
+    char *temporary = ( char * )malloc( strlen( path ) + strlen( TEMPORARY_EXTENSION ) + 1 );
+    strcpy( temporary, path );
+    strcat( temporary, TEMPORARY_EXTENSION );
+    int fd = open( temporary, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644 );
+    if ( fd < 0 ) {
+        free( temporary );
+        return NULL;
+    }
+    if ( !writeAll( fd, data, length ) || fdatasync( fd ) != 0 ||
+         rename( temporary, path ) != 0 ) {
+        close( fd );
+        unlink( temporary );
+        free( temporary );
+        return NULL;
+    }
+    free( temporary );
+
+    journal *j = ( journal * )malloc( sizeof( journal ) );
+    j->fd = fd;
+    j->size = size;
+    j->moves = g->moves_count;
+    pthread_mutex_init( &j->lock, NULL );
+    pthread_cond_init( &j->wake, NULL );
+    j->dirty = false;
+    j->stopping = false;
+    j->failed = false;
+    if ( pthread_create( &j->syncer, NULL, syncWorker, j ) != 0 ) {
+        pthread_cond_destroy( &j->wake );
+        pthread_mutex_destroy( &j->lock );
+        close( fd );
+        free( j );
+        return NULL;
+    }
+    return j;
+}
+
+// Write one move to a journal.
+void journal_write( journal* j, const move* m )
+{
+    unsigned char record[ GAME_JOURNAL_RECORD ];
+    putRecord( record, j->size, j->moves++, m );
+    bool written = writeAll( j->fd, record, GAME_JOURNAL_RECORD );
+    pthread_mutex_lock( &j->lock );
+    j->failed = j->failed || !written;
+    j->dirty = true;
+    pthread_cond_signal( &j->wake );
+    pthread_mutex_unlock( &j->lock );
+}
+
+// Adapter so a journal can be used as a game record hook.
+void journal_record_hook( game* g, void* context, const move* m )
+{
+    journal_write( ( journal * )context, m );
+}
+
+// Sync, close and free a journal.
+unsigned char journal_close( journal* j )
+{
+    if ( j == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    pthread_mutex_lock( &j->lock );
+    j->stopping = true;
+    pthread_cond_signal( &j->wake );
+    pthread_mutex_unlock( &j->lock );
+    pthread_join( j->syncer, NULL );
+
+    // The syncer has stopped, so whatever it left dirty is synced here.
+    bool written = !j->failed && ( !j->dirty || fdatasync( j->fd ) == 0 );
+    written = close( j->fd ) == 0 && written;
+    pthread_cond_destroy( &j->wake );
+    pthread_mutex_destroy( &j->lock );
+    free( j );
+    return written ? SUCCESS : FILE_OUTPUT_ERR;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Stores the journal record of a move.
+   @param buffer is buffer of at least GAME_JOURNAL_RECORD bytes.
+   @param size is board size.
+   @param ply is number of the move, starting from 0.
+   @param m is pointer to the move.
+   @return is number of bytes stored, GAME_JOURNAL_RECORD.
+*/
+static size_t putRecord( unsigned char* buffer, unsigned char size, size_t ply, const move* m )
+{
+    unsigned int record = ( m->y * size + m->x ) | GAME_JOURNAL_SEQUENCE( ply ) << 9;
+    buffer[0] = record & 0xFF;
+    buffer[1] = record >> 8;
+    return GAME_JOURNAL_RECORD;
+}
+
+/**
+   Writes every byte of a block to a file, carrying on after short writes.
+   @param fd is descriptor of the file.
+   @param data is start of the bytes.
+   @param length is number of bytes.
+   @return is true if every byte was written, false otherwise.
+*/
+static bool writeAll( int fd, const unsigned char* data, size_t length )
+{
+    while ( length > 0 ) {
+        ssize_t count = write( fd, data, length );
+        if ( count <= 0 ) {
+            return false;
+        }
+        data += count;
+        length -= count;
+    }
+    return true;
+}
+
+/**
+   Thread entry point that syncs a journal. Moves written while a sync runs are synced together
+   by the next one, so the number of syncs stays bounded by the disk however fast moves come.
+   @param arg is pointer to journal.
+   @return is always NULL.
+*/
+static void* syncWorker( void* arg )
+{
+    journal *j = ( journal * )arg;
+    pthread_mutex_lock( &j->lock );
+    while ( !j->stopping ) {
+        if ( !j->dirty ) {
+            pthread_cond_wait( &j->wake, &j->lock );
+            continue;
+        }
+        j->dirty = false;
+        pthread_mutex_unlock( &j->lock );
+        bool synced = fdatasync( j->fd ) == 0;
+        pthread_mutex_lock( &j->lock );
+        j->failed = j->failed || !synced;
+    }
+    pthread_mutex_unlock( &j->lock );
+    return NULL;
+}
@@ -0,0 +1,75 @@
+/**
+   @file journal.h
+   @author Michael Warstler (mwwarstl)
+   Header file for game journals: a file that grows by one record as each move is played, so a
+   game survives a crash of the program that plays it. The format is described in io.h, and
+   game_import() recovers a game from a journal. Each move is handed to the operating system
+   with one write() on the playing thread, which a crash of the program can't lose. Flushing to
+   the disk, which a power failure can't lose, is left to a background thread that syncs every
+   move written since its last sync at once, so the game never waits for the disk.
+*/
+
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+#include "game.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+/**
+   A journal open for adding moves. Fields are described as follows:
+   fd - descriptor of the journal file.
+   size - board size of the game, for turning moves into intersection indexes.
+   moves - number of moves written.
+   lock - guards dirty, stopping and failed.
+   wake - signalled when a move is written or the journal is closing.
+   syncer - thread that syncs the file.
+   dirty - true if moves were written since the last sync started.
+   stopping - true once the journal is closing.
+   failed - true if a move could not be written or synced.
+*/
+typedef struct {
+    int fd;
+    unsigned char size;
+    size_t moves;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t syncer;
+    bool dirty;
+    bool stopping;
+    bool failed;
+} journal;
+
+/**
+   Starts a journal for a game, replacing any file at path. The moves the game already has are
+   written first, so a resumed game, even one recovered from the same journal, carries on in one
+   journal. The new journal replaces the old file in one step once it is on disk.
+   @param g is pointer to primary game struct.
+   @param path is string for journal path location.
+   @return is pointer to journal, or NULL if the file can't be written.
+*/
+journal* journal_open( const game* g, const char* path );
+
+/**
+   Writes one move to the end of a journal and wakes the thread that syncs it.
+   @param j is pointer to journal.
+   @param m is pointer to the move.
+*/
+void journal_write( journal* j, const move* m );
+
+/**
+   Record hook callback for game.record. Context must be a journal opened with journal_open().
+   @param g is pointer to primary game struct.
+   @param context is pointer to journal.
+   @param m is pointer to the move.
+*/
+void journal_record_hook( game* g, void* context, const move* m );
+
+/**
+   Syncs every move still waiting, closes a journal and frees it. The file is kept.
+   If parameter is NULL, program exits with error.
+   @param j is pointer to journal.
+   @return is SUCCESS, or FILE_OUTPUT_ERR if any move could not be written or synced.
+*/
+unsigned char journal_close( journal* j );
+
+#endif
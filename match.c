@@ -0,0 +1,343 @@
+/**
+   @file match.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for executable that tests an engine change with a sequential
+   probability ratio test (SPRT). The new and base players play pairs of games from the same
+   opening with colours swapped, until the log-likelihood ratio of "new is elo1 stronger" against
+   "new is elo0 stronger" crosses one of the bounds set by the error rates alpha and beta.
+   Pairs are scored as a whole (pentanomial: 0, 0.5, 1, 1.5 or 2 points for new), which removes
+   most of the noise an unbalanced opening adds. A result line is streamed after every pair.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "error-codes.h"
+#include "game.h"
+#include "selfplay.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Default elo difference of the null hypothesis */
+#define DEFAULT_ELO0 0.0
+/** Default elo difference of the alternative hypothesis */
+#define DEFAULT_ELO1 5.0
+/** Default chance of accepting a change that is not better (and of rejecting one that is) */
+#define DEFAULT_ERROR_RATE 0.05
+/** Default most pairs played before giving up without a decision */
+#define DEFAULT_MAX_PAIRS 100000
+/** Number of possible pair scores, in half points: 0, 1, 2, 3 or 4 */
+#define PAIR_OUTCOMES 5
+/** Pairs needed before the ratio is computed */
+#define MIN_PAIRS 2
+/** Pairs added to every outcome when measuring the variance, so identical pairs still decide */
+#define PSEUDO_PAIRS 0.001
+
+/** Match still running */
+#define MATCH_RUNNING 0
+/** Null hypothesis accepted: the change is not elo1 better */
+#define MATCH_H0 1
+/** Alternative hypothesis accepted: the change is better */
+#define MATCH_H1 2
+/** Most pairs played without a decision */
+#define MATCH_LIMIT 3
+
+/**
+   Work and results shared by all game threads. Fields are described as follows:
+   players - descriptions of the new player and the base player.
+   size - board size.
+   type - game type. (GAME_FREESTYLE or GAME_RENJU)
+   openings - opening suite, NULL to start from an empty board.
+   opening_count - number of openings.
+   elo0 - elo difference of the null hypothesis.
+   elo1 - elo difference of the alternative hypothesis.
+   lower - bound on the ratio for accepting the null hypothesis.
+   upper - bound on the ratio for accepting the alternative hypothesis.
+   max_pairs - most pairs played.
+   next - number of the next pair a thread should take.
+   pairs - pairs scored so far.
+   outcomes - number of pairs for each score of new, in half points.
+   games - wins, draws and losses of new.
+   result - MATCH_RUNNING until a decision is made.
+   lock - guards the results.
+*/
+typedef struct {
+    player_spec players[2];
+    unsigned char size;
+    unsigned char type;
+    const opening* openings;
+    int opening_count;
+    double elo0;
+    double elo1;
+    double lower;
+    double upper;
+    int max_pairs;
+    int next;
+    int pairs;
+    int outcomes[ PAIR_OUTCOMES ];
+    int games[3];
+    int result;
+    pthread_mutex_t lock;
+} match;
+
+// Prototypes for static functions run by the game threads.
+static void* matchWorker( void* arg );
+static int scoreGame( const game* g, unsigned char newStone );
+static double logLikelihoodRatio( const match* m );
+static double eloEstimate( const match* m );
+
+/**
+   Runs the test between the new and base players named last on the command line. Optional key
+   arguments come first: "-b" followed by the board size 15/17/19, "-t" followed by "freestyle"
+   or "renju", "-j" followed by the number of threads, "-p" followed by an opening suite, "-e"
+   followed by "<elo0>,<elo1>", "-a" followed by alpha, "-r" followed by beta and "-g" followed
+   by the most pairs to play.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status
+*/
+int main(int argc, char **argv)
+{
+    match m;
+    memset( &m, 0, sizeof( match ) );
+    m.size = BOARD_SIZE_15;
+    m.type = GAME_FREESTYLE;
+    m.elo0 = DEFAULT_ELO0;
+    m.elo1 = DEFAULT_ELO1;
+    m.max_pairs = DEFAULT_MAX_PAIRS;
+    double alpha = DEFAULT_ERROR_RATE;
+    double beta = DEFAULT_ERROR_RATE;
+    int threads = ( int )sysconf( _SC_NPROCESSORS_ONLN );
+    const char *openingsPath = NULL;
+
+    // Key arguments in pairs, then the two players.
+    int first = 1;
+    while ( first < argc - 2 && argv[ first ][0] == '-' ) {
+        char *value = argv[ first + 1 ];
+        if ( strcmp( argv[ first ], "-b" ) == 0 ) {
+            m.size = atoi( value );
+            if ( m.size != BOARD_SIZE_15 && m.size != BOARD_SIZE_17 && m.size != BOARD_SIZE_19 ) {
+                exit( BOARD_SIZE_ERR );
+            }
+        }
+        else if ( strcmp( argv[ first ], "-t" ) == 0 && strcmp( value, "freestyle" ) == 0 ) {
+            m.type = GAME_FREESTYLE;
+        }
+        else if ( strcmp( argv[ first ], "-t" ) == 0 && strcmp( value, "renju" ) == 0 ) {
+            m.type = GAME_RENJU;
+        }
+        else if ( strcmp( argv[ first ], "-j" ) == 0 && atoi( value ) > 0 ) {
+            threads = atoi( value );
+        }
+        else if ( strcmp( argv[ first ], "-p" ) == 0 ) {
+            openingsPath = value;
+        }
+        else if ( strcmp( argv[ first ], "-e" ) == 0 ) {
+            if ( sscanf( value, "%lf,%lf", &m.elo0, &m.elo1 ) != 2 || m.elo0 >= m.elo1 ) {
+                goto error;
+            }
+        }
+        else if ( strcmp( argv[ first ], "-a" ) == 0 && atof( value ) > 0 && atof( value ) < 0.5 ) {
+            alpha = atof( value );
+        }
+        else if ( strcmp( argv[ first ], "-r" ) == 0 && atof( value ) > 0 && atof( value ) < 0.5 ) {
+            beta = atof( value );
+        }
+        else if ( strcmp( argv[ first ], "-g" ) == 0 && atoi( value ) > 0 ) {
+            m.max_pairs = atoi( value );
+        }
+        else {
+            goto error;
+        }
+        first += 2;
+    }
+    if ( first != argc - 2 || !selfplay_parse_player( argv[ first ], &m.players[0] ) ||
+         !selfplay_parse_player( argv[ first + 1 ], &m.players[1] ) ) {
+        goto error;
+    }
+    if ( openingsPath == NULL && m.players[0].kind == ENGINE_ALPHABETA &&
+         m.players[1].kind == ENGINE_ALPHABETA ) {
+        fprintf( stderr, "warning: alpha-beta players without -p play every pair the same\n" );
+    }
+    m.lower = log( beta / ( 1 - alpha ) );
+    m.upper = log( ( 1 - beta ) / alpha );
+
+    opening *openings = NULL;
+    if ( openingsPath != NULL ) {
+        openings = selfplay_read_openings( openingsPath, m.size, &m.opening_count );
+        m.openings = openings;
+    }
+    pthread_mutex_init( &m.lock, NULL );
+    printf( "SPRT elo0 %.1f elo1 %.1f alpha %.3f beta %.3f: LLR bounds [%.2f, %.2f]\n", m.elo0,
+            m.elo1, alpha, beta, m.lower, m.upper );
+    fflush( stdout );
+
+    // Threads play pairs until the test decides.
+    if ( threads > m.max_pairs ) {
+        threads = m.max_pairs;
+    }
+    pthread_t *workers = ( pthread_t * )malloc( threads * sizeof( pthread_t ) );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_create( &workers[i], NULL, matchWorker, &m );
+    }
+    matchWorker( &m );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+    free( workers );
+
+    if ( m.result == MATCH_H1 ) {
+        printf( "H1 accepted: new is stronger (elo %.1f)\n", eloEstimate( &m ) );
+    }
+    else if ( m.result == MATCH_H0 ) {
+        printf( "H0 accepted: new is not %.1f elo stronger (elo %.1f)\n", m.elo1,
+                eloEstimate( &m ) );
+    }
+    else {
+        printf( "No decision after %d pairs (elo %.1f)\n", m.pairs, eloEstimate( &m ) );
+    }
+    pthread_mutex_destroy( &m.lock );
+    free( openings );
+    return SUCCESS;
+
+    error:
+    printf( "usage: ./match [-b <15|17|19>] [-t <freestyle|renju>] [-j <threads>]\n" );
+    printf( "       [-p <openings>] [-e <elo0>,<elo1>] [-a <alpha>] [-r <beta>]\n" );
+    printf( "       [-g <max-pairs>] <new> <base>\n" );
+    printf( "       players are mcts:<playouts>, mcts:<millis>ms, ab:<depth>,\n" );
+    printf( "       ab:<depth>:<ordering> or ext:<millis>:<program>\n" );
+    exit( ARGUMENT_ERR );
+}
+
+/**
+   Thread entry point. Plays pairs of games until the test decides or the pair limit is reached.
+   Both games of a pair start from the same opening, first with new as black, then with base as
+   black. Pairs finishing after the decision are not counted.
+   @param arg is pointer to shared match.
+   @return is always NULL.
+*/
+static void* matchWorker( void* arg )
+{
+    match *m = ( match * )arg;
+    player *newPlayer = selfplay_create_player( &m->players[0] );
+    player *basePlayer = selfplay_create_player( &m->players[1] );
+
+    int number;
+    while ( __atomic_load_n( &m->result, __ATOMIC_RELAXED ) == MATCH_RUNNING &&
+            ( number = __atomic_fetch_add( &m->next, 1, __ATOMIC_RELAXED ) ) < m->max_pairs ) {
+        const opening *start = NULL;
+        if ( m->openings != NULL ) {
+            start = &m->openings[ number % m->opening_count ];
+        }
+        game *first = selfplay_play( newPlayer, basePlayer, m->size, m->type, start );
+        game *second = selfplay_play( basePlayer, newPlayer, m->size, m->type, start );
+        int firstScore = scoreGame( first, BLACK_STONE );
+        int secondScore = scoreGame( second, WHITE_STONE );
+        game_delete( first );
+        game_delete( second );
+
+        // Stopped games (bad opening, or a player failed) make the pair unusable.
+        pthread_mutex_lock( &m->lock );
+        if ( m->result == MATCH_RUNNING && firstScore >= 0 && secondScore >= 0 ) {
+            m->outcomes[ firstScore + secondScore ]++;
+            m->games[ 2 - firstScore ]++;
+            m->games[ 2 - secondScore ]++;
+            m->pairs++;
+
+            double llr = logLikelihoodRatio( m );
+            if ( llr >= m->upper ) {
+                m->result = MATCH_H1;
+            }
+            else if ( llr <= m->lower ) {
+                m->result = MATCH_H0;
+            }
+            else if ( m->pairs >= m->max_pairs ) {
+                m->result = MATCH_LIMIT;
+            }
+            printf( "pairs %d  new +%d -%d =%d  penta [%d %d %d %d %d]  elo %.1f  LLR %.2f\n",
+                    m->pairs, m->games[0], m->games[2], m->games[1], m->outcomes[0],
+                    m->outcomes[1], m->outcomes[2], m->outcomes[3], m->outcomes[4],
+                    eloEstimate( m ), llr );
+            fflush( stdout );
+        }
+        pthread_mutex_unlock( &m->lock );
+    }
+
+    selfplay_delete_player( newPlayer );
+    selfplay_delete_player( basePlayer );
+    return NULL;
+}
+
+/**
+   Scores a game for the new player in half points.
+   @param g is pointer to finished game.
+   @param newStone is stone the new player played.
+   @return is 2 for a win, 1 for a draw, 0 for a loss, or -1 if the game was stopped.
+*/
+static int scoreGame( const game* g, unsigned char newStone )
+{
+    if ( g->state == GAME_STATE_STOPPED ) {
+        return -1;
+    }
+    if ( g->winner == EMPTY_INTERSECTION ) {
+        return 1;
+    }
+    return g->winner == newStone ? 2 : 0;
+}
+
+/**
+   Computes the generalized SPRT log-likelihood ratio from the pair outcomes. The mean pair score
+   is treated as normally distributed with the variance measured so far, which is accurate for
+   the number of pairs a test needs. Every outcome gets PSEUDO_PAIRS extra pairs first, so pairs
+   that all score the same (deterministic players) have a small variance rather than none, and
+   the ratio still heads for a bound.
+   @param m is pointer to match.
+   @return is log-likelihood ratio of elo1 against elo0, 0 until there is enough data.
+*/
+static double logLikelihoodRatio( const match* m )
+{
+    if ( m->pairs < MIN_PAIRS ) {
+        return 0.0;
+    }
+
+    // Mean and variance of the pair score, scaled to 0-1 like a single game score.
+    double total = m->pairs + PAIR_OUTCOMES * PSEUDO_PAIRS;
+    double mean = 0.0;
+    for ( int i = 0; i < PAIR_OUTCOMES; i++ ) {
+        mean += ( m->outcomes[i] + PSEUDO_PAIRS ) * ( i / 4.0 );
+    }
+    mean /= total;
+    double variance = 0.0;
+    for ( int i = 0; i < PAIR_OUTCOMES; i++ ) {
+        variance += ( m->outcomes[i] + PSEUDO_PAIRS ) * ( i / 4.0 - mean ) * ( i / 4.0 - mean );
+    }
+    variance /= total;
+
+    // Expected scores under both hypotheses.
+    double score0 = 1.0 / ( 1.0 + pow( 10.0, -m->elo0 / 400.0 ) );
+    double score1 = 1.0 / ( 1.0 + pow( 10.0, -m->elo1 / 400.0 ) );
+    return m->pairs * ( score1 - score0 ) * ( 2 * mean - score0 - score1 ) / ( 2 * variance );
+}
+
+/**
+   Estimates the elo difference of new over base from its score so far.
+   @param m is pointer to match.
+   @return is elo difference, clamped to +-1000 when one side has scored everything.
+*/
+static double eloEstimate( const match* m )
+{
+    int points = 0;
+    for ( int i = 0; i < PAIR_OUTCOMES; i++ ) {
+        points += m->outcomes[i] * i;
+    }
+    if ( m->pairs == 0 || points == 0 ) {
+        return m->pairs == 0 ? 0.0 : -1000.0;
+    }
+    if ( points == 4 * m->pairs ) {
+        return 1000.0;
+    }
+    double score = points / ( 4.0 * m->pairs );
+    return -400.0 * log10( 1.0 / score - 1.0 );
+}
@@ -0,0 +1,462 @@
+/**
+   @file mcts.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for the parallel Monte Carlo Tree Search engine. Each thread repeatedly
+   selects a path with UCT (adding virtual loss on the way down), expands the leaf into the arena,
+   runs a playout and backs the result up the path. Node statistics are updated with atomic
+   operations, so threads never wait on each other.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "mcts.h"
+#include "error-codes.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Exploration constant for UCT */
+#define EXPLORATION 1.0
+/** Visits counted against a node for every thread currently below it */
+#define VIRTUAL_LOSS 3
+/** Visits a leaf needs before it is expanded */
+#define EXPAND_VISITS 2
+/** Number of iterations between deadline checks */
+#define TIME_CHECK_INTERVAL 32
+/** Radius of the candidate move neighbourhood around each stone */
+#define NEAR_RADIUS 2
+/** Score added for a won playout */
+#define WIN_SCORE 2
+/** Score added for a drawn playout */
+#define DRAW_SCORE 1
+/** Most moves played since the previous search for its tree to be reused */
+#define REUSE_PLIES 2
+
+/** State of one search thread */
+typedef struct {
+    mcts* tree;
+    unsigned long long random;
+} worker;
+
+// Prototypes for static functions used by the search threads.
+static void* searchWorker( void* arg );
+static void runIteration( mcts* m, unsigned long long* random );
+static unsigned int selectChild( mcts* m, mcts_node* parent, unsigned long long* random );
+static bool expandNode( mcts* m, mcts_node* node, const position* p );
+static unsigned int compactTree( mcts* m, unsigned int root );
+static unsigned char playout( position* p, unsigned long long* random );
+static unsigned long long nextRandom( unsigned long long* state );
+
+// Create a search tree with an arena of max_nodes.
+mcts* mcts_create( size_t max_nodes, int threads )
+{
+    mcts *m = ( mcts * )malloc( sizeof( mcts ) );
+    m->nodes = ( mcts_node * )malloc( max_nodes * sizeof( mcts_node ) );
+    if ( m->nodes == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    m->capacity = max_nodes;
+    m->used = 0;
+    m->root = 0;
+    m->threads = threads < 1 ? 1 : threads;
+    m->stop = false;
+    m->playouts = 0;
+    m->max_playouts = 0;
+    m->deadline = 0;
+    return m;
+}
+
+// Free the search tree and its arena.
+void mcts_delete( mcts* m )
+{
+    if ( m == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    free( m->nodes );
+    free( m );
+}
+
+// Search a position and return the most visited move.
+unsigned short mcts_search( mcts* m, const position* p, long max_playouts, long max_millis )
+{
+    if ( p->winner != EMPTY_INTERSECTION || position_is_full( p ) ) {
+        return POSITION_NO_MOVE;
+    }
+    mcts_prepare( m, p );
+    return mcts_run( m, max_playouts, max_millis );
+}
+
+// Re-root or reset the tree for a new search.
+bool mcts_prepare( mcts* m, const position* p )
+{
+    const position *old = &m->root_position;
+    unsigned int root = 0;
+
+    // Walk down from the old root along the moves played since, if they are in the tree.
+    if ( m->root != 0 && p->size == old->size &&
+         p->type == old->type && p->count >= old->count && p->count - old->count <= REUSE_PLIES &&
+         memcmp( p->history, old->history, old->count * sizeof( p->history[0] ) ) == 0 ) {
+        root = m->root;
+        for ( int i = old->count; i < p->count && root != 0; i++ ) {
+            mcts_node *node = &m->nodes[ root ];
+            unsigned int next = 0;
+            if ( node->state == MCTS_NODE_EXPANDED ) {
+                for ( unsigned int c = 0; c < node->child_count; c++ ) {
+                    if ( m->nodes[ node->first_child + c ].move == p->history[i] ) {
+                        next = node->first_child + c;
+                        break;
+                    }
+                }
+            }
+            root = next;
+        }
+    }
+
+    // Move the kept subtree to the front of the arena so it can grow again. Otherwise reset the
+    // arena. Index 0 is reserved so it can mean "no node".
+    bool reused = root != 0;
+    if ( reused ) {
+        root = compactTree( m, root );
+    }
+    else {
+        root = 1;
+        m->used = 2;
+        memset( &m->nodes[ root ], 0, sizeof( mcts_node ) );
+        m->nodes[ root ].move = p->count > 0 ? p->history[ p->count - 1 ] : POSITION_NO_MOVE;
+    }
+    m->root = root;
+    m->root_position = *p;
+    if ( m->nodes[ root ].state != MCTS_NODE_EXPANDED ) {
+        expandNode( m, &m->nodes[ root ], p );
+    }
+    __atomic_store_n( &m->stop, false, __ATOMIC_SEQ_CST );
+    return reused;
+}
+
+// Search the prepared root.
+unsigned short mcts_run( mcts* m, long max_playouts, long max_millis )
+{
+    mcts_node *root = &m->nodes[ m->root ];
+    if ( root->state != MCTS_NODE_EXPANDED ) {
+        return POSITION_NO_MOVE;
+    }
+
+    // Set up limits. A pending stop request is left alone.
+    m->playouts = 0;
+    m->max_playouts = max_playouts;
+    m->deadline = max_millis > 0 ? mcts_now() + max_millis : 0;
+
+    // Start helper threads, then search on this thread as well.
+    pthread_t threads[ m->threads ];
+    worker workers[ m->threads ];
+    unsigned long long seed = ( unsigned long long )mcts_now() * 0x9E3779B97F4A7C15ULL;
+    for ( int i = 0; i < m->threads; i++ ) {
+        workers[i].tree = m;
+        workers[i].random = seed + ( unsigned long long )( i + 1 ) * 0xBF58476D1CE4E5B9ULL;
+    }
+    for ( int i = 1; i < m->threads; i++ ) {
+        pthread_create( &threads[i], NULL, searchWorker, &workers[i] );
+    }
+    searchWorker( &workers[0] );
+    for ( int i = 1; i < m->threads; i++ ) {
+        pthread_join( threads[i], NULL );
+    }
+
+    // The most visited child is the most reliable choice.
+    unsigned short best = POSITION_NO_MOVE;
+    int bestVisits = -1;
+    for ( unsigned int i = 0; i < root->child_count; i++ ) {
+        mcts_node *child = &m->nodes[ root->first_child + i ];
+        if ( child->visits > bestVisits ) {
+            bestVisits = child->visits;
+            best = child->move;
+        }
+    }
+    return best;
+}
+
+// Ask a running search to stop.
+void mcts_stop( mcts* m )
+{
+    __atomic_store_n( &m->stop, true, __ATOMIC_SEQ_CST );
+}
+
+// Return monotonic time in milliseconds.
+long long mcts_now( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( long long )now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Thread entry point. Runs iterations until the search is stopped or a limit is reached.
+   @param arg is pointer to the worker struct of this thread.
+   @return is always NULL.
+*/
+static void* searchWorker( void* arg )
+{
+    worker *w = ( worker * )arg;
+    mcts *m = w->tree;
+    int iterations = 0;
+
+    while ( !__atomic_load_n( &m->stop, __ATOMIC_RELAXED ) ) {
+        runIteration( m, &w->random );
+
+        // Check the playout limit every iteration and the clock every few iterations.
+        long done = __atomic_add_fetch( &m->playouts, 1, __ATOMIC_RELAXED );
+        if ( m->max_playouts > 0 && done >= m->max_playouts ) {
+            mcts_stop( m );
+        }
+        if ( ++iterations % TIME_CHECK_INTERVAL == 0 && m->deadline > 0 &&
+             mcts_now() >= m->deadline ) {
+            mcts_stop( m );
+        }
+    }
+    return NULL;
+}
+
+/**
+   Runs one select, expand, playout and backup iteration from the root.
+   @param m is pointer to search tree.
+   @param random is state of this thread's random number generator.
+*/
+static void runIteration( mcts* m, unsigned long long* random )
+{
+    position p = m->root_position;
+    unsigned int path[ POSITION_MAX_MOVES + 1 ];
+    unsigned char movers[ POSITION_MAX_MOVES + 1 ];
+    int length = 0;
+
+    // Select: follow UCT down to a leaf, adding virtual loss to every node on the way.
+    mcts_node *node = &m->nodes[ m->root ];
+    while ( p.winner == EMPTY_INTERSECTION && !position_is_full( &p ) ) {
+        if ( __atomic_load_n( &node->state, __ATOMIC_ACQUIRE ) != MCTS_NODE_EXPANDED ) {
+            // Expand: grow the tree at leaves that have been visited enough. If another thread is
+            // expanding this node, or the arena is full, the playout starts from here instead.
+            if ( __atomic_load_n( &node->visits, __ATOMIC_RELAXED ) < EXPAND_VISITS ||
+                 !expandNode( m, node, &p ) ) {
+                break;
+            }
+        }
+        unsigned int child = selectChild( m, node, random );
+        node = &m->nodes[ child ];
+        __atomic_add_fetch( &node->virtual_loss, VIRTUAL_LOSS, __ATOMIC_RELAXED );
+        movers[ length ] = p.stone;
+        path[ length++ ] = child;
+        position_play( &p, node->move );
+    }
+
+    // Playout: finish the game from the leaf.
+    unsigned char result = p.winner;
+    if ( result == EMPTY_INTERSECTION && !position_is_full( &p ) ) {
+        result = playout( &p, random );
+    }
+
+    // Backup: score each node for the player who made its move and remove the virtual loss.
+    mcts_node *root = &m->nodes[ m->root ];
+    __atomic_add_fetch( &root->visits, 1, __ATOMIC_RELAXED );
+    for ( int i = 0; i < length; i++ ) {
+        mcts_node *n = &m->nodes[ path[i] ];
+        int score = result == movers[i] ? WIN_SCORE : ( result == EMPTY_INTERSECTION ? DRAW_SCORE : 0 );
+        __atomic_add_fetch( &n->visits, 1, __ATOMIC_RELAXED );
+        __atomic_add_fetch( &n->score, score, __ATOMIC_RELAXED );
+        __atomic_sub_fetch( &n->virtual_loss, VIRTUAL_LOSS, __ATOMIC_RELAXED );
+    }
+}
+
+/**
+   Picks the child of an expanded node with the highest UCT value. Virtual losses count as
+   visits without score, which steers concurrent threads into different branches. Unvisited
+   children are tried first, starting at a random child.
+   @param m is pointer to search tree.
+   @param parent is pointer to an expanded node.
+   @param random is state of this thread's random number generator.
+   @return is arena index of the chosen child.
+*/
+static unsigned int selectChild( mcts* m, mcts_node* parent, unsigned long long* random )
+{
+    unsigned int first = parent->first_child;
+    unsigned int count = parent->child_count;
+    unsigned int offset = nextRandom( random ) % count;
+    int parentVisits = __atomic_load_n( &parent->visits, __ATOMIC_RELAXED ) +
+                       __atomic_load_n( &parent->virtual_loss, __ATOMIC_RELAXED );
+    double logVisits = log( parentVisits + 1.0 );
+
+    unsigned int best = first + offset;
+    double bestValue = -1.0;
+    for ( unsigned int i = 0; i < count; i++ ) {
+        unsigned int index = first + ( offset + i ) % count;
+        mcts_node *child = &m->nodes[ index ];
+        int visits = __atomic_load_n( &child->visits, __ATOMIC_RELAXED ) +
+                     __atomic_load_n( &child->virtual_loss, __ATOMIC_RELAXED );
+        if ( visits == 0 ) {
+            return index;
+        }
+        double value = __atomic_load_n( &child->score, __ATOMIC_RELAXED ) / ( 2.0 * visits ) +
+                       EXPLORATION * sqrt( logVisits / visits );
+        if ( value > bestValue ) {
+            bestValue = value;
+            best = index;
+        }
+    }
+    return best;
+}
+
+/**
+   Expands a leaf by allocating one child per candidate move from the arena. Only one thread can
+   expand a node; others treat it as a leaf until the children are published.
+   @param m is pointer to search tree.
+   @param node is pointer to node to expand.
+   @param p is position at node.
+   @return is true if node is expanded, false if it could not be expanded right now.
+*/
+static bool expandNode( mcts* m, mcts_node* node, const position* p )
+{
+    unsigned short expected = MCTS_NODE_LEAF;
+    if ( !__atomic_compare_exchange_n( &node->state, &expected, MCTS_NODE_EXPANDING, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) {
+        return expected == MCTS_NODE_EXPANDED;
+    }
+
+    // A forced move (win or block) is the only child worth having.
+    unsigned short moves[ POSITION_MAX_MOVES ];
+    int count;
+    unsigned short urgent = position_urgent( p );
+    if ( urgent != POSITION_NO_MOVE ) {
+        moves[0] = urgent;
+        count = 1;
+    }
+    else {
+        count = position_candidates( p, moves );
+    }
+
+    // Reserve a block of the arena. If it does not fit, the node stays a leaf.
+    size_t first = __atomic_fetch_add( &m->used, count, __ATOMIC_RELAXED );
+    if ( count == 0 || first + count > m->capacity ) {
+        __atomic_store_n( &node->state, MCTS_NODE_LEAF, __ATOMIC_RELEASE );
+        return false;
+    }
+    for ( int i = 0; i < count; i++ ) {
+        mcts_node *child = &m->nodes[ first + i ];
+        memset( child, 0, sizeof( mcts_node ) );
+        child->move = moves[i];
+    }
+    node->first_child = first;
+    node->child_count = count;
+    __atomic_store_n( &node->state, MCTS_NODE_EXPANDED, __ATOMIC_RELEASE );
+    return true;
+}
+
+/**
+   Copies the subtree below root to the front of the arena, breadth first so every block of
+   children stays together, and frees everything else. No search may be running.
+   @param m is pointer to search tree.
+   @param root is arena index of the subtree root.
+   @return is new arena index of the subtree root, always 1.
+*/
+static unsigned int compactTree( mcts* m, unsigned int root )
+{
+    size_t used = m->used < m->capacity ? m->used : m->capacity;
+    mcts_node *copy = ( mcts_node * )malloc( used * sizeof( mcts_node ) );
+    if ( copy == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+
+    // Nodes already copied are visited in order, and their children appended after them.
+    copy[1] = m->nodes[ root ];
+    size_t next = 2;
+    for ( size_t i = 1; i < next; i++ ) {
+        mcts_node *node = &copy[i];
+        if ( node->state != MCTS_NODE_EXPANDED ) {
+            node->state = MCTS_NODE_LEAF;
+            continue;
+        }
+        memcpy( &copy[ next ], &m->nodes[ node->first_child ],
+                node->child_count * sizeof( mcts_node ) );
+        node->first_child = next;
+        next += node->child_count;
+    }
+
+    memcpy( &m->nodes[1], &copy[1], ( next - 1 ) * sizeof( mcts_node ) );
+    m->used = next;
+    free( copy );
+    return 1;
+}
+
+/**
+   Plays random moves from the candidate neighbourhood until the game ends. Wins are always taken
+   and opponent fives are always blocked. Candidates live in a list on the stack, so a playout
+   never allocates and never rescans the board.
+   @param p is position to play out. It is modified.
+   @param random is state of this thread's random number generator.
+   @return is winner, or EMPTY_INTERSECTION for a draw.
+*/
+static unsigned char playout( position* p, unsigned long long* random )
+{
+    unsigned short candidates[ POSITION_MAX_MOVES ];
+    short slots[ POSITION_AREA ];
+    int count = 0;
+
+    // Build the candidate list, remembering where each intersection is stored.
+    for ( int i = 0; i < POSITION_AREA; i++ ) {
+        slots[i] = -1;
+        if ( p->cells[i] == EMPTY_INTERSECTION && p->near[i] > 0 ) {
+            slots[i] = count;
+            candidates[ count++ ] = i;
+        }
+    }
+
+    while ( p->winner == EMPTY_INTERSECTION && count > 0 ) {
+        // Win with a five near our last stone, block a five near theirs, or play randomly.
+        unsigned short move = POSITION_NO_MOVE;
+        if ( p->count >= 2 ) {
+            move = position_five_near( p, p->history[ p->count - 2 ], p->stone );
+        }
+        if ( move == POSITION_NO_MOVE && p->count >= 1 ) {
+            move = position_five_near( p, p->history[ p->count - 1 ], POSITION_OPPONENT( p->stone ) );
+        }
+        if ( move == POSITION_NO_MOVE || slots[ move ] < 0 ) {
+            move = candidates[ nextRandom( random ) % count ];
+        }
+
+        // Remove move from the list by swapping the last candidate into its slot.
+        int slot = slots[ move ];
+        candidates[ slot ] = candidates[ --count ];
+        slots[ candidates[ slot ] ] = slot;
+        slots[ move ] = -1;
+        position_play( p, move );
+
+        // Add the empty intersections that just entered the neighbourhood.
+        for ( int dy = -NEAR_RADIUS; dy <= NEAR_RADIUS; dy++ ) {
+            for ( int dx = -NEAR_RADIUS; dx <= NEAR_RADIUS; dx++ ) {
+                int i = move + dy * POSITION_STRIDE + dx;
+                if ( p->cells[i] == EMPTY_INTERSECTION && slots[i] < 0 ) {
+                    slots[i] = count;
+                    candidates[ count++ ] = i;
+                }
+            }
+        }
+    }
+    return p->winner;
+}
+
+/**
+   Returns the next number of a xorshift64* random number generator.
+   @param state is generator state, updated in place. Must not be 0.
+   @return is next random number.
+*/
+static unsigned long long nextRandom( unsigned long long* state )
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
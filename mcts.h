@@ -0,0 +1,130 @@
+/**
+   @file mcts.h
+   @author Michael Warstler (mwwarstl)
+   Header file for the Monte Carlo Tree Search engine. Tree nodes are allocated from a single
+   arena that is reused between searches (the subtree of the moves actually played is kept), and
+   several threads descend the tree at the same time.
+   Threads spread out over different branches by applying a virtual loss to every node they are
+   currently exploring. Leaves are scored with fast, allocation free playouts over positions.
+*/
+
+#ifndef _MCTS_H_
+#define _MCTS_H_
+#include "position.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/** Node has not been expanded yet */
+#define MCTS_NODE_LEAF 0
+/** Node is being expanded by a thread */
+#define MCTS_NODE_EXPANDING 1
+/** Node children are available */
+#define MCTS_NODE_EXPANDED 2
+
+/**
+   A node in the search tree. Fields are described as follows:
+   move - position index of the move leading to this node.
+   state - MCTS_NODE_LEAF, MCTS_NODE_EXPANDING or MCTS_NODE_EXPANDED.
+   child_count - number of children, stored next to each other in the arena.
+   first_child - arena index of the first child.
+   visits - number of playouts through this node.
+   score - playout results for the player who made move, 2 per win and 1 per draw.
+   virtual_loss - pending visits of threads currently below this node.
+*/
+typedef struct {
+    unsigned short move;
+    unsigned short state;
+    unsigned int child_count;
+    unsigned int first_child;
+    int visits;
+    int score;
+    int virtual_loss;
+} mcts_node;
+
+/**
+   Fields are described as follows:
+   nodes - dynamically allocated arena of nodes.
+   capacity - number of nodes in the arena.
+   used - number of nodes handed out so far. Index 0 is never used.
+   root - arena index of the root node.
+   root_position - position the search starts from.
+   threads - number of threads descending the tree.
+   stop - set to end a running search.
+   playouts - number of playouts completed by the current search.
+   max_playouts - playout limit of the current search, 0 if unlimited.
+   deadline - monotonic time in milliseconds the current search must end by, 0 if unlimited.
+*/
+typedef struct {
+    mcts_node* nodes;
+    size_t capacity;
+    size_t used;
+    unsigned int root;
+    position root_position;
+    int threads;
+    bool stop;
+    long playouts;
+    long max_playouts;
+    long long deadline;
+} mcts;
+
+/**
+   Creates a new dynamically allocated search tree with room for max_nodes nodes.
+   @param max_nodes is size of the node arena.
+   @param threads is number of search threads, at least 1.
+   @return is pointer to search tree.
+*/
+mcts* mcts_create( size_t max_nodes, int threads );
+
+/**
+   Frees memory of the search tree and its node arena.
+   If parameter is NULL, program exits with error.
+   @param m is pointer to search tree.
+*/
+void mcts_delete( mcts* m );
+
+/**
+   Searches position p until max_playouts playouts are done or max_millis milliseconds have
+   passed, whichever comes first (0 means no limit for either, but at least one should be set).
+   Same as mcts_prepare() followed by mcts_run().
+   @param m is pointer to search tree.
+   @param p is position to search, which must have a player to move.
+   @param max_playouts is playout limit.
+   @param max_millis is time limit in milliseconds.
+   @return is position index of the most visited move, or POSITION_NO_MOVE if there is none.
+*/
+unsigned short mcts_search( mcts* m, const position* p, long max_playouts, long max_millis );
+
+/**
+   Gets the tree ready to search position p and clears any stop request. If p follows from the
+   previous root by one or two moves that are already in the tree, that subtree becomes the new
+   root and its statistics are kept. Otherwise the arena is reset.
+   @param m is pointer to search tree.
+   @param p is position to search, which must have a player to move.
+   @return is true if the previous search was reused, false if the tree starts empty.
+*/
+bool mcts_prepare( mcts* m, const position* p );
+
+/**
+   Searches the prepared root until a limit is reached or mcts_stop() is called (0 means no
+   limit). A stop requested after mcts_prepare() but before this call ends the search right
+   away, which lets another thread cancel a background search at any time.
+   @param m is pointer to search tree.
+   @param max_playouts is playout limit.
+   @param max_millis is time limit in milliseconds.
+   @return is position index of the most visited move, or POSITION_NO_MOVE if there is none.
+*/
+unsigned short mcts_run( mcts* m, long max_playouts, long max_millis );
+
+/**
+   Asks a running search to stop as soon as possible. Safe to call from another thread.
+   @param m is pointer to search tree.
+*/
+void mcts_stop( mcts* m );
+
+/**
+   Returns the current monotonic time in milliseconds. Used for search deadlines.
+   @return is milliseconds since an arbitrary fixed point.
+*/
+long long mcts_now( void );
+
+#endif
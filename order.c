@@ -0,0 +1,228 @@
+/**
+   @file order.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for move ordering. Each scheme is a scoring function; moves are then
+   sorted by score. Threat scores always outrank killer scores, which outrank history scores.
+*/
+
+#include "order.h"
+#include <string.h>
+
+/** The amount of stone connections required to win */
+#define NEEDED_CONNECTIONS 5
+/** Score of a move that wins */
+#define SCORE_WIN ( 1 << 30 )
+/** Score of a move that blocks an opponent five */
+#define SCORE_BLOCK_FIVE ( 1 << 29 )
+/** Score of a move that makes an open four */
+#define SCORE_OPEN_FOUR ( 1 << 28 )
+/** Score of a move that makes a four or blocks an opponent four */
+#define SCORE_FOUR ( 1 << 27 )
+/** Score of a move that blocks an opponent open three from becoming an open four */
+#define SCORE_BLOCK_FOUR ( 1 << 26 )
+/** Score of a move that makes an open three */
+#define SCORE_OPEN_THREE ( 1 << 25 )
+/** Score of the first killer move; later killers score less */
+#define SCORE_KILLER ( 1 << 24 )
+/** History scores are kept below the killer scores */
+#define HISTORY_LIMIT ( 1 << 22 )
+
+/** Scores every move in the list. Each ordering scheme is one of these. */
+typedef void (*move_scorer)( const move_orderer* o, const position* p, int ply,
+                             const unsigned short* moves, int* scores, int count );
+
+// Prototypes for the static scoring functions and helpers.
+static void scoreNone( const move_orderer* o, const position* p, int ply,
+                       const unsigned short* moves, int* scores, int count );
+static void scoreThreats( const move_orderer* o, const position* p, int ply,
+                          const unsigned short* moves, int* scores, int count );
+static void scoreFull( const move_orderer* o, const position* p, int ply,
+                       const unsigned short* moves, int* scores, int count );
+static int threatScore( const position* p, unsigned short move );
+
+const char* const order_names[ ORDER_SCHEMES ] = { "none", "threats", "full" };
+
+/** Scoring function of each scheme, indexed by scheme */
+static const move_scorer scorers[ ORDER_SCHEMES ] = { scoreNone, scoreThreats, scoreFull };
+
+// Initialize an orderer with empty tables.
+void order_init( move_orderer* o, unsigned char scheme )
+{
+    o->scheme = scheme < ORDER_SCHEMES ? scheme : ORDER_FULL;
+    memset( o->killers, 0, sizeof( o->killers ) );
+    memset( o->history, 0, sizeof( o->history ) );
+}
+
+// Clear killers and age history before a new search.
+void order_new_search( move_orderer* o )
+{
+    memset( o->killers, 0, sizeof( o->killers ) );
+    for ( int s = 0; s < 3; s++ ) {
+        for ( int i = 0; i < POSITION_AREA; i++ ) {
+            o->history[s][i] /= 2;
+        }
+    }
+}
+
+// Sort moves best first.
+void order_moves( const move_orderer* o, const position* p, int ply, unsigned short* moves,
+                  int count )
+{
+    int scores[ POSITION_MAX_MOVES ];
+    scorers[ o->scheme ]( o, p, ply, moves, scores, count );
+
+    // Insertion sort: lists are short and often nearly sorted already.
+    for ( int i = 1; i < count; i++ ) {
+        unsigned short move = moves[i];
+        int score = scores[i];
+        int j = i - 1;
+        while ( j >= 0 && scores[j] < score ) {
+            moves[ j + 1 ] = moves[j];
+            scores[ j + 1 ] = scores[j];
+            j--;
+        }
+        moves[ j + 1 ] = move;
+        scores[ j + 1 ] = score;
+    }
+}
+
+// Remember a move that caused a cutoff.
+void order_cutoff( move_orderer* o, const position* p, int ply, unsigned short move, int depth )
+{
+    // Shift the killers down unless move is already the first one.
+    if ( ply < ORDER_MAX_PLY && o->killers[ ply ][0] != move ) {
+        for ( int k = ORDER_KILLERS - 1; k > 0; k-- ) {
+            o->killers[ ply ][k] = o->killers[ ply ][ k - 1 ];
+        }
+        o->killers[ ply ][0] = move;
+    }
+
+    // Halve the whole table for this stone when an entry grows too large.
+    unsigned int *history = o->history[ p->stone ];
+    history[ move ] += depth * depth;
+    if ( history[ move ] >= HISTORY_LIMIT ) {
+        for ( int i = 0; i < POSITION_AREA; i++ ) {
+            history[i] /= 2;
+        }
+    }
+}
+
+// Look up a scheme by name.
+unsigned char order_scheme( const char* name )
+{
+    for ( unsigned char s = 0; s < ORDER_SCHEMES; s++ ) {
+        if ( strcmp( name, order_names[s] ) == 0 ) {
+            return s;
+        }
+    }
+    return ORDER_SCHEMES;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Scheme ORDER_NONE. Every move scores the same, so candidate order is kept.
+   @param o is pointer to move orderer.
+   @param p is pointer to position.
+   @param ply is distance from the root of the search.
+   @param moves is array of move indices.
+   @param scores is array to store one score per move in.
+   @param count is number of moves.
+*/
+static void scoreNone( const move_orderer* o, const position* p, int ply,
+                       const unsigned short* moves, int* scores, int count )
+{
+    for ( int i = 0; i < count; i++ ) {
+        scores[i] = 0;
+    }
+}
+
+/**
+   Scheme ORDER_THREATS. Moves are scored by the threats they make or block only.
+   @param o is pointer to move orderer.
+   @param p is pointer to position.
+   @param ply is distance from the root of the search.
+   @param moves is array of move indices.
+   @param scores is array to store one score per move in.
+   @param count is number of moves.
+*/
+static void scoreThreats( const move_orderer* o, const position* p, int ply,
+                          const unsigned short* moves, int* scores, int count )
+{
+    for ( int i = 0; i < count; i++ ) {
+        scores[i] = threatScore( p, moves[i] );
+    }
+}
+
+/**
+   Scheme ORDER_FULL. Threats first, then killer moves of this ply, then history.
+   @param o is pointer to move orderer.
+   @param p is pointer to position.
+   @param ply is distance from the root of the search.
+   @param moves is array of move indices.
+   @param scores is array to store one score per move in.
+   @param count is number of moves.
+*/
+static void scoreFull( const move_orderer* o, const position* p, int ply,
+                       const unsigned short* moves, int* scores, int count )
+{
+    const unsigned int *history = o->history[ p->stone ];
+    for ( int i = 0; i < count; i++ ) {
+        int score = threatScore( p, moves[i] );
+        if ( score == 0 ) {
+            score = history[ moves[i] ];
+            for ( int k = 0; k < ORDER_KILLERS && ply < ORDER_MAX_PLY; k++ ) {
+                if ( o->killers[ ply ][k] == moves[i] ) {
+                    score = SCORE_KILLER >> k;
+                    break;
+                }
+            }
+        }
+        scores[i] = score;
+    }
+}
+
+/**
+   Scores the strongest threat a move makes for the player to move, or blocks for the opponent.
+   @param p is pointer to position.
+   @param move is an empty intersection index.
+   @return is threat score, 0 if move neither makes nor blocks a threat.
+*/
+static int threatScore( const position* p, unsigned short move )
+{
+    unsigned char opponent = POSITION_OPPONENT( p->stone );
+    int best = 0;
+
+    for ( int d = 0; d < POSITION_DIRECTIONS; d++ ) {
+        int ends;
+        int own = position_run( p, move, d, p->stone, &ends );
+        int score = 0;
+        if ( own >= NEEDED_CONNECTIONS ) {
+            score = SCORE_WIN;
+        }
+        else if ( own == NEEDED_CONNECTIONS - 1 ) {
+            score = ends == 2 ? SCORE_OPEN_FOUR : ( ends == 1 ? SCORE_FOUR : 0 );
+        }
+        else if ( own == NEEDED_CONNECTIONS - 2 && ends == 2 ) {
+            score = SCORE_OPEN_THREE;
+        }
+
+        // Stones of the opponent this move would sit next to.
+        int their = position_run( p, move, d, opponent, &ends );
+        if ( their >= NEEDED_CONNECTIONS ) {
+            score = score > SCORE_BLOCK_FIVE ? score : SCORE_BLOCK_FIVE;
+        }
+        else if ( their == NEEDED_CONNECTIONS - 1 && ends > 0 ) {
+            score = score > SCORE_FOUR ? score : SCORE_FOUR;
+        }
+        else if ( their == NEEDED_CONNECTIONS - 2 && ends == 2 ) {
+            score = score > SCORE_BLOCK_FOUR ? score : SCORE_BLOCK_FOUR;
+        }
+        best = score > best ? score : best;
+    }
+    return best;
+}
@@ -0,0 +1,84 @@
+/**
+   @file order.h
+   @author Michael Warstler (mwwarstl)
+   Header file for move ordering used by the alpha-beta search. Moves are sorted threat first
+   (wins, blocks of fives, fours and blocks of fours, open threes), then by killer moves of the
+   current ply, then by a history table indexed by stone and intersection. Ordering schemes are
+   pluggable so they can be benchmarked against each other.
+*/
+
+#ifndef _ORDER_H_
+#define _ORDER_H_
+#include "position.h"
+
+/** Moves are searched in candidate order */
+#define ORDER_NONE 0
+/** Moves are sorted by threats only */
+#define ORDER_THREATS 1
+/** Moves are sorted by threats, then killer moves, then history */
+#define ORDER_FULL 2
+/** Number of ordering schemes */
+#define ORDER_SCHEMES 3
+/** Deepest ply with its own killer moves */
+#define ORDER_MAX_PLY 64
+/** Number of killer moves kept per ply */
+#define ORDER_KILLERS 2
+
+/**
+   Fields are described as follows:
+   scheme - ordering scheme in use. (ORDER_NONE, ORDER_THREATS or ORDER_FULL)
+   killers - per ply, the most recent quiet moves that caused a cutoff.
+   history - per stone and intersection, how often (weighted by depth) a move caused a cutoff.
+*/
+typedef struct {
+    unsigned char scheme;
+    unsigned short killers[ ORDER_MAX_PLY ][ ORDER_KILLERS ];
+    unsigned int history[3][ POSITION_AREA ];
+} move_orderer;
+
+/** Short names of the ordering schemes, indexed by scheme */
+extern const char* const order_names[ ORDER_SCHEMES ];
+
+/**
+   Initializes a move orderer with empty killer and history tables.
+   @param o is pointer to move orderer.
+   @param scheme is ordering scheme to use.
+*/
+void order_init( move_orderer* o, unsigned char scheme );
+
+/**
+   Prepares the tables for a new search. Killers are cleared and history is aged, so moves
+   that were good in the previous search still get tried early.
+   @param o is pointer to move orderer.
+*/
+void order_new_search( move_orderer* o );
+
+/**
+   Sorts moves for the player to move, best first, using the orderer's scheme.
+   @param o is pointer to move orderer.
+   @param p is pointer to position.
+   @param ply is distance from the root of the search.
+   @param moves is array of candidate move indices, sorted in place.
+   @param count is number of moves.
+*/
+void order_moves( const move_orderer* o, const position* p, int ply, unsigned short* moves,
+                  int count );
+
+/**
+   Records a move that caused a beta cutoff, as a killer for its ply and in the history table.
+   @param o is pointer to move orderer.
+   @param p is pointer to position the move was made from.
+   @param ply is distance from the root of the search.
+   @param move is index of the move.
+   @param depth is remaining depth at the cutoff. Deeper cutoffs weigh more.
+*/
+void order_cutoff( move_orderer* o, const position* p, int ply, unsigned short move, int depth );
+
+/**
+   Finds an ordering scheme by its short name.
+   @param name is scheme name, as in order_names.
+   @return is scheme, or ORDER_SCHEMES if name is not known.
+*/
+unsigned char order_scheme( const char* name );
+
+#endif
@@ -0,0 +1,334 @@
+/**
+   @file pbrain.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for the Gomocup (Piskvork) protocol brain. Tournament managers start
+   the brain, send commands on stdin and read answers on stdout, one per line. Moves are checked
+   with the same game rules as gomoku/renju and chosen by the computer player.
+*/
+
+#include "error-codes.h"
+#include "game.h"
+#include "engine.h"
+#include "book.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/** How many command line arguments allowed at maximum */
+#define MAX_ARGUMENTS 3
+/** Longest command line read from the manager */
+#define MAX_LINE_LENGTH 256
+/** Time per move until the manager sends one, in milliseconds */
+#define DEFAULT_TIMEOUT_TURN 5000
+/** Moves the remaining match time is shared between */
+#define MOVES_TO_PLAN 25
+/** Part of each move's time held back for safety (1 / SAFETY_FRACTION) */
+#define SAFETY_FRACTION 10
+/** Milliseconds held back for reading, writing and starting/stopping threads */
+#define OVERHEAD_MILLIS 30
+/** Gomocup rule bit selecting renju */
+#define RULE_RENJU 4
+/** BOARD field for the brain's own stones */
+#define FIELD_OWN 1
+/** BOARD field for the opponent's stones */
+#define FIELD_OPPONENT 2
+
+/**
+   State of the brain between commands. Fields are described as follows:
+   current - game being played, NULL before the first START.
+   computer - engine choosing the brain's moves.
+   size - board size of the current game.
+   type - game type selected by the manager's rule. (GAME_FREESTYLE or GAME_RENJU)
+   timeout_turn - time limit per move in milliseconds, 0 to play as fast as possible.
+   timeout_match - time limit for the whole match in milliseconds, 0 if unlimited.
+   time_left - match time remaining in milliseconds.
+*/
+typedef struct {
+    game* current;
+    engine* computer;
+    unsigned char size;
+    unsigned char type;
+    long timeout_turn;
+    long timeout_match;
+    long time_left;
+} brain;
+
+// Prototypes for static functions that handle manager commands.
+static void startGame( brain* b, int size );
+static void readInfo( brain* b, const char* key, const char* value );
+static void readBoard( brain* b, long long received );
+static void takeBack( brain* b, const char* coords );
+static void playReply( brain* b, long long received );
+static bool parseMove( const brain* b, const char* coords, unsigned char* x, unsigned char* y );
+
+/**
+   Answers manager commands until END or end of input. The optional key argument is "-k" followed
+   by the path of an opening book.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status
+*/
+int main(int argc, char **argv)
+{
+    book *openings = NULL;
+    if ( argc == MAX_ARGUMENTS && strcmp( argv[1], "-k" ) == 0 ) {
+        openings = book_open( argv[2] );
+        if ( openings == NULL ) {
+            exit( FILE_INPUT_ERR );
+        }
+    }
+    else if ( argc != 1 ) {
+        printf( "usage: ./pbrain [-k <opening-book>]\n" );
+        exit( ARGUMENT_ERR );
+    }
+
+    // Managers read answers through a pipe, so every line must go out right away.
+    setvbuf( stdout, NULL, _IOLBF, 0 );
+    brain b = { NULL, NULL, 0, GAME_FREESTYLE, DEFAULT_TIMEOUT_TURN, 0, 0 };
+    b.computer = engine_create( ENGINE_MCTS, 0, DEFAULT_TIMEOUT_TURN );
+    b.computer->book = openings;
+
+    char line[ MAX_LINE_LENGTH ];
+    while ( fgets( line, sizeof( line ), stdin ) != NULL ) {
+        long long received = mcts_now();
+
+        // Split the line into an upper case command and its arguments.
+        char command[ MAX_LINE_LENGTH ] = "";
+        char first[ MAX_LINE_LENGTH ] = "";
+        char second[ MAX_LINE_LENGTH ] = "";
+        if ( sscanf( line, "%s %s %s", command, first, second ) < 1 ) {
+            continue;
+        }
+        for ( char *c = command; *c; c++ ) {
+            *c = toupper( ( unsigned char )*c );
+        }
+
+        if ( strcmp( command, "START" ) == 0 ) {
+            startGame( &b, atoi( first ) );
+        }
+        else if ( strcmp( command, "RESTART" ) == 0 ) {
+            startGame( &b, b.size );
+        }
+        else if ( strcmp( command, "INFO" ) == 0 ) {
+            readInfo( &b, first, second );
+        }
+        else if ( strcmp( command, "END" ) == 0 ) {
+            break;
+        }
+        else if ( strcmp( command, "ABOUT" ) == 0 ) {
+            printf( "name=\"gomoku\", version=\"1.0\", author=\"Michael Warstler\"\n" );
+        }
+        else if ( b.current == NULL ) {
+            printf( "ERROR no game started\n" );
+        }
+        else if ( strcmp( command, "BEGIN" ) == 0 ) {
+            playReply( &b, received );
+        }
+        else if ( strcmp( command, "TURN" ) == 0 ) {
+            // The opponent's move must be legal before the brain replies.
+            unsigned char x;
+            unsigned char y;
+            if ( parseMove( &b, first, &x, &y ) && game_place_stone( b.current, x, y ) ) {
+                playReply( &b, received );
+            }
+            else {
+                printf( "ERROR invalid move\n" );
+            }
+        }
+        else if ( strcmp( command, "BOARD" ) == 0 ) {
+            readBoard( &b, received );
+        }
+        else if ( strcmp( command, "TAKEBACK" ) == 0 ) {
+            takeBack( &b, first );
+        }
+        else {
+            printf( "UNKNOWN command\n" );
+        }
+    }
+
+    // Free the game, computer player and book, then exit.
+    if ( b.current != NULL ) {
+        game_delete( b.current );
+    }
+    engine_delete( b.computer );
+    if ( openings != NULL ) {
+        book_close( openings );
+    }
+    return SUCCESS;
+}
+
+/**
+   Starts a new empty game. Only the board sizes gomoku/renju support are accepted.
+   @param b is pointer to brain.
+   @param size is board size requested by the manager.
+*/
+static void startGame( brain* b, int size )
+{
+    if ( size != BOARD_SIZE_15 && size != BOARD_SIZE_17 && size != BOARD_SIZE_19 ) {
+        printf( "ERROR unsupported board size\n" );
+        return;
+    }
+    if ( b->current != NULL ) {
+        game_delete( b->current );
+    }
+    b->size = ( unsigned char )size;
+    b->current = game_create( b->size, b->type );
+    b->current->quiet = true;
+    printf( "OK\n" );
+}
+
+/**
+   Stores one INFO setting. Unknown keys are ignored, as the protocol requires. A new rule takes
+   effect right away if no stones have been placed yet, otherwise with the next game.
+   @param b is pointer to brain.
+   @param key is name of the setting.
+   @param value is value of the setting.
+*/
+static void readInfo( brain* b, const char* key, const char* value )
+{
+    if ( strcmp( key, "timeout_turn" ) == 0 ) {
+        b->timeout_turn = atol( value );
+    }
+    else if ( strcmp( key, "timeout_match" ) == 0 ) {
+        b->timeout_match = atol( value );
+    }
+    else if ( strcmp( key, "time_left" ) == 0 ) {
+        b->time_left = atol( value );
+    }
+    else if ( strcmp( key, "max_memory" ) == 0 ) {
+        engine_limit_memory( b->computer, strtoull( value, NULL, 10 ) );
+    }
+    else if ( strcmp( key, "rule" ) == 0 ) {
+        b->type = atoi( value ) & RULE_RENJU ? GAME_RENJU : GAME_FREESTYLE;
+        if ( b->current != NULL && b->current->moves_count == 0 ) {
+            b->current->type = b->type;
+        }
+    }
+}
+
+/**
+   Reads the stones of a BOARD command up to DONE, replays them as a new game and replies. Black
+   is whoever has more stones, or the brain if both have the same number.
+   @param b is pointer to brain.
+   @param received is time the command was received, from mcts_now().
+*/
+static void readBoard( brain* b, long long received )
+{
+    move own[ POSITION_MAX_MOVES ];
+    move opponent[ POSITION_MAX_MOVES ];
+    int ownCount = 0;
+    int opponentCount = 0;
+    bool valid = true;
+
+    char line[ MAX_LINE_LENGTH ];
+    while ( fgets( line, sizeof( line ), stdin ) != NULL && strncmp( line, "DONE", 4 ) != 0 ) {
+        int x;
+        int y;
+        int field;
+        if ( sscanf( line, "%d,%d,%d", &x, &y, &field ) != 3 || x < 0 || y < 0 ||
+             x >= b->size || y >= b->size || ownCount + opponentCount >= POSITION_MAX_MOVES ) {
+            valid = false;
+        }
+        else if ( field == FIELD_OWN ) {
+            own[ ownCount++ ] = ( move ){ x, y, EMPTY_INTERSECTION };
+        }
+        else if ( field == FIELD_OPPONENT ) {
+            opponent[ opponentCount++ ] = ( move ){ x, y, EMPTY_INTERSECTION };
+        }
+    }
+
+    // Moves alternate, so the counts may differ by one at most, in black's favour.
+    move *black = ownCount == opponentCount ? own : opponent;
+    move *white = ownCount == opponentCount ? opponent : own;
+    int blackCount = ownCount == opponentCount ? ownCount : opponentCount;
+    int whiteCount = ownCount == opponentCount ? opponentCount : ownCount;
+    if ( !valid || blackCount - whiteCount < 0 || blackCount - whiteCount > 1 ) {
+        printf( "ERROR invalid board\n" );
+        return;
+    }
+
+    game_delete( b->current );
+    b->current = game_create( b->size, b->type );
+    b->current->quiet = true;
+    for ( int i = 0; i < blackCount; i++ ) {
+        if ( !game_place_stone( b->current, black[i].x, black[i].y ) ||
+             ( i < whiteCount && !game_place_stone( b->current, white[i].x, white[i].y ) ) ) {
+            printf( "ERROR invalid board\n" );
+            return;
+        }
+    }
+    playReply( b, received );
+}
+
+/**
+   Takes back the most recent move, which must be at the given coordinates. Games have no undo,
+   so the game is replayed without its last move.
+   @param b is pointer to brain.
+   @param coords is "x,y" of the move to take back.
+*/
+static void takeBack( brain* b, const char* coords )
+{
+    game *old = b->current;
+    unsigned char x;
+    unsigned char y;
+    if ( !parseMove( b, coords, &x, &y ) || old->moves_count == 0 ||
+         old->moves[ old->moves_count - 1 ].x != x || old->moves[ old->moves_count - 1 ].y != y ) {
+        printf( "ERROR invalid takeback\n" );
+        return;
+    }
+
+    b->current = game_create( b->size, old->type );
+    b->current->quiet = true;
+    for ( size_t i = 0; i + 1 < old->moves_count; i++ ) {
+        game_place_stone( b->current, old->moves[i].x, old->moves[i].y );
+    }
+    game_delete( old );
+    printf( "OK\n" );
+}
+
+/**
+   Chooses, plays and prints the brain's move. Thinking time is the turn limit, cut down to a
+   share of the remaining match time, minus a safety margin and the time already spent since the
+   command arrived.
+   @param b is pointer to brain.
+   @param received is time the command was received, from mcts_now().
+*/
+static void playReply( brain* b, long long received )
+{
+    long budget = b->timeout_turn;
+    if ( b->timeout_match > 0 && b->time_left / MOVES_TO_PLAN < budget ) {
+        budget = b->time_left / MOVES_TO_PLAN;
+    }
+    budget -= budget / SAFETY_FRACTION + OVERHEAD_MILLIS + ( mcts_now() - received );
+    b->computer->millis = budget > 1 ? budget : 1;
+
+    unsigned char x;
+    unsigned char y;
+    if ( !engine_choose( b->computer, b->current, &x, &y ) || !game_place_stone( b->current, x, y ) ) {
+        printf( "ERROR no move available\n" );
+        return;
+    }
+    printf( "%d,%d\n", x, y );
+}
+
+/**
+   Reads "x,y" coordinates sent by the manager.
+   @param b is pointer to brain.
+   @param coords is string holding the coordinates.
+   @param x is pointer to x/horizontal coordinate.
+   @param y is pointer to y/vertical coordinate.
+   @return is true if both coordinates are on the board, otherwise false.
+*/
+static bool parseMove( const brain* b, const char* coords, unsigned char* x, unsigned char* y )
+{
+    int column;
+    int row;
+    if ( sscanf( coords, "%d,%d", &column, &row ) != 2 || column < 0 || row < 0 ||
+         column >= b->size || row >= b->size ) {
+        return false;
+    }
+    *x = column;
+    *y = row;
+    return true;
+}
@@ -0,0 +1,364 @@
+/**
+   @file posindex.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for position indexes. Building one is done in three steps: every game is
+   replayed into its own slots of one large entry array, the array is cut into one slice per
+   thread and each slice is sorted, then slices are merged in pairs until one is left.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "posindex.h"
+#include "error-codes.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Games a thread replays each time it takes more work */
+#define GAMES_PER_TASK 256
+/** Game number given to the slots of damaged games, which are dropped before sorting */
+#define NO_GAME 0xFFFFFFFFu
+
+/**
+   Replay work shared by all threads. Fields are described as follows:
+   db - database being indexed.
+   starts - for every game, its first slot in entries. One more than the number of games.
+   entries - slots for every position of every game.
+   next - number of the next game a thread should take.
+*/
+typedef struct {
+    const gamedb* db;
+    const size_t* starts;
+    posindex_entry* entries;
+    size_t next;
+} replayWork;
+
+/**
+   One sort or merge task. Fields are described as follows:
+   from - entries to sort, or the two runs to merge.
+   to - where merged entries go. Not used when sorting.
+   start - first entry of the task.
+   middle - first entry of the second run. Not used when sorting.
+   end - one past the last entry of the task.
+*/
+typedef struct {
+    posindex_entry* from;
+    posindex_entry* to;
+    size_t start;
+    size_t middle;
+    size_t end;
+} sortTask;
+
+// Prototypes for static functions that build the index.
+static void* replayWorker( void* arg );
+static void* sortWorker( void* arg );
+static void* mergeWorker( void* arg );
+static void runTasks( void* ( *worker )( void* ), sortTask* tasks, int count );
+static int compareEntries( const void* a, const void* b );
+
+// Map a position index file into memory.
+posindex* posindex_open( const char* path )
+{
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        return NULL;
+    }
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || ( size_t )info.st_size < sizeof( posindex_header ) ) {
+        close( fd );
+        return NULL;
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    void *mapping = mmap( NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( mapping == MAP_FAILED ) {
+        return NULL;
+    }
+
+    // Check header and that the file holds exactly the entries it claims to.
+    const posindex_header *header = ( const posindex_header * )mapping;
+    size_t length = info.st_size;
+    if ( memcmp( header->magic, POSINDEX_MAGIC, sizeof( header->magic ) ) != 0 ||
+         header->version != POSINDEX_VERSION ||
+         ( length - sizeof( posindex_header ) ) % sizeof( posindex_entry ) != 0 ||
+         header->count != ( length - sizeof( posindex_header ) ) / sizeof( posindex_entry ) ) {
+        munmap( mapping, length );
+        return NULL;
+    }
+
+    posindex *x = ( posindex * )malloc( sizeof( posindex ) );
+    x->entries = ( const posindex_entry * )( header + 1 );
+    x->count = header->count;
+    x->games = header->games;
+    x->mapping = mapping;
+    x->length = length;
+    return x;
+}
+
+// Unmap and free a position index.
+void posindex_close( posindex* x )
+{
+    if ( x == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    munmap( x->mapping, x->length );
+    free( x );
+}
+
+// Find every game that reached a position.
+size_t posindex_find( const posindex* x, const position* p, const posindex_entry** first )
+{
+    unsigned long long key = position_key( p, NULL );
+
+    // Binary search for the first entry with this key, then for the first one past it.
+    size_t low = 0;
+    size_t high = x->count;
+    while ( low < high ) {
+        size_t middle = low + ( high - low ) / 2;
+        if ( x->entries[ middle ].key < key ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    size_t start = low;
+    high = x->count;
+    while ( low < high ) {
+        size_t middle = low + ( high - low ) / 2;
+        if ( x->entries[ middle ].key <= key ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    *first = x->entries + start;
+    return low - start;
+}
+
+// Build and write the position index of a database.
+unsigned char posindex_build( const gamedb* db, const char* path, int max_plies, int threads )
+{
+    // Every game gets one slot per indexed move.
+    size_t *starts = ( size_t * )malloc( ( db->count + 1 ) * sizeof( size_t ) );
+    starts[0] = 0;
+    for ( size_t i = 0; i < db->count; i++ ) {
+        size_t plies = db->entries[i].moves;
+        if ( max_plies > 0 && plies > ( size_t )max_plies ) {
+            plies = max_plies;
+        }
+        starts[ i + 1 ] = starts[i] + plies;
+    }
+    size_t count = starts[ db->count ];
+    posindex_entry *entries =
+        ( posindex_entry * )malloc( ( count + 1 ) * sizeof( posindex_entry ) );
+
+    // Replay the games on every thread.
+    replayWork work = { db, starts, entries, 0 };
+    pthread_t *workers = ( pthread_t * )malloc( threads * sizeof( pthread_t ) );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_create( &workers[i], NULL, replayWorker, &work );
+    }
+    replayWorker( &work );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+    free( workers );
+    free( starts );
+
+    // Drop the slots damaged games did not fill.
+    size_t kept = 0;
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( entries[i].game != NO_GAME ) {
+            entries[ kept++ ] = entries[i];
+        }
+    }
+    count = kept;
+
+    // Sort one slice per thread, then merge neighbouring slices until one is left.
+    posindex_entry *buffer =
+        ( posindex_entry * )malloc( ( count + 1 ) * sizeof( posindex_entry ) );
+    sortTask *tasks = ( sortTask * )malloc( threads * sizeof( sortTask ) );
+    size_t *bounds = ( size_t * )malloc( ( threads + 1 ) * sizeof( size_t ) );
+    for ( int i = 0; i <= threads; i++ ) {
+        bounds[i] = count * i / threads;
+    }
+    for ( int i = 0; i < threads; i++ ) {
+        tasks[i] = ( sortTask ){ entries, NULL, bounds[i], bounds[ i + 1 ], bounds[ i + 1 ] };
+    }
+    runTasks( sortWorker, tasks, threads );
+    posindex_entry *sorted = entries;
+    for ( int slices = threads; slices > 1; slices = ( slices + 1 ) / 2 ) {
+        // An odd slice out is merged with nothing, which copies it.
+        posindex_entry *other = sorted == entries ? buffer : entries;
+        int merges = ( slices + 1 ) / 2;
+        for ( int i = 0; i < merges; i++ ) {
+            int last = 2 * i + 2 < slices ? 2 * i + 2 : slices;
+            tasks[i] = ( sortTask ){ sorted, other, bounds[ 2 * i ],
+                                     bounds[ 2 * i + 1 < slices ? 2 * i + 1 : slices ],
+                                     bounds[ last ] };
+        }
+        runTasks( mergeWorker, tasks, merges );
+        for ( int i = 0; i < merges; i++ ) {
+            bounds[i] = tasks[i].start;
+        }
+        bounds[ merges ] = count;
+        sorted = other;
+    }
+    free( tasks );
+    free( bounds );
+
+    // Write header, then entries.
+    unsigned char status = FILE_OUTPUT_ERR;
+    FILE *outputStream = fopen( path, "wb" );
+    if ( outputStream != NULL ) {
+        posindex_header header;
+        memset( &header, 0, sizeof( header ) );
+        memcpy( header.magic, POSINDEX_MAGIC, sizeof( header.magic ) );
+        header.version = POSINDEX_VERSION;
+        header.count = count;
+        header.games = db->count;
+        bool written = fwrite( &header, sizeof( header ), 1, outputStream ) == 1 &&
+                       fwrite( sorted, sizeof( posindex_entry ), count, outputStream ) == count;
+        if ( fclose( outputStream ) == 0 && written ) {
+            status = SUCCESS;
+        }
+    }
+    free( entries );
+    free( buffer );
+    return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Thread entry point. Takes games a few at a time and fills their slots with the canonical key
+   after each move. A game stops at a move that is off the board or on a stone, and its
+   remaining slots are marked with NO_GAME.
+   @param arg is pointer to shared replay work.
+   @return is always NULL.
+*/
+static void* replayWorker( void* arg )
+{
+    replayWork *work = ( replayWork * )arg;
+    const gamedb *db = work->db;
+    size_t first;
+    while ( ( first = __atomic_fetch_add( &work->next, GAMES_PER_TASK, __ATOMIC_RELAXED ) ) <
+            db->count ) {
+        size_t last = first + GAMES_PER_TASK < db->count ? first + GAMES_PER_TASK : db->count;
+        for ( size_t id = first; id < last; id++ ) {
+            const gamedb_entry *stored = &db->entries[ id ];
+            posindex_entry *slots = work->entries + work->starts[ id ];
+            size_t plies = work->starts[ id + 1 ] - work->starts[ id ];
+            size_t ply = 0;
+            if ( stored->size == BOARD_SIZE_15 || stored->size == BOARD_SIZE_17 ||
+                 stored->size == BOARD_SIZE_19 ) {
+                position p;
+                position_init( &p, stored->size, stored->type );
+                for ( ; ply < plies; ply++ ) {
+                    unsigned short index = gamedb_move( db, id, ply );
+                    if ( index >= stored->size * stored->size ) {
+                        break;
+                    }
+                    unsigned short move = POSITION_INDEX( index % stored->size,
+                                                          index / stored->size );
+                    if ( p.cells[ move ] != EMPTY_INTERSECTION ) {
+                        break;
+                    }
+                    position_play( &p, move );
+                    slots[ ply ] = ( posindex_entry ){ position_key( &p, NULL ), id, ply + 1, 0 };
+                }
+            }
+            for ( ; ply < plies; ply++ ) {
+                slots[ ply ].game = NO_GAME;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+   Thread entry point. Sorts the entries of one slice.
+   @param arg is pointer to sort task.
+   @return is always NULL.
+*/
+static void* sortWorker( void* arg )
+{
+    sortTask *task = ( sortTask * )arg;
+    qsort( task->from + task->start, task->end - task->start, sizeof( posindex_entry ),
+           compareEntries );
+    return NULL;
+}
+
+/**
+   Thread entry point. Merges two neighbouring sorted runs into the other array.
+   @param arg is pointer to merge task.
+   @return is always NULL.
+*/
+static void* mergeWorker( void* arg )
+{
+    sortTask *task = ( sortTask * )arg;
+    size_t left = task->start;
+    size_t right = task->middle;
+    size_t out = task->start;
+    while ( left < task->middle && right < task->end ) {
+        if ( compareEntries( &task->from[ right ], &task->from[ left ] ) < 0 ) {
+            task->to[ out++ ] = task->from[ right++ ];
+        }
+        else {
+            task->to[ out++ ] = task->from[ left++ ];
+        }
+    }
+    memcpy( task->to + out, task->from + left, ( task->middle - left ) * sizeof( posindex_entry ) );
+    out += task->middle - left;
+    memcpy( task->to + out, task->from + right, ( task->end - right ) * sizeof( posindex_entry ) );
+    return NULL;
+}
+
+/**
+   Runs tasks at the same time, one per thread, and waits for all of them.
+   @param worker is thread entry point given each task.
+   @param tasks is array of tasks.
+   @param count is number of tasks.
+*/
+static void runTasks( void* ( *worker )( void* ), sortTask* tasks, int count )
+{
+    pthread_t *workers = ( pthread_t * )malloc( count * sizeof( pthread_t ) );
+    for ( int i = 1; i < count; i++ ) {
+        pthread_create( &workers[i], NULL, worker, &tasks[i] );
+    }
+    worker( &tasks[0] );
+    for ( int i = 1; i < count; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+    free( workers );
+}
+
+/**
+   Orders entries by key, then game, then ply.
+   @param a is pointer to first entry.
+   @param b is pointer to second entry.
+   @return is negative, zero or positive like strcmp.
+*/
+static int compareEntries( const void* a, const void* b )
+{
+    const posindex_entry *first = ( const posindex_entry * )a;
+    const posindex_entry *second = ( const posindex_entry * )b;
+    if ( first->key != second->key ) {
+        return first->key < second->key ? -1 : 1;
+    }
+    if ( first->game != second->game ) {
+        return first->game < second->game ? -1 : 1;
+    }
+    return ( int )first->ply - ( int )second->ply;
+}
@@ -0,0 +1,105 @@
+/**
+   @file posindex.h
+   @author Michael Warstler (mwwarstl)
+   Header file for position indexes over a game database. A position index file is a small
+   header followed by one entry for every position reached in every game of the database, sorted
+   by canonical Zobrist key. Positions that are rotations or reflections of each other share a
+   key, so one binary search finds every game that reached a position in any orientation. Index
+   files are opened with mmap like books, and are built on all cores.
+   Numbers are stored in the byte order of the machine that built the index.
+*/
+
+#ifndef _POSINDEX_H_
+#define _POSINDEX_H_
+#include "gamedb.h"
+#include "position.h"
+#include <stddef.h>
+
+/** First bytes of every position index file */
+#define POSINDEX_MAGIC "GPX1"
+/** Current position index file version */
+#define POSINDEX_VERSION 1
+/** Added to the database path to make the position index file path */
+#define POSINDEX_EXTENSION ".pos"
+
+/**
+   Header at the start of a position index file.
+   magic - POSINDEX_MAGIC, without a null terminator.
+   version - POSINDEX_VERSION.
+   count - number of entries following the header.
+   games - number of database games the index was built from. Games added to the database
+           later are not in the index until it is built again.
+*/
+typedef struct {
+    char magic[4];
+    unsigned int version;
+    unsigned long long count;
+    unsigned long long games;
+} posindex_header;
+
+/**
+   One position reached in one game. Fields are described as follows:
+   key - canonical Zobrist key of the position.
+   game - number of the game in the database.
+   ply - number of moves played to reach the position, at least 1.
+   reserved - always 0.
+*/
+typedef struct {
+    unsigned long long key;
+    unsigned int game;
+    unsigned short ply;
+    unsigned short reserved;
+} posindex_entry;
+
+/**
+   An open position index. Fields are described as follows:
+   entries - mapped array of entries, sorted by key, then game, then ply.
+   count - number of entries.
+   games - number of database games the index covers.
+   mapping - start of the mapped file.
+   length - length of the mapped file in bytes.
+*/
+typedef struct {
+    const posindex_entry* entries;
+    size_t count;
+    size_t games;
+    void* mapping;
+    size_t length;
+} posindex;
+
+/**
+   Opens a position index file with mmap.
+   @param path is string for file path location.
+   @return is pointer to position index, or NULL if the file is missing or is not a valid index.
+*/
+posindex* posindex_open( const char* path );
+
+/**
+   Unmaps the position index file and frees the position index.
+   If parameter is NULL, program exits with error.
+   @param x is pointer to position index.
+*/
+void posindex_close( posindex* x );
+
+/**
+   Finds every game that reached a position, with a binary search.
+   @param x is pointer to position index.
+   @param p is pointer to position.
+   @param first stores pointer to the first matching entry. Matching entries are consecutive.
+   @return is number of matching entries.
+*/
+size_t posindex_find( const posindex* x, const position* p, const posindex_entry** first );
+
+/**
+   Builds the position index of a database and writes it to a new file. Games are replayed on
+   several threads, then the entries are sorted in parallel. Games whose moves are damaged only
+   add the positions before the damage.
+   @param db is pointer to database.
+   @param path is string for file location to save the index to.
+   @param max_plies is number of moves per game to index, 0 to index every move.
+   @param threads is number of threads to use.
+   @return is SUCCESS, or FILE_OUTPUT_ERR if the file cannot be written.
+*/
+unsigned char posindex_build( const gamedb* db, const char* path, int max_plies, int threads );
+
+#endif
@@ -0,0 +1,339 @@
+/**
+   @file position.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for the lightweight position used by the computer players. Handles
+   making/unmaking moves, judging moves with a light win check, and generating candidate moves.
+*/
+
+#include "position.h"
+#include <string.h>
+
+/** Radius of the candidate move neighbourhood around each stone */
+#define NEAR_RADIUS 2
+/** The amount of stone connections required to win */
+#define NEEDED_CONNECTIONS 5
+/** Number of open fours allowed before becoming forbidden */
+#define ALLOWED_OPEN_FOURS 1
+/** Intersections per row in the coordinates Zobrist keys are computed from */
+#define KEY_STRIDE 32
+
+const int position_steps[POSITION_DIRECTIONS] = { 1, POSITION_STRIDE, POSITION_STRIDE + 1,
+                                                  POSITION_STRIDE - 1 };
+
+/** Inverse of each symmetry, indexed by symmetry */
+static const int inverses[ POSITION_SYMMETRIES ] = { 0, 1, 2, 3, 4, 6, 5, 7 };
+
+// Prototypes for static functions that judge moves and compute Zobrist keys.
+static unsigned char judgeMove( const position* p, unsigned short index, unsigned char stone );
+static void updateKeys( position* p, unsigned short index, unsigned char stone );
+static unsigned long long mix( unsigned long long value );
+
+// Initialize an empty position.
+void position_init( position* p, unsigned char size, unsigned char type )
+{
+    p->size = size;
+    p->type = type;
+    p->stone = BLACK_STONE;
+    p->winner = EMPTY_INTERSECTION;
+    p->count = 0;
+    for ( int s = 0; s < POSITION_SYMMETRIES; s++ ) {
+        p->keys[s] = mix( ( unsigned long long )size << 8 | type );
+    }
+
+    // Everything starts as wall, then the playing area is cleared.
+    memset( p->cells, POSITION_WALL, sizeof( p->cells ) );
+    memset( p->near, 0, sizeof( p->near ) );
+    for ( int y = 0; y < size; y++ ) {
+        memset( &p->cells[ POSITION_INDEX( 0, y ) ], EMPTY_INTERSECTION, size );
+    }
+}
+
+// Copy the moves of a game into a position.
+void position_from_game( position* p, const game* g )
+{
+    position_init( p, g->board->size, g->type );
+    for ( size_t i = 0; i < g->moves_count; i++ ) {
+        position_play( p, POSITION_INDEX( g->moves[i].x, g->moves[i].y ) );
+    }
+}
+
+// Place the next stone and judge the move.
+void position_play( position* p, unsigned short index )
+{
+    unsigned char stone = p->stone;
+    p->cells[ index ] = stone;
+    p->history[ p->count++ ] = index;
+
+    // Every intersection within the radius gains a neighbouring stone.
+    for ( int dy = -NEAR_RADIUS; dy <= NEAR_RADIUS; dy++ ) {
+        unsigned char *row = &p->near[ index + dy * POSITION_STRIDE ];
+        for ( int dx = -NEAR_RADIUS; dx <= NEAR_RADIUS; dx++ ) {
+            row[ dx ]++;
+        }
+    }
+
+    updateKeys( p, index, stone );
+    p->winner = judgeMove( p, index, stone );
+    p->stone = POSITION_OPPONENT( stone );
+}
+
+// Take back the most recent move.
+void position_undo( position* p )
+{
+    unsigned short index = p->history[ --p->count ];
+    p->stone = p->cells[ index ];
+    p->cells[ index ] = EMPTY_INTERSECTION;
+    p->winner = EMPTY_INTERSECTION;
+    updateKeys( p, index, p->stone );
+
+    for ( int dy = -NEAR_RADIUS; dy <= NEAR_RADIUS; dy++ ) {
+        unsigned char *row = &p->near[ index + dy * POSITION_STRIDE ];
+        for ( int dx = -NEAR_RADIUS; dx <= NEAR_RADIUS; dx++ ) {
+            row[ dx ]--;
+        }
+    }
+}
+
+// Return true if no empty intersections remain.
+bool position_is_full( const position* p )
+{
+    return p->count >= p->size * p->size;
+}
+
+// Measure a run of stones through index in one direction.
+int position_run( const position* p, unsigned short index, int direction, unsigned char stone,
+                  int* open_ends )
+{
+    int step = position_steps[ direction ];
+    int length = 1;
+
+    // Walk forwards then backwards until a different intersection is reached.
+    int i = index + step;
+    while ( p->cells[ i ] == stone ) {
+        length++;
+        i += step;
+    }
+    int ends = p->cells[ i ] == EMPTY_INTERSECTION;
+
+    i = index - step;
+    while ( p->cells[ i ] == stone ) {
+        length++;
+        i -= step;
+    }
+    ends += p->cells[ i ] == EMPTY_INTERSECTION;
+
+    if ( open_ends != NULL ) {
+        *open_ends = ends;
+    }
+    return length;
+}
+
+// Return true if stone at index would complete five in a row.
+bool position_makes_five( const position* p, unsigned short index, unsigned char stone )
+{
+    bool exact = p->type == GAME_RENJU && stone == BLACK_STONE;
+    bool five = false;
+    for ( int d = 0; d < POSITION_DIRECTIONS; d++ ) {
+        int length = position_run( p, index, d, stone, NULL );
+        if ( length > NEEDED_CONNECTIONS && exact ) {
+            return false;   // Overline is forbidden for black, even alongside a five.
+        }
+        five |= length >= NEEDED_CONNECTIONS;
+    }
+    return five;
+}
+
+// Find a winning intersection for stone on the lines through index.
+unsigned short position_five_near( const position* p, unsigned short index, unsigned char stone )
+{
+    bool exact = p->type == GAME_RENJU && stone == BLACK_STONE;
+    for ( int d = 0; d < POSITION_DIRECTIONS; d++ ) {
+        int step = position_steps[ d ];
+
+        // A five along this line needs four stones within reach of index. Count them first, as
+        // most lines are nowhere near a five.
+        int stones = p->cells[ index ] == stone;
+        for ( int sign = -1; sign <= 1; sign += 2 ) {
+            int i = index;
+            for ( int distance = 1; distance < NEEDED_CONNECTIONS; distance++ ) {
+                i += sign * step;
+                if ( p->cells[ i ] != stone && p->cells[ i ] != EMPTY_INTERSECTION ) {
+                    break;
+                }
+                stones += p->cells[ i ] == stone;
+            }
+        }
+        if ( stones < NEEDED_CONNECTIONS - 1 ) {
+            continue;
+        }
+
+        // Check both ways, stopping at walls and at the other player's stones.
+        for ( int sign = -1; sign <= 1; sign += 2 ) {
+            int i = index;
+            for ( int distance = 1; distance < NEEDED_CONNECTIONS; distance++ ) {
+                i += sign * step;
+                if ( p->cells[ i ] == EMPTY_INTERSECTION ) {
+                    int length = position_run( p, i, d, stone, NULL );
+                    if ( length == NEEDED_CONNECTIONS || ( length > NEEDED_CONNECTIONS && !exact ) ) {
+                        return i;
+                    }
+                }
+                else if ( p->cells[ i ] != stone ) {
+                    break;
+                }
+            }
+        }
+    }
+    return POSITION_NO_MOVE;
+}
+
+// Return a winning move or a forced block, if any.
+unsigned short position_urgent( const position* p )
+{
+    unsigned short moves[ POSITION_MAX_MOVES ];
+    int count = position_candidates( p, moves );
+    unsigned char opponent = POSITION_OPPONENT( p->stone );
+
+    // Winning is always preferred over blocking.
+    unsigned short block = POSITION_NO_MOVE;
+    for ( int i = 0; i < count; i++ ) {
+        if ( position_makes_five( p, moves[i], p->stone ) ) {
+            return moves[i];
+        }
+        if ( block == POSITION_NO_MOVE && position_makes_five( p, moves[i], opponent ) ) {
+            block = moves[i];
+        }
+    }
+    return block;
+}
+
+// Collect empty intersections close to existing stones.
+int position_candidates( const position* p, unsigned short* moves )
+{
+    int count = 0;
+    for ( int y = 0; y < p->size; y++ ) {
+        for ( int i = POSITION_INDEX( 0, y ); i < POSITION_INDEX( p->size, y ); i++ ) {
+            if ( p->cells[ i ] == EMPTY_INTERSECTION && p->near[ i ] > 0 ) {
+                moves[ count++ ] = i;
+            }
+        }
+    }
+
+    // First move of the game goes in the center.
+    if ( p->count == 0 ) {
+        moves[ count++ ] = POSITION_INDEX( p->size / 2, p->size / 2 );
+    }
+    return count;
+}
+
+
+// Return the smallest key over all symmetries.
+unsigned long long position_key( const position* p, int* symmetry )
+{
+    int best = 0;
+    for ( int s = 1; s < POSITION_SYMMETRIES; s++ ) {
+        if ( p->keys[s] < p->keys[ best ] ) {
+            best = s;
+        }
+    }
+    if ( symmetry != NULL ) {
+        *symmetry = best;
+    }
+    return p->keys[ best ];
+}
+
+// Map coordinates through a symmetry.
+void position_transform( unsigned char size, int symmetry, unsigned char* x, unsigned char* y )
+{
+    unsigned char last = size - 1;
+    unsigned char a = *x;
+    unsigned char b = *y;
+
+    // Symmetries 4-7 swap the axes, then bit 0 mirrors x and bit 1 mirrors y.
+    if ( symmetry & 4 ) {
+        unsigned char swap = a;
+        a = b;
+        b = swap;
+    }
+    *x = symmetry & 1 ? last - a : a;
+    *y = symmetry & 2 ? last - b : b;
+}
+
+// Return the symmetry that undoes another.
+int position_inverse( int symmetry )
+{
+    return inverses[ symmetry ];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Judges a stone that was just placed. Any run of five or more wins. In Renju, black loses by
+   making an overline, or by making more than one open four without winning, which mirrors the
+   rules enforced by game_place_stone().
+   @param p is pointer to position.
+   @param index is intersection index of the stone just placed.
+   @param stone is color of the stone just placed.
+   @return is winner of the position, or EMPTY_INTERSECTION if game continues.
+*/
+static unsigned char judgeMove( const position* p, unsigned short index, unsigned char stone )
+{
+    bool five = false;
+    bool overline = false;
+    int openFours = 0;
+
+    for ( int d = 0; d < POSITION_DIRECTIONS; d++ ) {
+        int ends;
+        int length = position_run( p, index, d, stone, &ends );
+        if ( length >= NEEDED_CONNECTIONS ) {
+            five = true;
+            overline |= length > NEEDED_CONNECTIONS;
+        }
+        else if ( length == NEEDED_CONNECTIONS - 1 && ends == 2 ) {
+            openFours++;
+        }
+    }
+
+    // Renju forbidden moves only apply to black.
+    if ( p->type == GAME_RENJU && stone == BLACK_STONE ) {
+        if ( five ) {
+            return overline ? WHITE_STONE : BLACK_STONE;
+        }
+        return openFours > ALLOWED_OPEN_FOURS ? WHITE_STONE : EMPTY_INTERSECTION;
+    }
+    return five ? stone : EMPTY_INTERSECTION;
+}
+
+/**
+   Adds or removes (the same operation for Zobrist keys) a stone in the key of every symmetry.
+   @param p is pointer to position.
+   @param index is intersection index of the stone.
+   @param stone is color of the stone.
+*/
+static void updateKeys( position* p, unsigned short index, unsigned char stone )
+{
+    for ( int s = 0; s < POSITION_SYMMETRIES; s++ ) {
+        unsigned char x = POSITION_X( index );
+        unsigned char y = POSITION_Y( index );
+        position_transform( p->size, s, &x, &y );
+        p->keys[s] ^= mix( ( unsigned long long )stone << 16 | y * KEY_STRIDE | x );
+    }
+}
+
+/**
+   Turns a small number into a well mixed 64 bit Zobrist value (the splitmix64 finalizer). The
+   values never change between runs, so keys can be stored in files.
+   @param value is number to mix.
+   @return is mixed value.
+*/
+static unsigned long long mix( unsigned long long value )
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = ( value ^ ( value >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    value = ( value ^ ( value >> 27 ) ) * 0x94D049BB133111EBULL;
+    return value ^ ( value >> 31 );
+}
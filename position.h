@@ -0,0 +1,188 @@
+/**
+   @file position.h
+   @author Michael Warstler (mwwarstl)
+   Header file defines a lightweight position used by the computer players. Unlike the game
+   struct, a position never allocates memory, so it can be copied, played forward and undone
+   millions of times per second during a search. Includes functions for converting a game into a
+   position, making/unmaking moves, a light five-in-a-row check, and the candidate move
+   neighbourhood (empty intersections close to existing stones).
+*/
+
+#ifndef _POSITION_H_
+#define _POSITION_H_
+#include "board.h"
+#include "game.h"
+#include <stdbool.h>
+
+/** Marks intersections outside of the playing area */
+#define POSITION_WALL 3
+/** Largest board a position can hold */
+#define POSITION_MAX_SIZE BOARD_SIZE_19
+/** Number of wall intersections surrounding the playing area on each side */
+#define POSITION_PADDING 2
+/** Width of one row of the padded cells array */
+#define POSITION_STRIDE ( POSITION_MAX_SIZE + 2 * POSITION_PADDING )
+/** Total number of intersections in the padded cells array */
+#define POSITION_AREA ( POSITION_STRIDE * POSITION_STRIDE )
+/** Largest number of moves a position can hold */
+#define POSITION_MAX_MOVES ( POSITION_MAX_SIZE * POSITION_MAX_SIZE )
+/** Index used when no move is available. Always a wall intersection. */
+#define POSITION_NO_MOVE 0
+/** Number of line directions (horizontal, vertical and both diagonals) */
+#define POSITION_DIRECTIONS 4
+/** Converts board coordinates to an index into position.cells */
+#define POSITION_INDEX( x, y ) ( ( (y) + POSITION_PADDING ) * POSITION_STRIDE + (x) + POSITION_PADDING )
+/** Converts an index into position.cells back to a horizontal coordinate */
+#define POSITION_X( i ) ( (i) % POSITION_STRIDE - POSITION_PADDING )
+/** Converts an index into position.cells back to a vertical coordinate */
+#define POSITION_Y( i ) ( (i) / POSITION_STRIDE - POSITION_PADDING )
+/** Number of board symmetries (rotations and reflections) */
+#define POSITION_SYMMETRIES 8
+/** Returns the stone of the other player */
+#define POSITION_OPPONENT( stone ) ( (stone) == BLACK_STONE ? WHITE_STONE : BLACK_STONE )
+
+/** Index steps for the four line directions (horizontal, vertical, diagonal down, diagonal up) */
+extern const int position_steps[POSITION_DIRECTIONS];
+
+/**
+   Fields are described as follows:
+   size - size of the playing area (15/17/19).
+   type - game type (GAME_FREESTYLE or GAME_RENJU), decides how moves are judged.
+   stone - which player will be placing NEXT stone.
+   winner - EMPTY_INTERSECTION while undecided, otherwise the player that won the position.
+   count - number of moves made so far.
+   history - indices of moves made so far, used for undo.
+   cells - padded intersection states. The playing area is surrounded by POSITION_WALL cells so
+           line scans never need bounds checks.
+   near - for every intersection, the number of stones within two intersections of it. Empty
+          intersections with a non zero count are the candidate moves.
+   keys - Zobrist keys of the position seen through each of the 8 board symmetries. The smallest
+          one is the canonical key, shared by all positions that are rotations or reflections of
+          each other.
+*/
+typedef struct {
+    unsigned char size;
+    unsigned char type;
+    unsigned char stone;
+    unsigned char winner;
+    unsigned short count;
+    unsigned short history[POSITION_MAX_MOVES];
+    unsigned char cells[POSITION_AREA];
+    unsigned char near[POSITION_AREA];
+    unsigned long long keys[POSITION_SYMMETRIES];
+} position;
+
+/**
+   Initializes an empty position of the given board size and game type. Black moves first.
+   @param p is pointer to position to initialize.
+   @param size is size of the board.
+   @param type is type of game being played.
+*/
+void position_init( position* p, unsigned char size, unsigned char type );
+
+/**
+   Initializes a position holding every move made so far in a game.
+   @param p is pointer to position to initialize.
+   @param g is pointer to game to copy moves from.
+*/
+void position_from_game( position* p, const game* g );
+
+/**
+   Places the stone of the player to move at the given index, updates the candidate
+   neighbourhood and judges the move with a light win check (Renju overline and double open
+   fours included for black). The winner field is updated if the move ends the game.
+   @param p is pointer to position.
+   @param index is an empty intersection index.
+*/
+void position_play( position* p, unsigned short index );
+
+/**
+   Takes back the most recent move made with position_play().
+   @param p is pointer to position.
+*/
+void position_undo( position* p );
+
+/**
+   Returns true when every intersection of the playing area is occupied.
+   @param p is pointer to position.
+   @return is true if position is full, otherwise false.
+*/
+bool position_is_full( const position* p );
+
+/**
+   Measures the run of stones through an intersection in one direction, as if stone was placed
+   at index. Also reports how many ends of the run are empty intersections.
+   @param p is pointer to position.
+   @param index is intersection index the run passes through.
+   @param direction is 0-3, an index into position_steps.
+   @param stone is color of the run.
+   @param open_ends stores 0, 1 or 2 empty ends. May be NULL.
+   @return is length of the run including index.
+*/
+int position_run( const position* p, unsigned short index, int direction, unsigned char stone,
+                  int* open_ends );
+
+/**
+   Determines if placing stone at an empty index completes five in a row. For black in Renju
+   the five must be exact.
+   @param p is pointer to position.
+   @param index is an empty intersection index.
+   @param stone is color to check for.
+   @return is true if the move would win, otherwise false.
+*/
+bool position_makes_five( const position* p, unsigned short index, unsigned char stone );
+
+/**
+   Looks along the four lines through index for an empty intersection where stone would complete
+   five in a row. Only intersections within four of index are considered, which is enough to find
+   every five created or threatened by the stone at index.
+   @param p is pointer to position.
+   @param index is intersection index to search around.
+   @param stone is color to check for.
+   @return is winning intersection index, or POSITION_NO_MOVE if there is none.
+*/
+unsigned short position_five_near( const position* p, unsigned short index, unsigned char stone );
+
+/**
+   Returns a move that must be played immediately: a winning move for the player to move, or
+   otherwise the block of an opponent five.
+   @param p is pointer to position.
+   @return is urgent intersection index, or POSITION_NO_MOVE if there is none.
+*/
+unsigned short position_urgent( const position* p );
+
+/**
+   Stores all candidate moves (empty intersections within two of a stone) in moves. On an empty
+   board the only candidate is the center.
+   @param p is pointer to position.
+   @param moves is buffer of at least POSITION_MAX_MOVES indices.
+   @return is number of candidate moves stored.
+*/
+int position_candidates( const position* p, unsigned short* moves );
+
+/**
+   Returns the canonical Zobrist key of the position: the smallest key over all 8 board
+   symmetries. Keys also depend on board size and game type.
+   @param p is pointer to position.
+   @param symmetry stores which symmetry gave the canonical key. May be NULL.
+   @return is canonical key.
+*/
+unsigned long long position_key( const position* p, int* symmetry );
+
+/**
+   Maps board coordinates through one of the 8 board symmetries.
+   @param size is size of the board.
+   @param symmetry is 0-7. Symmetry 0 leaves coordinates unchanged.
+   @param x is pointer to x/horizontal coordinate, updated in place.
+   @param y is pointer to y/vertical coordinate, updated in place.
+*/
+void position_transform( unsigned char size, int symmetry, unsigned char* x, unsigned char* y );
+
+/**
+   Returns the symmetry that undoes the given one.
+   @param symmetry is 0-7.
+   @return is inverse symmetry.
+*/
+int position_inverse( int symmetry );
+
+#endif
@@ -7,32 +7,67 @@
 #include "error-codes.h"
 #include "game.h"
 #include "io.h"
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-/** How many command line arguments allowed */
-#define ALLOWED_ARGUMENTS 2
+/** How many command line arguments allowed at minimum */
+#define MIN_ARGUMENTS 2
 
 /**
-   Determines if correct number of command line arguments are entered. If so, begins the game
-   replay function.
+   Reads the command line options, then replays the game. Allowed key arguments are "-s" followed
+   by a speed multiplier (2 replays twice as fast), "-n" for no pause between moves, "-i" to step
+   through the game by commands instead, and "-m" followed by the number of the first move to
+   show. The last argument is the saved game.
    @param argc are # of command line arguments.
    @param **argv is array of character pointers listing all arguments.
    @return is exit status
 */
 int main(int argc, char **argv)
 {
-    // Accepts only 1 extra command line argument (path location)
-    if ( argc != ALLOWED_ARGUMENTS ) {
-        printf( "usage: ./replay <saved-match.gmk>\n" );
-        exit( ARGUMENT_ERR );
+    double speed = 1;
+    long millis = GAME_REPLAY_MILLIS;
+    bool stepping = false;
+    long start = 1;
+    
+    // Every argument before the saved game is an option.
+    if ( argc < MIN_ARGUMENTS ) {
+        goto error;
     }
-    else {
-        // Import game from command line argument. Replay the game.
-        game *replayGame = game_import( argv[ALLOWED_ARGUMENTS - 1] );
-        game_replay( replayGame );
-        
-        // Delete game and exit.
-        game_delete( replayGame );
-        return SUCCESS;
+    for ( int i = 1; i < argc - 1; i++ ) {
+        if ( strcmp( argv[i], "-s" ) == 0 && i + 1 < argc - 1 ) {
+            speed = atof( argv[++i] );
+            if ( speed <= 0 ) {
+                goto error;
+            }
+            millis = GAME_REPLAY_MILLIS / speed;
+        }
+        else if ( strcmp( argv[i], "-n" ) == 0 ) {
+            millis = 0;
+        }
+        else if ( strcmp( argv[i], "-i" ) == 0 ) {
+            stepping = true;
+        }
+        else if ( strcmp( argv[i], "-m" ) == 0 && i + 1 < argc - 1 ) {
+            start = atol( argv[++i] );
+            if ( start < 0 ) {
+                goto error;
+            }
+        }
+        else {
+            goto error;
+        }
     }
-}
\ No newline at end of file
+    
+    // Import game from the last command line argument. Replay the game.
+    game *replayGame = game_import( argv[ argc - 1 ] );
+    game_replay_from( replayGame, start, millis, stepping );
+    
+    // Delete game and exit.
+    game_delete( replayGame );
+    return SUCCESS;
+    
+    error:
+    printf( "usage: ./replay [-s <speed>] [-n] [-i] [-m <move>] <saved-match.gmk>\n" );
+    exit( ARGUMENT_ERR );
+}
@@ -0,0 +1,230 @@
+/**
+   @file search.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for the alpha-beta engine. Iterative deepening runs negamax searches of
+   increasing depth; the best move of each iteration is searched first in the next one, and
+   killer/history tables carry over between iterations.
+*/
+
+#include "search.h"
+#include "mcts.h"
+#include "error-codes.h"
+#include <stdlib.h>
+
+/** Larger than any score */
+#define INFINITE_SCORE ( EVAL_WIN + 1 )
+/** Nodes visited between deadline checks, minus one */
+#define TIME_CHECK_MASK 1023
+
+// Prototypes for the static iterative deepening loop and recursive search.
+static unsigned short deepen( searcher* s, int first_depth, int max_depth );
+static int negamax( searcher* s, int depth, int ply, int alpha, int beta );
+
+// Create a searcher.
+searcher* search_create( unsigned char scheme )
+{
+    searcher *s = ( searcher * )malloc( sizeof( searcher ) );
+    order_init( &s->order, scheme );
+    s->nodes = 0;
+    s->deadline = 0;
+    s->stop = false;
+    s->best = POSITION_NO_MOVE;
+    s->score = 0;
+    s->depth = 0;
+    return s;
+}
+
+// Free a searcher.
+void search_delete( searcher* s )
+{
+    if ( s == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    free( s );
+}
+
+// Iterative deepening search of a position.
+unsigned short search_run( searcher* s, const position* p, int max_depth, long max_millis )
+{
+    __atomic_store_n( &s->stop, false, __ATOMIC_SEQ_CST );
+    return search_deepen( s, p, max_depth, max_millis );
+}
+
+// Iterative deepening search that honours an earlier stop request.
+unsigned short search_deepen( searcher* s, const position* p, int max_depth, long max_millis )
+{
+    s->pos = *p;
+    eval_init( &s->eval, &s->pos );
+    order_new_search( &s->order );
+    s->nodes = 0;
+    s->deadline = max_millis > 0 ? mcts_now() + max_millis : 0;
+    s->best = POSITION_NO_MOVE;
+    s->score = 0;
+    s->depth = 0;
+    if ( p->winner != EMPTY_INTERSECTION || position_is_full( p ) ) {
+        return POSITION_NO_MOVE;
+    }
+    return deepen( s, 1, max_depth );
+}
+
+// Carry on the last search of the same position from its next iteration.
+unsigned short search_continue( searcher* s, int max_depth, long max_millis )
+{
+    __atomic_store_n( &s->stop, false, __ATOMIC_SEQ_CST );
+    s->nodes = 0;
+    s->deadline = max_millis > 0 ? mcts_now() + max_millis : 0;
+    if ( s->depth == 0 ) {
+        return search_deepen( s, &s->pos, max_depth, max_millis );
+    }
+    if ( s->depth >= max_depth || s->score >= SEARCH_WIN_THRESHOLD ||
+         s->score <= -SEARCH_WIN_THRESHOLD ) {
+        return s->best;
+    }
+    return deepen( s, s->depth + 1, max_depth );
+}
+
+// Ask a running search to stop.
+void search_stop( searcher* s )
+{
+    __atomic_store_n( &s->stop, true, __ATOMIC_SEQ_CST );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Iterative deepening loop over the searcher's position. The best move found so far, if any, is
+   searched first.
+   @param s is pointer to searcher, with pos, eval and the result fields set up.
+   @param first_depth is first iteration to run.
+   @param max_depth is deepest iteration to complete.
+   @return is best move index, or POSITION_NO_MOVE if there is none.
+*/
+static unsigned short deepen( searcher* s, int first_depth, int max_depth )
+{
+    unsigned short moves[ POSITION_MAX_MOVES ];
+    int count = position_candidates( &s->pos, moves );
+    order_moves( &s->order, &s->pos, 0, moves, count );
+    if ( max_depth > SEARCH_MAX_DEPTH ) {
+        max_depth = SEARCH_MAX_DEPTH;
+    }
+    for ( int i = 1; i < count && s->best != POSITION_NO_MOVE; i++ ) {
+        if ( moves[i] == s->best ) {
+            moves[i] = moves[0];
+            moves[0] = s->best;
+            break;
+        }
+    }
+
+    for ( int depth = first_depth; depth <= max_depth; depth++ ) {
+        int alpha = -INFINITE_SCORE;
+        unsigned short best = POSITION_NO_MOVE;
+        for ( int i = 0; i < count; i++ ) {
+            eval_play( &s->eval, &s->pos, moves[i] );
+            int score = -negamax( s, depth - 1, 1, -INFINITE_SCORE, -alpha );
+            eval_undo( &s->eval, &s->pos );
+            if ( __atomic_load_n( &s->stop, __ATOMIC_RELAXED ) ) {
+                break;
+            }
+            if ( score > alpha ) {
+                alpha = score;
+                best = moves[i];
+            }
+        }
+
+        // An unfinished iteration is only used if there is nothing better.
+        if ( s->stop && s->best != POSITION_NO_MOVE ) {
+            break;
+        }
+        if ( best != POSITION_NO_MOVE ) {
+            s->best = best;
+            s->score = alpha;
+            s->depth = depth;
+        }
+        if ( s->stop || alpha >= SEARCH_WIN_THRESHOLD || alpha <= -SEARCH_WIN_THRESHOLD ) {
+            break;
+        }
+
+        // Search the best move first in the next iteration.
+        for ( int i = 0; i < count; i++ ) {
+            if ( moves[i] == best ) {
+                moves[i] = moves[0];
+                moves[0] = best;
+                break;
+            }
+        }
+    }
+
+    // Time ran out before any move was searched: fall back on the best ordered move.
+    if ( s->best == POSITION_NO_MOVE && count > 0 ) {
+        s->best = moves[0];
+    }
+    return s->best;
+}
+
+/**
+   Negamax alpha-beta search of the searcher's position.
+   @param s is pointer to searcher.
+   @param depth is remaining depth. Leaves are scored at depth 0.
+   @param ply is distance from the root.
+   @param alpha is lower bound of interesting scores.
+   @param beta is upper bound of interesting scores.
+   @return is score for the player to move. Wins score higher the sooner they happen.
+*/
+static int negamax( searcher* s, int depth, int ply, int alpha, int beta )
+{
+    position *p = &s->pos;
+    if ( ( ++s->nodes & TIME_CHECK_MASK ) == 0 && s->deadline > 0 && mcts_now() >= s->deadline ) {
+        search_stop( s );
+    }
+    if ( __atomic_load_n( &s->stop, __ATOMIC_RELAXED ) ) {
+        return 0;
+    }
+
+    // Game over: the player who just moved decided it.
+    if ( p->winner != EMPTY_INTERSECTION ) {
+        return p->winner == p->stone ? EVAL_WIN - ply : -( EVAL_WIN - ply );
+    }
+    if ( position_is_full( p ) ) {
+        return 0;
+    }
+    if ( depth <= 0 ) {
+        int score = eval_score( &s->eval, p );
+        if ( score >= SEARCH_WIN_THRESHOLD ) {
+            return score - ply;
+        }
+        return score <= -SEARCH_WIN_THRESHOLD ? score + ply : score;
+    }
+
+    unsigned short moves[ POSITION_MAX_MOVES ];
+    int count = position_candidates( p, moves );
+    order_moves( &s->order, p, ply, moves, count );
+
+    // Threats sort first, so the moves cut off are the quiet ones least likely to matter.
+    if ( count > SEARCH_MAX_BRANCHING ) {
+        count = SEARCH_MAX_BRANCHING;
+    }
+    int best = -INFINITE_SCORE;
+    for ( int i = 0; i < count; i++ ) {
+        eval_play( &s->eval, p, moves[i] );
+        int score = -negamax( s, depth - 1, ply + 1, -beta, -alpha );
+        eval_undo( &s->eval, p );
+        if ( __atomic_load_n( &s->stop, __ATOMIC_RELAXED ) ) {
+            return 0;
+        }
+        if ( score > best ) {
+            best = score;
+            if ( score > alpha ) {
+                alpha = score;
+                if ( alpha >= beta ) {
+                    order_cutoff( &s->order, p, ply, moves[i], depth );
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
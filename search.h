@@ -0,0 +1,101 @@
+/**
+   @file search.h
+   @author Michael Warstler (mwwarstl)
+   Header file for the alpha-beta engine. Searches positions with iterative deepening negamax,
+   scoring leaves with the incremental evaluator and ordering moves with a pluggable move
+   orderer.
+*/
+
+#ifndef _SEARCH_H_
+#define _SEARCH_H_
+#include "position.h"
+#include "eval.h"
+#include "order.h"
+#include <stdbool.h>
+
+/** Deepest iteration the search will start */
+#define SEARCH_MAX_DEPTH 32
+/** Scores beyond this are forced wins (or losses) */
+#define SEARCH_WIN_THRESHOLD ( EVAL_WIN - POSITION_MAX_MOVES - 1 )
+/** Most moves searched at any node below the root, taken from the front after ordering */
+#define SEARCH_MAX_BRANCHING 24
+
+/**
+   Fields are described as follows:
+   pos - position being searched. Moves are made and unmade in place.
+   eval - pattern counts of pos.
+   order - move orderer with killer and history tables.
+   nodes - number of positions visited by the current search.
+   deadline - monotonic time in milliseconds the search must end by, 0 if unlimited.
+   stop - set when the search runs out of time, or to end the search from another thread.
+   best - best root move of the deepest completed iteration.
+   score - score of best for the player to move at the root.
+   depth - deepest completed iteration.
+*/
+typedef struct {
+    position pos;
+    evaluator eval;
+    move_orderer order;
+    long nodes;
+    long long deadline;
+    bool stop;
+    unsigned short best;
+    int score;
+    int depth;
+} searcher;
+
+/**
+   Creates a new dynamically allocated searcher using an ordering scheme.
+   @param scheme is move ordering scheme. (ORDER_NONE, ORDER_THREATS or ORDER_FULL)
+   @return is pointer to searcher.
+*/
+searcher* search_create( unsigned char scheme );
+
+/**
+   Frees memory of a searcher.
+   If parameter is NULL, program exits with error.
+   @param s is pointer to searcher.
+*/
+void search_delete( searcher* s );
+
+/**
+   Searches position p with iterative deepening until max_depth is completed or max_millis
+   milliseconds have passed. Results are left in the best, score and depth fields.
+   @param s is pointer to searcher.
+   @param p is position to search, which must have a player to move.
+   @param max_depth is deepest iteration to complete, at most SEARCH_MAX_DEPTH.
+   @param max_millis is time limit in milliseconds, 0 if unlimited.
+   @return is best move index, or POSITION_NO_MOVE if there is none.
+*/
+unsigned short search_run( searcher* s, const position* p, int max_depth, long max_millis );
+
+/**
+   Same as search_run(), except a stop requested before the call is not cleared, so the search
+   ends right away. Used for background searches that another thread may cancel at any time.
+   @param s is pointer to searcher.
+   @param p is position to search, which must have a player to move.
+   @param max_depth is deepest iteration to complete, at most SEARCH_MAX_DEPTH.
+   @param max_millis is time limit in milliseconds, 0 if unlimited.
+   @return is best move index, or POSITION_NO_MOVE if there is none.
+*/
+unsigned short search_deepen( searcher* s, const position* p, int max_depth, long max_millis );
+
+/**
+   Carries on the last search, which must have ended (finished or stopped), from the iteration
+   after the deepest one it completed, keeping its best move and tables. Nothing is searched
+   if that search already reached max_depth or found a forced result. Used to pick up a
+   background search of the position that came up.
+   @param s is pointer to searcher.
+   @param max_depth is deepest iteration to complete, at most SEARCH_MAX_DEPTH.
+   @param max_millis is time limit in milliseconds for the new iterations, 0 if unlimited.
+   @return is best move index, or POSITION_NO_MOVE if there is none.
+*/
+unsigned short search_continue( searcher* s, int max_depth, long max_millis );
+
+/**
+   Asks a running search to stop as soon as possible. Safe to call from another thread.
+   @param s is pointer to searcher.
+*/
+void search_stop( searcher* s );
+
+#endif
@@ -0,0 +1,184 @@
+/**
+   @file selfplay.c
+   @author Michael Warstler (mwwarstl)
+   Implementation file for engine-versus-engine games.
+*/
+
+#include "selfplay.h"
+#include "board.h"
+#include "order.h"
+#include "error-codes.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Longest line of an opening suite */
+#define MAX_LINE_LENGTH 1024
+/** Initial number of openings allocated */
+#define INITIAL_NUM_OPENINGS 64
+
+// Read a player description.
+bool selfplay_parse_player( const char* text, player_spec* spec )
+{
+    spec->millis = 0;
+    spec->playouts = 0;
+    spec->depth = SEARCH_MAX_DEPTH;
+    spec->scheme = ORDER_FULL;
+    spec->program = NULL;
+
+    long amount;
+    char unit[ MAX_LINE_LENGTH ] = "";
+    if ( sscanf( text, "mcts:%ld%s", &amount, unit ) >= 1 && amount > 0 ) {
+        spec->kind = ENGINE_MCTS;
+        if ( strcmp( unit, "ms" ) == 0 ) {
+            spec->millis = amount;
+        }
+        else if ( unit[0] == '\0' ) {
+            spec->playouts = amount;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    int depth;
+    char scheme[ MAX_LINE_LENGTH ] = "";
+    int matches = sscanf( text, "ab:%d:%s", &depth, scheme );
+    if ( matches >= 1 && depth > 0 && depth <= SEARCH_MAX_DEPTH ) {
+        spec->kind = ENGINE_ALPHABETA;
+        spec->depth = depth;
+        if ( matches == 2 ) {
+            spec->scheme = order_scheme( scheme );
+        }
+        return spec->scheme != ORDER_SCHEMES;
+    }
+
+    int prefix = 0;
+    if ( sscanf( text, "ext:%ld:%n", &amount, &prefix ) == 1 && prefix > 0 && amount > 0 &&
+         text[ prefix ] != '\0' ) {
+        spec->kind = SELFPLAY_EXTERNAL;
+        spec->millis = amount;
+        spec->program = text + prefix;
+        return true;
+    }
+    return false;
+}
+
+// Create a player.
+player* selfplay_create_player( const player_spec* spec )
+{
+    player *p = ( player * )malloc( sizeof( player ) );
+    p->kind = spec->kind;
+    if ( spec->kind == SELFPLAY_EXTERNAL ) {
+        p->choose = external_move_source;
+        p->context = external_start( spec->program, spec->millis );
+        if ( p->context == NULL ) {
+            exit( FILE_INPUT_ERR );
+        }
+        return p;
+    }
+
+    // Engines get one thread and a small arena.
+    engine *e = engine_create( spec->kind, 1, spec->millis );
+    e->playouts = spec->playouts;
+    e->depth = spec->depth;
+    if ( e->search != NULL ) {
+        order_init( &e->search->order, spec->scheme );
+    }
+    engine_limit_memory( e, ENGINE_MEMORY_RESERVE + 2 * SELFPLAY_NODES * sizeof( mcts_node ) );
+    p->choose = engine_move_source;
+    p->context = e;
+    return p;
+}
+
+// Free a player.
+void selfplay_delete_player( player* p )
+{
+    if ( p == NULL ) {
+        exit( NULL_POINTER_ERR );
+    }
+    if ( p->kind == SELFPLAY_EXTERNAL ) {
+        external_stop( ( external * )p->context );
+    }
+    else {
+        engine_delete( ( engine * )p->context );
+    }
+    free( p );
+}
+
+// Read an opening suite.
+opening* selfplay_read_openings( const char* path, unsigned char size, int* count )
+{
+    FILE *inputStream = fopen( path, "r" );
+    if ( inputStream == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+
+    // Coordinates are converted with a board of the right size.
+    board *b = board_create( size );
+    int capacity = INITIAL_NUM_OPENINGS;
+    opening *openings = ( opening * )malloc( capacity * sizeof( opening ) );
+    *count = 0;
+
+    char line[ MAX_LINE_LENGTH ];
+    while ( fgets( line, sizeof( line ), inputStream ) != NULL ) {
+        // Double size of openings array if needed.
+        if ( *count >= capacity ) {
+            capacity *= 2;
+            openings = ( opening * )realloc( openings, capacity * sizeof( opening ) );
+        }
+        opening *o = &openings[ *count ];
+        o->count = 0;
+
+        // Read coordinates until the end of the line.
+        for ( char *token = strtok( line, " \t\r\n" ); token != NULL;
+              token = strtok( NULL, " \t\r\n" ) ) {
+            move *m = &o->moves[ o->count ];
+            if ( o->count >= SELFPLAY_MAX_OPENING_MOVES ||
+                 board_coord( b, token, &m->x, &m->y ) != SUCCESS ) {
+                exit( FILE_INPUT_ERR );
+            }
+            m->stone = o->count % 2 == 0 ? BLACK_STONE : WHITE_STONE;
+            o->count++;
+        }
+        if ( o->count > 0 ) {
+            ( *count )++;
+        }
+    }
+
+    board_delete( b );
+    fclose( inputStream );
+    if ( *count == 0 ) {
+        exit( FILE_INPUT_ERR );
+    }
+    return openings;
+}
+
+// Play one game between two players.
+game* selfplay_play( player* black, player* white, unsigned char size, unsigned char type,
+                     const opening* start )
+{
+    game *g = game_create( size, type );
+    g->quiet = true;
+
+    // Play the opening. An opening that is illegal here, or already ends the game, is not used.
+    for ( int i = 0; start != NULL && i < start->count; i++ ) {
+        if ( !game_place_stone( g, start->moves[i].x, start->moves[i].y ) ||
+             g->state != GAME_STATE_PLAYING ) {
+            g->state = GAME_STATE_STOPPED;
+            return g;
+        }
+    }
+
+    // Players take turns until the game ends.
+    while ( g->state == GAME_STATE_PLAYING ) {
+        player *p = g->stone == BLACK_STONE ? black : white;
+        unsigned char x;
+        unsigned char y;
+        if ( !p->choose( g, p->context, &x, &y ) || !game_place_stone( g, x, y ) ) {
+            g->state = GAME_STATE_STOPPED;
+        }
+    }
+    return g;
+}
@@ -0,0 +1,116 @@
+/**
+   @file selfplay.h
+   @author Michael Warstler (mwwarstl)
+   Header file for engine-versus-engine games. Defines how players are described on the command
+   line, opening suites that games start from, and a function that plays one game between two
+   players. A player is one of this program's engines, or an external program speaking the
+   Gomocup protocol. Used by the arena and match executables.
+*/
+
+#ifndef _SELFPLAY_H_
+#define _SELFPLAY_H_
+#include "game.h"
+#include "engine.h"
+#include "external.h"
+#include <stdbool.h>
+
+/** Player is an external program, in addition to the ENGINE_MCTS and ENGINE_ALPHABETA kinds */
+#define SELFPLAY_EXTERNAL 2
+
+/** Most moves an opening can hold */
+#define SELFPLAY_MAX_OPENING_MOVES 32
+/** Nodes in the Monte Carlo arena of a self-play engine. Searches are short, so this is small. */
+#define SELFPLAY_NODES 200000
+
+/**
+   Describes a computer player. Fields are described as follows:
+   kind - search algorithm used. (ENGINE_MCTS, ENGINE_ALPHABETA or SELFPLAY_EXTERNAL)
+   millis - thinking time per move in milliseconds, 0 if limited by playouts/depth only.
+   playouts - playouts per move for ENGINE_MCTS, 0 if limited by time only.
+   depth - deepest iteration per move for ENGINE_ALPHABETA.
+   scheme - move ordering scheme for ENGINE_ALPHABETA. (ORDER_NONE, ORDER_THREATS or ORDER_FULL)
+   program - path of the program for SELFPLAY_EXTERNAL, NULL otherwise.
+*/
+typedef struct {
+    unsigned char kind;
+    long millis;
+    long playouts;
+    int depth;
+    unsigned char scheme;
+    const char* program;
+} player_spec;
+
+/**
+   A player ready to play games. Fields are described as follows:
+   choose - picks the player's moves.
+   context - passed to choose, an engine or an external player.
+   kind - kind of player, from player_spec.
+*/
+typedef struct {
+    move_source choose;
+    void* context;
+    unsigned char kind;
+} player;
+
+/**
+   A fixed sequence of moves games start from. Fields are described as follows:
+   moves - moves in the order they are played, black first.
+   count - number of moves.
+*/
+typedef struct {
+    move moves[ SELFPLAY_MAX_OPENING_MOVES ];
+    int count;
+} opening;
+
+/**
+   Reads a player description. Accepted forms are "mcts:<playouts>", "mcts:<millis>ms",
+   "ab:<depth>", "ab:<depth>:<ordering>" where ordering is a name from order_names, and
+   "ext:<millis>:<program>" for an external program given millis per move.
+   @param text is string holding the description. External players keep a pointer into it.
+   @param spec stores the player.
+   @return is true if text is a valid description, otherwise false.
+*/
+bool selfplay_parse_player( const char* text, player_spec* spec );
+
+/**
+   Creates a player. Engines are single threaded since games run in parallel, so each engine only
+   needs one thread and a small node arena. External programs are started right away; if one
+   can't be started, program exits with error.
+   @param spec is pointer to player description.
+   @return is pointer to player, freed with selfplay_delete_player().
+*/
+player* selfplay_create_player( const player_spec* spec );
+
+/**
+   Frees a player, deleting its engine or stopping its external program.
+   If parameter is NULL, program exits with error.
+   @param p is pointer to player.
+*/
+void selfplay_delete_player( player* p );
+
+/**
+   Reads an opening suite: one opening per line, as formal coordinates separated by spaces.
+   Blank lines are skipped. If the file can't be read or holds an invalid opening, program exits
+   with error.
+   @param path is string for file path location.
+   @param size is board size the openings are for.
+   @param count stores number of openings read.
+   @return is dynamically allocated array of openings.
+*/
+opening* selfplay_read_openings( const char* path, unsigned char size, int* count );
+
+/**
+   Plays one game between two players, starting from an opening. The game is quiet, so nothing
+   is printed. If the opening is not legal for the game type, or ends the game by itself, the
+   game is returned stopped.
+   @param black is pointer to player playing black.
+   @param white is pointer to player playing white.
+   @param size is size of the board.
+   @param type is type of game being played.
+   @param start is pointer to opening to play first, NULL for an empty board.
+   @return is pointer to finished game, freed with game_delete().
+*/
+game* selfplay_play( player* black, player* white, unsigned char size, unsigned char type,
+                     const opening* start );
+
+#endif
@@ -0,0 +1,996 @@
+/**
+   @file server.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for executable that hosts many games in one process for clients
+   connected over a Unix socket or TCP. A single thread runs an epoll event loop over every
+   connection. Games and connections come from pools made at startup, so serving a request
+   allocates nothing. Clients send one command per line and get one reply line per command,
+   "ok" with the values below or "err" with a reason:
+      create <15|17|19> <freestyle|renju>   ok <game>
+      move <game> <coordinate>              ok <state> <winner> <stone>
+      resign <game>                         ok <state> <winner> <stone>
+      state <game>                          ok <size> <type> <state> <winner> <stone> <count> <moves>...
+      save <game> <file>                    ok
+      close <game>                          ok
+      watch <game>                          ok <size> <type> <state> <winner> <stone> <count> <moves>...
+      unwatch                               ok
+   Game type, state and winner are numbers as in saved games, stone is the stone to play next,
+   and moves are formal coordinates. Any client may act on any game by its number, so players
+   share a game by passing its number around. Games are saved into the save directory, a playing
+   game as stopped, and "close" returns a game to the pool.
+   A connection watching a game (one at a time) is sent a line for each change to it, between
+   its replies: "update <game> move <coordinate> <state> <winner> <stone>", "update <game> resign
+   <state> <winner> <stone>" or "update <game> closed", after which it no longer watches. Each
+   line is written once into a shared, reference counted update from a pool, and every watcher
+   queues a pointer to it that is sent straight from the shared copy. Watchers are flushed once
+   per round of events, so moves that arrive together go out to a watcher in one send.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "error-codes.h"
+#include "board.h"
+#include "game.h"
+#include "io.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/** Longest command line, including its newline */
+#define MAX_LINE_LENGTH 256
+/** Longest reply line: the state of a full 19x19 game */
+#define MAX_REPLY_LENGTH ( 64 + BOARD_SIZE_19 * BOARD_SIZE_19 * 4 )
+/** Bytes of replies a connection holds while the client is slow to read them */
+#define OUTPUT_BUFFER_SIZE 8192
+/** Default number of games in the pool */
+#define DEFAULT_GAMES 4096
+/** Default number of connections in the pool */
+#define DEFAULT_CONNECTIONS 1024
+/** Default address TCP connections are accepted on */
+#define DEFAULT_ADDRESS "127.0.0.1"
+/** Default directory games are saved in */
+#define DEFAULT_DIRECTORY "."
+/** Most events handled per wait */
+#define MAX_EVENTS 256
+/** Connections waiting to be accepted before more are refused */
+#define LISTEN_BACKLOG 128
+/** Most listening sockets: one Unix and one TCP */
+#define MAX_LISTENERS 2
+/** Event data of a listening socket is this plus its number, below it a connection's number */
+#define LISTENER_DATA ( ( uint64_t )1 << 32 )
+/** Longest command name or argument read */
+#define MAX_WORD_LENGTH 64
+/** MAX_WORD_LENGTH - 1 as a scanf field width */
+#define WORD_FORMAT "63"
+/** Longest update line sent to watchers */
+#define UPDATE_LENGTH 64
+/** Updates a watcher may have waiting before it is disconnected as too slow */
+#define WATCH_QUEUE_LENGTH 64
+/** Most pieces of output handed to one send */
+#define MAX_SEND_PARTS 64
+/** Connection number that means no connection */
+#define NO_CONNECTION SIZE_MAX
+
+/**
+   A line sent to every watcher of a game, shared by their queues. Fields are described as
+   follows:
+   references - number of queues holding the update. It returns to the pool at 0.
+   length - number of bytes in text.
+   text - the line, with its newline.
+*/
+typedef struct {
+    int references;
+    size_t length;
+    char text[ UPDATE_LENGTH ];
+} update;
+
+/**
+   A client connection. Fields are described as follows:
+   fd - socket of the connection, -1 while the connection is in the pool.
+   events - epoll events the socket is watched for.
+   discarding - true while dropping the rest of a line too long to run.
+   broken - true once the connection failed or fell too far behind as a watcher, to be closed.
+   pending - true while the connection is listed to be flushed after this round of events.
+   watching - number of the game watched, NO_CONNECTION if none.
+   watch_previous - previous connection watching the same game, NO_CONNECTION for the first.
+   watch_next - next connection watching the same game, NO_CONNECTION for the last.
+   in_length - number of bytes in in, part of a command line.
+   out_length - number of bytes in out waiting to be sent.
+   queue - updates waiting to be sent, a ring starting at queue_start.
+   queue_start - position in queue of the first update.
+   queue_count - number of updates in queue.
+   queue_sent - number of bytes of the first update already sent.
+   in - bytes read but not yet run as commands.
+   out - replies waiting to be sent.
+*/
+typedef struct {
+    int fd;
+    uint32_t events;
+    bool discarding;
+    bool broken;
+    bool pending;
+    size_t watching;
+    size_t watch_previous;
+    size_t watch_next;
+    size_t in_length;
+    size_t out_length;
+    update* queue[ WATCH_QUEUE_LENGTH ];
+    size_t queue_start;
+    size_t queue_count;
+    size_t queue_sent;
+    char in[ MAX_LINE_LENGTH ];
+    char out[ OUTPUT_BUFFER_SIZE ];
+} connection;
+
+/**
+   Everything the event loop serves. Fields are described as follows:
+   epoll - epoll instance watching every socket.
+   listeners - listening sockets.
+   listener_count - number of listening sockets.
+   directory - directory games are saved in.
+   games - pool of games, each created for a 19x19 board so it fits any game.
+   open - true for each game in use.
+   game_count - number of games in the pool.
+   free_games - numbers of the games not in use.
+   free_game_count - number of games not in use.
+   connections - pool of connections.
+   connection_count - number of connections in the pool.
+   free_connections - numbers of the connections not in use.
+   free_connection_count - number of connections not in use.
+   watchers - first connection watching each game, NO_CONNECTION if none.
+   updates - pool of updates, enough for every watcher queue to be full.
+   free_updates - updates not in use.
+   free_update_count - number of updates not in use.
+   pending - connections to flush after this round of events.
+   pending_count - number of connections in pending.
+*/
+typedef struct {
+    int epoll;
+    int listeners[ MAX_LISTENERS ];
+    int listener_count;
+    const char* directory;
+    game** games;
+    bool* open;
+    size_t game_count;
+    size_t* free_games;
+    size_t free_game_count;
+    connection* connections;
+    size_t connection_count;
+    size_t* free_connections;
+    size_t free_connection_count;
+    size_t* watchers;
+    update* updates;
+    update** free_updates;
+    size_t free_update_count;
+    size_t* pending;
+    size_t pending_count;
+} server;
+
+/** Set by a signal to end the event loop */
+static volatile sig_atomic_t stopping = 0;
+
+// Prototypes for static functions that set up the server.
+static void createPools( server* s, size_t games, size_t connections );
+static void listenOn( server* s, int fd, struct sockaddr* address, socklen_t length );
+static void stopServer( int signal );
+
+// Prototypes for static functions that serve connections.
+static void acceptClients( server* s, int listener );
+static void serveConnection( server* s, size_t number, uint32_t events );
+static void runLines( server* s, connection* c );
+static bool flushOutput( server* s, connection* c );
+static void setEvents( server* s, size_t number );
+static void closeConnection( server* s, size_t number );
+
+// Prototypes for static functions that run commands.
+static void runCommand( server* s, connection* c, char* line );
+static game* findGame( server* s, const char* word, size_t* number );
+static void reply( connection* c, const char* format, ... );
+static void replyState( connection* c, const game* g );
+static void saveGame( server* s, connection* c, game* g, const char* name );
+
+// Prototypes for static functions that serve watchers.
+static void watchGame( server* s, size_t number, size_t game );
+static void unwatchGame( server* s, size_t number );
+static void broadcast( server* s, size_t game, const char* format, ... );
+static void markPending( server* s, size_t number );
+static void flushPending( server* s );
+static void releaseUpdate( server* s, connection* c );
+
+/**
+   Reads the options, then serves clients until interrupted. Allowed key arguments are "-u"
+   followed by the path of a Unix socket to create, "-p" followed by a TCP port, "-a" followed by
+   the IPv4 address to accept TCP connections on (DEFAULT_ADDRESS otherwise), "-g" followed by
+   the number of games, "-c" followed by the number of connections, and "-d" followed by the
+   directory games are saved in. At least one of "-u" and "-p" is needed.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status
+*/
+int main(int argc, char **argv)
+{
+    const char *socketPath = NULL;
+    int port = 0;
+    const char *address = DEFAULT_ADDRESS;
+    long games = DEFAULT_GAMES;
+    long connections = DEFAULT_CONNECTIONS;
+    server s;
+    s.directory = DEFAULT_DIRECTORY;
+
+    // Every option takes a value.
+    if ( argc % 2 == 0 ) {
+        goto error;
+    }
+    for ( int i = 1; i < argc; i += 2 ) {
+        if ( strcmp( argv[i], "-u" ) == 0 ) {
+            socketPath = argv[i + 1];
+        }
+        else if ( strcmp( argv[i], "-p" ) == 0 ) {
+            port = atoi( argv[i + 1] );
+        }
+        else if ( strcmp( argv[i], "-a" ) == 0 ) {
+            address = argv[i + 1];
+        }
+        else if ( strcmp( argv[i], "-g" ) == 0 ) {
+            games = atol( argv[i + 1] );
+        }
+        else if ( strcmp( argv[i], "-c" ) == 0 ) {
+            connections = atol( argv[i + 1] );
+        }
+        else if ( strcmp( argv[i], "-d" ) == 0 ) {
+            s.directory = argv[i + 1];
+        }
+        else {
+            goto error;
+        }
+    }
+    if ( ( socketPath == NULL && port == 0 ) || port < 0 || port > 65535 || games <= 0 ||
+         connections <= 0 || connections >= LISTENER_DATA ) {
+        goto error;
+    }
+
+    // Pools first, then the sockets clients connect to.
+    createPools( &s, games, connections );
+    s.epoll = epoll_create1( 0 );
+    if ( s.epoll < 0 ) {
+        perror( "epoll" );
+        exit( FILE_INPUT_ERR );
+    }
+    s.listener_count = 0;
+    if ( socketPath != NULL ) {
+        struct sockaddr_un local;
+        memset( &local, 0, sizeof( local ) );
+        local.sun_family = AF_UNIX;
+        if ( strlen( socketPath ) >= sizeof( local.sun_path ) ) {
+            goto error;
+        }
+        strcpy( local.sun_path, socketPath );
+        unlink( socketPath );
+        listenOn( &s, socket( AF_UNIX, SOCK_STREAM, 0 ), ( struct sockaddr * )&local,
+                  sizeof( local ) );
+    }
+    if ( port != 0 ) {
+        struct sockaddr_in remote;
+        memset( &remote, 0, sizeof( remote ) );
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons( port );
+        if ( inet_pton( AF_INET, address, &remote.sin_addr ) != 1 ) {
+            goto error;
+        }
+        listenOn( &s, socket( AF_INET, SOCK_STREAM, 0 ), ( struct sockaddr * )&remote,
+                  sizeof( remote ) );
+    }
+
+    // Writes to a client that went away fail instead of ending the program, and a signal to
+    // stop wakes the event loop.
+    struct sigaction action;
+    memset( &action, 0, sizeof( action ) );
+    action.sa_handler = SIG_IGN;
+    sigaction( SIGPIPE, &action, NULL );
+    action.sa_handler = stopServer;
+    sigaction( SIGINT, &action, NULL );
+    sigaction( SIGTERM, &action, NULL );
+
+    // Event loop.
+    struct epoll_event events[ MAX_EVENTS ];
+    while ( !stopping ) {
+        int count = epoll_wait( s.epoll, events, MAX_EVENTS, -1 );
+        for ( int i = 0; i < count; i++ ) {
+            if ( events[i].data.u64 >= LISTENER_DATA ) {
+                acceptClients( &s, s.listeners[ events[i].data.u64 - LISTENER_DATA ] );
+            }
+            else {
+                serveConnection( &s, events[i].data.u64, events[i].events );
+            }
+        }
+        flushPending( &s );
+    }
+
+    // Close every socket and free the pools.
+    for ( size_t i = 0; i < s.connection_count; i++ ) {
+        if ( s.connections[i].fd >= 0 ) {
+            closeConnection( &s, i );
+        }
+    }
+    for ( int i = 0; i < s.listener_count; i++ ) {
+        close( s.listeners[i] );
+    }
+    if ( socketPath != NULL ) {
+        unlink( socketPath );
+    }
+    close( s.epoll );
+    for ( size_t i = 0; i < s.game_count; i++ ) {
+        game_delete( s.games[i] );
+    }
+    free( s.games );
+    free( s.open );
+    free( s.free_games );
+    free( s.connections );
+    free( s.free_connections );
+    free( s.watchers );
+    free( s.updates );
+    free( s.free_updates );
+    free( s.pending );
+    return SUCCESS;
+
+    error:
+    printf( "usage: ./server [-u <socket>] [-p <port>] [-a <address>] [-g <games>]\n" );
+    printf( "       [-c <connections>] [-d <save-directory>]\n" );
+    printf( "       -u or -p is required\n" );
+    exit( ARGUMENT_ERR );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// STATIC METHODS BELOW //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+   Makes the game, connection and update pools. Every game is created for a 19x19 board and
+   grown to hold a full board of moves, so game_reset() never allocates. There are enough
+   updates for every connection to have a full queue, so broadcast() always finds one.
+   @param s is pointer to server.
+   @param games is number of games.
+   @param connections is number of connections.
+*/
+static void createPools( server* s, size_t games, size_t connections )
+{
+    s->games = ( game ** )malloc( games * sizeof( game * ) );
+    s->open = ( bool * )calloc( games, sizeof( bool ) );
+    s->free_games = ( size_t * )malloc( games * sizeof( size_t ) );
+    s->watchers = ( size_t * )malloc( games * sizeof( size_t ) );
+    s->game_count = games;
+    s->free_game_count = games;
+    for ( size_t i = 0; i < games; i++ ) {
+        s->watchers[i] = NO_CONNECTION;
+        s->games[i] = game_create( BOARD_SIZE_19, GAME_FREESTYLE );
+        game_reset( s->games[i], BOARD_SIZE_19, GAME_FREESTYLE );
+        s->games[i]->quiet = true;
+        s->free_games[i] = games - 1 - i;
+    }
+    s->connections = ( connection * )malloc( connections * sizeof( connection ) );
+    s->free_connections = ( size_t * )malloc( connections * sizeof( size_t ) );
+    s->connection_count = connections;
+    s->free_connection_count = connections;
+    for ( size_t i = 0; i < connections; i++ ) {
+        s->connections[i].fd = -1;
+        s->connections[i].pending = false;
+        s->free_connections[i] = connections - 1 - i;
+    }
+    size_t updates = connections * WATCH_QUEUE_LENGTH + 1;
+    s->updates = ( update * )malloc( updates * sizeof( update ) );
+    s->free_updates = ( update ** )malloc( updates * sizeof( update * ) );
+    s->free_update_count = updates;
+    for ( size_t i = 0; i < updates; i++ ) {
+        s->free_updates[i] = &s->updates[i];
+    }
+    s->pending = ( size_t * )malloc( connections * sizeof( size_t ) );
+    s->pending_count = 0;
+}
+
+/**
+   Binds a socket, listens on it and adds it to the event loop. Program exits with error if the
+   socket can't be set up.
+   @param s is pointer to server.
+   @param fd is socket, or -1 if it could not be created.
+   @param address is address to bind.
+   @param length is length of the address.
+*/
+static void listenOn( server* s, int fd, struct sockaddr* address, socklen_t length )
+{
+    int on = 1;
+    if ( fd >= 0 ) {
+        setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = LISTENER_DATA + s->listener_count;
+    if ( fd < 0 || bind( fd, address, length ) != 0 || listen( fd, LISTEN_BACKLOG ) != 0 ||
+         fcntl( fd, F_SETFL, O_NONBLOCK ) != 0 ||
+         epoll_ctl( s->epoll, EPOLL_CTL_ADD, fd, &event ) != 0 ) {
+        perror( "listen" );
+        exit( FILE_OUTPUT_ERR );
+    }
+    s->listeners[ s->listener_count++ ] = fd;
+}
+
+/**
+   Signal handler that ends the event loop.
+   @param signal is number of the signal.
+*/
+static void stopServer( int signal )
+{
+    stopping = 1;
+}
+
+/**
+   Accepts every waiting client, giving each a connection from the pool. Clients beyond the
+   pool are told so and disconnected.
+   @param s is pointer to server.
+   @param listener is listening socket.
+*/
+static void acceptClients( server* s, int listener )
+{
+    int fd;
+    while ( ( fd = accept( listener, NULL, NULL ) ) >= 0 ) {
+        if ( s->free_connection_count == 0 ) {
+            const char *full = "err server full\n";
+            send( fd, full, strlen( full ), MSG_NOSIGNAL | MSG_DONTWAIT );
+            close( fd );
+            continue;
+        }
+
+        // Replies go out as soon as they are ready, on TCP as well.
+        int on = 1;
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+        size_t number = s->free_connections[ --s->free_connection_count ];
+        connection *c = &s->connections[ number ];
+        c->fd = fd;
+        c->events = EPOLLIN;
+        c->discarding = false;
+        c->broken = false;
+        c->watching = NO_CONNECTION;
+        c->in_length = 0;
+        c->out_length = 0;
+        c->queue_start = 0;
+        c->queue_count = 0;
+        c->queue_sent = 0;
+        struct epoll_event event;
+        event.events = c->events;
+        event.data.u64 = number;
+        if ( fcntl( fd, F_SETFL, O_NONBLOCK ) != 0 ||
+             epoll_ctl( s->epoll, EPOLL_CTL_ADD, fd, &event ) != 0 ) {
+            closeConnection( s, number );
+        }
+    }
+}
+
+/**
+   Serves one connection that is ready: reads what arrived, runs every whole command line while
+   there is room for the replies, and sends what it can. A client that stops reading its replies
+   is not read from until they are sent, so no connection needs more than its buffers.
+   @param s is pointer to server.
+   @param number is number of the connection.
+   @param events is epoll events the connection is ready for.
+*/
+static void serveConnection( server* s, size_t number, uint32_t events )
+{
+    connection *c = &s->connections[ number ];
+    if ( events & EPOLLIN ) {
+        ssize_t count = read( c->fd, c->in + c->in_length, MAX_LINE_LENGTH - c->in_length );
+        if ( count == 0 || ( count < 0 && errno != EAGAIN && errno != EINTR ) ) {
+            closeConnection( s, number );
+            return;
+        }
+        if ( count > 0 ) {
+            c->in_length += count;
+        }
+    }
+    else if ( events & ( EPOLLERR | EPOLLHUP ) ) {
+        closeConnection( s, number );
+        return;
+    }
+    // Sending makes room for the replies to more of the waiting commands.
+    size_t waiting;
+    do {
+        waiting = c->in_length;
+        runLines( s, c );
+        if ( c->broken || !flushOutput( s, c ) ) {
+            closeConnection( s, number );
+            return;
+        }
+    } while ( c->in_length != waiting && c->in_length > 0 );
+    setEvents( s, number );
+}
+
+/**
+   Watches a connection for the events it needs: input unless the replies to the commands
+   waiting in its input have no room, and output while anything is waiting to be sent.
+   @param s is pointer to server.
+   @param number is number of the connection.
+*/
+static void setEvents( server* s, size_t number )
+{
+    connection *c = &s->connections[ number ];
+    bool paused = c->in_length == MAX_LINE_LENGTH ||
+                  OUTPUT_BUFFER_SIZE - c->out_length < MAX_REPLY_LENGTH;
+    bool sending = c->out_length > 0 || c->queue_count > 0;
+    uint32_t wanted = ( paused ? 0 : EPOLLIN ) | ( sending ? EPOLLOUT : 0 );
+    if ( wanted != c->events ) {
+        struct epoll_event event;
+        event.events = wanted;
+        event.data.u64 = number;
+        c->events = wanted;
+        epoll_ctl( s->epoll, EPOLL_CTL_MOD, c->fd, &event );
+    }
+}
+
+/**
+   Runs every whole command line in a connection's input while its output has room for a reply.
+   A line too long for the input buffer is dropped up to its newline, with one error.
+   @param s is pointer to server.
+   @param c is pointer to connection.
+*/
+static void runLines( server* s, connection* c )
+{
+    char *start = c->in;
+    size_t left = c->in_length;
+    while ( OUTPUT_BUFFER_SIZE - c->out_length >= MAX_REPLY_LENGTH ) {
+        char *end = memchr( start, '\n', left );
+        if ( end == NULL ) {
+            if ( left == MAX_LINE_LENGTH || c->discarding ) {
+                if ( !c->discarding ) {
+                    reply( c, "err line too long" );
+                }
+                c->discarding = true;
+                left = 0;
+            }
+            break;
+        }
+        *end = '\0';
+        if ( end > start && end[-1] == '\r' ) {
+            end[-1] = '\0';
+        }
+        if ( c->discarding ) {
+            c->discarding = false;
+        }
+        else {
+            runCommand( s, c, start );
+        }
+        left -= end + 1 - start;
+        start = end + 1;
+    }
+    memmove( c->in, start, left );
+    c->in_length = left;
+}
+
+/**
+   Sends as much of a connection's output as the socket takes. The rest of an update already
+   partly sent goes first, then the replies, then the queued updates, all in one send straight
+   from the shared updates. What is left of the replies is kept at the front of the buffer.
+   @param s is pointer to server.
+   @param c is pointer to connection.
+   @return is false if the connection failed, true otherwise.
+*/
+static bool flushOutput( server* s, connection* c )
+{
+    while ( c->out_length > 0 || c->queue_count > 0 ) {
+        struct iovec parts[ MAX_SEND_PARTS ];
+        int count = 0;
+        size_t queued = 0;
+        bool started = c->queue_count > 0 && c->queue_sent > 0;
+        if ( started ) {
+            update *u = c->queue[ c->queue_start ];
+            parts[ count ].iov_base = u->text + c->queue_sent;
+            parts[ count++ ].iov_len = u->length - c->queue_sent;
+            queued++;
+        }
+        if ( c->out_length > 0 ) {
+            parts[ count ].iov_base = c->out;
+            parts[ count++ ].iov_len = c->out_length;
+        }
+        size_t total = 0;
+        for ( ; queued < c->queue_count && count < MAX_SEND_PARTS; queued++ ) {
+            update *u = c->queue[ ( c->queue_start + queued ) % WATCH_QUEUE_LENGTH ];
+            parts[ count ].iov_base = u->text;
+            parts[ count++ ].iov_len = u->length;
+        }
+        for ( int i = 0; i < count; i++ ) {
+            total += parts[i].iov_len;
+        }
+        struct msghdr message;
+        memset( &message, 0, sizeof( message ) );
+        message.msg_iov = parts;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg( c->fd, &message, MSG_NOSIGNAL );
+        if ( sent < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        // Use up what was sent in the same order: started update, replies, queued updates.
+        size_t left = sent;
+        if ( started ) {
+            size_t rest = c->queue[ c->queue_start ]->length - c->queue_sent;
+            if ( left < rest ) {
+                c->queue_sent += left;
+                return true;
+            }
+            left -= rest;
+            releaseUpdate( s, c );
+        }
+        size_t taken = left < c->out_length ? left : c->out_length;
+        memmove( c->out, c->out + taken, c->out_length - taken );
+        c->out_length -= taken;
+        left -= taken;
+        while ( left > 0 ) {
+            size_t rest = c->queue[ c->queue_start ]->length - c->queue_sent;
+            if ( left < rest ) {
+                c->queue_sent += left;
+                break;
+            }
+            left -= rest;
+            releaseUpdate( s, c );
+        }
+        if ( ( size_t )sent < total ) {
+            return true;
+        }
+    }
+    return true;
+}
+
+/**
+   Closes a connection and returns it to the pool, dropping the updates it had not sent yet. Its
+   games stay open for other clients.
+   @param s is pointer to server.
+   @param number is number of the connection.
+*/
+static void closeConnection( server* s, size_t number )
+{
+    connection *c = &s->connections[ number ];
+    unwatchGame( s, number );
+    while ( c->queue_count > 0 ) {
+        releaseUpdate( s, c );
+    }
+    close( s->connections[ number ].fd );
+    s->connections[ number ].fd = -1;
+    s->free_connections[ s->free_connection_count++ ] = number;
+}
+
+/**
+   Runs one command line and adds its reply to the connection's output.
+   @param s is pointer to server.
+   @param c is pointer to connection.
+   @param line is command line, without its newline.
+*/
+static void runCommand( server* s, connection* c, char* line )
+{
+    char command[ MAX_WORD_LENGTH ];
+    char first[ MAX_WORD_LENGTH ];
+    char second[ MAX_WORD_LENGTH ];
+    char extra[ MAX_WORD_LENGTH ];
+    int words = sscanf( line, "%" WORD_FORMAT "s %" WORD_FORMAT "s %" WORD_FORMAT "s %"
+                        WORD_FORMAT "s", command, first, second, extra );
+    if ( words <= 0 ) {
+        reply( c, "err empty command" );
+        return;
+    }
+
+    // New game from the pool.
+    if ( strcmp( command, "create" ) == 0 && words == 3 ) {
+        int size = atoi( first );
+        if ( size != BOARD_SIZE_15 && size != BOARD_SIZE_17 && size != BOARD_SIZE_19 ) {
+            reply( c, "err bad board size" );
+        }
+        else if ( strcmp( second, "freestyle" ) != 0 && strcmp( second, "renju" ) != 0 ) {
+            reply( c, "err bad game type" );
+        }
+        else if ( s->free_game_count == 0 ) {
+            reply( c, "err no free games" );
+        }
+        else {
+            size_t number = s->free_games[ --s->free_game_count ];
+            game_reset( s->games[ number ], size,
+                        strcmp( second, "renju" ) == 0 ? GAME_RENJU : GAME_FREESTYLE );
+            s->open[ number ] = true;
+            reply( c, "ok %zu", number );
+        }
+        return;
+    }
+    if ( strcmp( command, "unwatch" ) == 0 && words == 1 ) {
+        unwatchGame( s, c - s->connections );
+        reply( c, "ok" );
+        return;
+    }
+
+    // Every other command names an open game.
+    size_t number;
+    game *g = words >= 2 ? findGame( s, first, &number ) : NULL;
+    if ( g == NULL ) {
+        reply( c, words >= 2 ? "err no such game" : "err bad command" );
+    }
+    else if ( strcmp( command, "move" ) == 0 && words == 3 ) {
+        unsigned char x;
+        unsigned char y;
+        if ( board_coord( g->board, second, &x, &y ) != SUCCESS ) {
+            reply( c, "err bad coordinate" );
+        }
+        else if ( g->state != GAME_STATE_PLAYING ) {
+            reply( c, "err game over" );
+        }
+        else if ( !game_place_stone( g, x, y ) ) {
+            reply( c, "err occupied" );
+        }
+        else {
+            reply( c, "ok %d %d %d", g->state, g->winner, g->stone );
+            char formal_coord[ 4 ];
+            board_formal_coord( g->board, x, y, formal_coord );
+            broadcast( s, number, "update %zu move %s %d %d %d", number, formal_coord, g->state,
+                       g->winner, g->stone );
+        }
+    }
+    else if ( strcmp( command, "resign" ) == 0 && words == 2 ) {
+        if ( g->state != GAME_STATE_PLAYING ) {
+            reply( c, "err game over" );
+        }
+        else {
+            g->winner = g->stone == BLACK_STONE ? WHITE_STONE : BLACK_STONE;
+            g->state = GAME_STATE_FINISHED;
+            reply( c, "ok %d %d %d", g->state, g->winner, g->stone );
+            broadcast( s, number, "update %zu resign %d %d %d", number, g->state, g->winner,
+                       g->stone );
+        }
+    }
+    else if ( strcmp( command, "state" ) == 0 && words == 2 ) {
+        replyState( c, g );
+    }
+    else if ( strcmp( command, "watch" ) == 0 && words == 2 ) {
+        watchGame( s, c - s->connections, number );
+        replyState( c, g );
+    }
+    else if ( strcmp( command, "save" ) == 0 && words == 3 ) {
+        saveGame( s, c, g, second );
+    }
+    else if ( strcmp( command, "close" ) == 0 && words == 2 ) {
+        broadcast( s, number, "update %zu closed", number );
+        while ( s->watchers[ number ] != NO_CONNECTION ) {
+            unwatchGame( s, s->watchers[ number ] );
+        }
+        s->open[ number ] = false;
+        s->free_games[ s->free_game_count++ ] = number;
+        reply( c, "ok" );
+    }
+    else {
+        reply( c, "err bad command" );
+    }
+}
+
+/**
+   Finds an open game by its number.
+   @param s is pointer to server.
+   @param word is number of the game as text.
+   @param number stores number of the game.
+   @return is pointer to the game, or NULL if word is not the number of an open game.
+*/
+static game* findGame( server* s, const char* word, size_t* number )
+{
+    char *end;
+    unsigned long value = strtoul( word, &end, 10 );
+    if ( end == word || *end != '\0' || value >= s->game_count || !s->open[ value ] ) {
+        return NULL;
+    }
+    *number = value;
+    return s->games[ value ];
+}
+
+/**
+   Adds a reply line to a connection's output. The caller makes sure MAX_REPLY_LENGTH bytes fit.
+   @param c is pointer to connection.
+   @param format is printf format of the reply, without the newline.
+*/
+static void reply( connection* c, const char* format, ... )
+{
+    va_list values;
+    va_start( values, format );
+    int length = vsnprintf( c->out + c->out_length, MAX_REPLY_LENGTH - 1, format, values );
+    va_end( values );
+    c->out_length += length < MAX_REPLY_LENGTH - 1 ? length : MAX_REPLY_LENGTH - 2;
+    c->out[ c->out_length++ ] = '\n';
+}
+
+/**
+   Adds the state of a game, with every move, to a connection's output.
+   @param c is pointer to connection.
+   @param g is pointer to the game.
+*/
+static void replyState( connection* c, const game* g )
+{
+    char *next = c->out + c->out_length;
+    next += sprintf( next, "ok %d %d %d %d %d %zu", g->board->size, g->type, g->state,
+                     g->winner, g->stone, g->moves_count );
+    for ( size_t i = 0; i < g->moves_count; i++ ) {
+        char formal_coord[ 4 ];
+        board_formal_coord( g->board, g->moves[i].x, g->moves[i].y, formal_coord );
+        *next++ = ' ';
+        next = stpcpy( next, formal_coord );
+    }
+    *next++ = '\n';
+    c->out_length = next - c->out;
+}
+
+/**
+   Saves a game into the save directory with game_save(), a playing game as stopped. File names
+   that could leave the directory or hide the file are refused.
+   @param s is pointer to server.
+   @param c is pointer to connection.
+   @param g is pointer to the game.
+   @param name is name of the file to save.
+*/
+static void saveGame( server* s, connection* c, game* g, const char* name )
+{
+    char path[ PATH_MAX ];
+    if ( name[0] == '.' || strchr( name, '/' ) != NULL ||
+         snprintf( path, sizeof( path ), "%s/%s", s->directory, name ) >= sizeof( path ) ) {
+        reply( c, "err bad file name" );
+        return;
+    }
+    unsigned char state = g->state;
+    if ( state == GAME_STATE_PLAYING ) {
+        g->state = GAME_STATE_STOPPED;
+    }
+    unsigned char status = game_save( g, path );
+    g->state = state;
+    reply( c, status == SUCCESS ? "ok" : "err can't save" );
+}
+
+/**
+   Makes a connection watch a game, instead of any game it watched before.
+   @param s is pointer to server.
+   @param number is number of the connection.
+   @param game is number of the game.
+*/
+static void watchGame( server* s, size_t number, size_t game )
+{
+    unwatchGame( s, number );
+    connection *c = &s->connections[ number ];
+    c->watching = game;
+    c->watch_previous = NO_CONNECTION;
+    c->watch_next = s->watchers[ game ];
+    if ( c->watch_next != NO_CONNECTION ) {
+        s->connections[ c->watch_next ].watch_previous = number;
+    }
+    s->watchers[ game ] = number;
+}
+
+/**
+   Stops a connection watching its game. Does nothing if it watches none.
+   @param s is pointer to server.
+   @param number is number of the connection.
+*/
+static void unwatchGame( server* s, size_t number )
+{
+    connection *c = &s->connections[ number ];
+    if ( c->watching == NO_CONNECTION ) {
+        return;
+    }
+    if ( c->watch_previous != NO_CONNECTION ) {
+        s->connections[ c->watch_previous ].watch_next = c->watch_next;
+    }
+    else {
+        s->watchers[ c->watching ] = c->watch_next;
+    }
+    if ( c->watch_next != NO_CONNECTION ) {
+        s->connections[ c->watch_next ].watch_previous = c->watch_previous;
+    }
+    c->watching = NO_CONNECTION;
+}
+
+/**
+   Writes an update line once and queues it for every watcher of a game, to be sent after this
+   round of events. A watcher whose queue is full is too slow to keep up, and is disconnected.
+   @param s is pointer to server.
+   @param game is number of the game.
+   @param format is printf format of the update, without the newline.
+*/
+static void broadcast( server* s, size_t game, const char* format, ... )
+{
+    if ( s->watchers[ game ] == NO_CONNECTION ) {
+        return;
+    }
+    update *u = s->free_updates[ --s->free_update_count ];
+    va_list values;
+    va_start( values, format );
+    int length = vsnprintf( u->text, UPDATE_LENGTH - 1, format, values );
+    va_end( values );
+    u->length = length < UPDATE_LENGTH - 1 ? length : UPDATE_LENGTH - 2;
+    u->text[ u->length++ ] = '\n';
+    u->references = 0;
+
+    size_t next;
+    for ( size_t number = s->watchers[ game ]; number != NO_CONNECTION; number = next ) {
+        connection *c = &s->connections[ number ];
+        next = c->watch_next;
+        if ( c->queue_count == WATCH_QUEUE_LENGTH ) {
+            c->broken = true;
+            unwatchGame( s, number );
+        }
+        else {
+            c->queue[ ( c->queue_start + c->queue_count++ ) % WATCH_QUEUE_LENGTH ] = u;
+            u->references++;
+        }
+        markPending( s, number );
+    }
+    if ( u->references == 0 ) {
+        s->free_updates[ s->free_update_count++ ] = u;
+    }
+}
+
+/**
+   Lists a connection to be flushed after this round of events, once however many updates it
+   is sent.
+   @param s is pointer to server.
+   @param number is number of the connection.
+*/
+static void markPending( server* s, size_t number )
+{
+    if ( !s->connections[ number ].pending ) {
+        s->connections[ number ].pending = true;
+        s->pending[ s->pending_count++ ] = number;
+    }
+}
+
+/**
+   Flushes every connection listed by markPending(), closing those that broke.
+   @param s is pointer to server.
+*/
+static void flushPending( server* s )
+{
+    for ( size_t i = 0; i < s->pending_count; i++ ) {
+        size_t number = s->pending[i];
+        connection *c = &s->connections[ number ];
+        c->pending = false;
+        if ( c->fd < 0 ) {
+            continue;
+        }
+        if ( c->broken || !flushOutput( s, c ) ) {
+            closeConnection( s, number );
+        }
+        else {
+            setEvents( s, number );
+        }
+    }
+    s->pending_count = 0;
+}
+
+/**
+   Takes the first update off a connection's queue, returning it to the pool once no queue holds
+   it.
+   @param s is pointer to server.
+   @param c is pointer to connection.
+*/
+static void releaseUpdate( server* s, connection* c )
+{
+    update *u = c->queue[ c->queue_start ];
+    c->queue_start = ( c->queue_start + 1 ) % WATCH_QUEUE_LENGTH;
+    c->queue_count--;
+    c->queue_sent = 0;
+    if ( --u->references == 0 ) {
+        s->free_updates[ s->free_update_count++ ] = u;
+    }
+}
@@ -0,0 +1,313 @@
+/**
+   @file validate.c
+   @author Michael Warstler (mwwarstl)
+   Contains main component for executable that audits saved games against the rules. Every game
+   of the given directories, game databases and saved game files is replayed move by move on a
+   pool of threads, and each game that breaks the rules is reported without stopping the others:
+   files that can't be read, moves on occupied intersections, moves after the game ended, and a
+   recorded state or winner (including Renju forbidden move wins) that the replay disagrees with.
+   Problems are printed one per line, "<file>: <problem>" (or "<database>:<game>: <problem>"),
+   in the order the games were given, followed by a summary line.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include "error-codes.h"
+#include "board.h"
+#include "game.h"
+#include "io.h"
+#include "gamedb.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Games a thread validates each time it takes more work */
+#define GAMES_PER_TASK 64
+/** Longest problem description */
+#define MAX_PROBLEM_LENGTH 128
+/** Initial number of sources, files and problems allocated */
+#define INITIAL_CAPACITY 64
+
+/**
+   Games to validate from one command line argument or directory entry. Fields are described as
+   follows:
+   path - path of the saved game or database.
+   db - open database, NULL for a saved game file.
+   first - number of the source's first game among all games.
+*/
+typedef struct {
+    char* path;
+    gamedb* db;
+    size_t first;
+} source;
+
+/**
+   A game that broke the rules. Fields are described as follows:
+   number - number of the game among all games.
+   text - description of the problem.
+*/
+typedef struct {
+    size_t number;
+    char text[ MAX_PROBLEM_LENGTH ];
+} problem;
+
+/**
+   Work and results shared by all threads. Fields are described as follows:
+   sources - every saved game file and database, in the order given.
+   source_count - number of sources.
+   games - number of games in all sources.
+   next - number of the next game a thread should take.
+   problems - problems found so far, in no particular order.
+   problem_count - number of problems.
+   problem_capacity - number of problems that fit in problems.
+   lock - guards problems.
+*/
+typedef struct {
+    source* sources;
+    size_t source_count;
+    size_t games;
+    size_t next;
+    problem* problems;
+    size_t problem_count;
+    size_t problem_capacity;
+    pthread_mutex_t lock;
+} audit;
+
+// Prototypes for static functions that find and check the games.
+static void addSource( audit* a, size_t* capacity, char* path );
+static void addDirectory( audit* a, size_t* capacity, const char* path );
+static void* validateWorker( void* arg );
+static int comparePaths( const void* a, const void* b );
+static int compareProblems( const void* a, const void* b );
+
+/**
+   Validates every game named on the command line. Arguments are directories (every saved game
+   in them is checked), game databases and saved game files. An optional "-j" followed by the
+   number of threads comes first.
+   @param argc are # of command line arguments.
+   @param **argv is array of character pointers listing all arguments.
+   @return is exit status: SUCCESS if every game is valid, otherwise FILE_INPUT_ERR.
+*/
+int main(int argc, char **argv)
+{
+    int threads = ( int )sysconf( _SC_NPROCESSORS_ONLN );
+    int first = 1;
+    if ( first < argc - 1 && strcmp( argv[ first ], "-j" ) == 0 ) {
+        threads = atoi( argv[ first + 1 ] );
+        first += 2;
+    }
+    if ( first >= argc || threads <= 0 ) {
+        printf( "usage: ./validate [-j <threads>] <directory|database|saved-match.gmk>...\n" );
+        exit( ARGUMENT_ERR );
+    }
+
+    // Collect the sources, numbering their games one after another.
+    audit a;
+    memset( &a, 0, sizeof( audit ) );
+    size_t capacity = INITIAL_CAPACITY;
+    a.sources = ( source * )malloc( capacity * sizeof( source ) );
+    for ( int i = first; i < argc; i++ ) {
+        struct stat info;
+        if ( stat( argv[i], &info ) == 0 && S_ISDIR( info.st_mode ) ) {
+            addDirectory( &a, &capacity, argv[i] );
+        }
+        else {
+            addSource( &a, &capacity, strdup( argv[i] ) );
+        }
+    }
+    a.problem_capacity = INITIAL_CAPACITY;
+    a.problems = ( problem * )malloc( a.problem_capacity * sizeof( problem ) );
+    pthread_mutex_init( &a.lock, NULL );
+
+    // Validate on every thread.
+    pthread_t *workers = ( pthread_t * )malloc( threads * sizeof( pthread_t ) );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_create( &workers[i], NULL, validateWorker, &a );
+    }
+    validateWorker( &a );
+    for ( int i = 1; i < threads; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+    free( workers );
+
+    // Report problems in the order the games were given. Sources are numbered in order, so the
+    // last one starting at or before a game holds it.
+    qsort( a.problems, a.problem_count, sizeof( problem ), compareProblems );
+    size_t current = 0;
+    for ( size_t i = 0; i < a.problem_count; i++ ) {
+        while ( current + 1 < a.source_count && a.sources[ current + 1 ].first <=
+                a.problems[i].number ) {
+            current++;
+        }
+        source *s = &a.sources[ current ];
+        if ( s->db != NULL ) {
+            printf( "%s:%zu: %s\n", s->path, a.problems[i].number - s->first, a.problems[i].text );
+        }
+        else {
+            printf( "%s: %s\n", s->path, a.problems[i].text );
+        }
+    }
+    printf( "games %zu: valid %zu, invalid %zu\n", a.games, a.games - a.problem_count,
+            a.problem_count );
+
+    int status = a.problem_count == 0 ? SUCCESS : FILE_INPUT_ERR;
+    for ( size_t i = 0; i < a.source_count; i++ ) {
+        if ( a.sources[i].db != NULL ) {
+            gamedb_close( a.sources[i].db );
+        }
+        free( a.sources[i].path );
+    }
+    free( a.sources );
+    free( a.problems );
+    pthread_mutex_destroy( &a.lock );
+    return status;
+}
+
+/**
+   Adds a saved game file or database to the sources. A path that opens as a database is one,
+   anything else is treated as a saved game file.
+   @param a is pointer to audit.
+   @param capacity is number of sources that fit in a->sources, updated when it grows.
+   @param path is allocated path of the source, freed with the source.
+*/
+static void addSource( audit* a, size_t* capacity, char* path )
+{
+    // Double size of sources array if needed.
+    if ( a->source_count >= *capacity ) {
+        *capacity *= 2;
+        a->sources = ( source * )realloc( a->sources, *capacity * sizeof( source ) );
+    }
+    source *s = &a->sources[ a->source_count++ ];
+    s->path = path;
+    s->db = gamedb_open( path );
+    s->first = a->games;
+    a->games += s->db != NULL ? s->db->count : 1;
+}
+
+/**
+   Adds every saved game in a directory to the sources, sorted by name.
+   @param a is pointer to audit.
+   @param capacity is number of sources that fit in a->sources, updated when it grows.
+   @param path is path of the directory.
+*/
+static void addDirectory( audit* a, size_t* capacity, const char* path )
+{
+    DIR *directory = opendir( path );
+    if ( directory == NULL ) {
+        exit( FILE_INPUT_ERR );
+    }
+    size_t count = 0;
+    size_t names = INITIAL_CAPACITY;
+    char **files = ( char ** )malloc( names * sizeof( char * ) );
+    struct dirent *file;
+    while ( ( file = readdir( directory ) ) != NULL ) {
+        if ( !game_has_extension( file->d_name, GAME_EXTENSION ) &&
+             !game_has_extension( file->d_name, GAME_BINARY_EXTENSION ) ) {
+            continue;
+        }
+        if ( count >= names ) {
+            names *= 2;
+            files = ( char ** )realloc( files, names * sizeof( char * ) );
+        }
+        files[ count ] = ( char * )malloc( strlen( path ) + strlen( file->d_name ) + 2 );
+        sprintf( files[ count++ ], "%s/%s", path, file->d_name );
+    }
+    closedir( directory );
+
+    qsort( files, count, sizeof( char * ), comparePaths );
+    for ( size_t i = 0; i < count; i++ ) {
+        addSource( a, capacity, files[i] );
+    }
+    free( files );
+}
+
+/**
+   Thread entry point. Takes games a few at a time, loads each without rule checks and then
+   replays it with them, recording any problem.
+   @param arg is pointer to shared audit.
+   @return is always NULL.
+*/
+static void* validateWorker( void* arg )
+{
+    audit *a = ( audit * )arg;
+    size_t first;
+    while ( ( first = __atomic_fetch_add( &a->next, GAMES_PER_TASK, __ATOMIC_RELAXED ) ) <
+            a->games ) {
+        size_t last = first + GAMES_PER_TASK < a->games ? first + GAMES_PER_TASK : a->games;
+
+        // Find the source of the first game, then walk forward with the games.
+        size_t low = 0;
+        size_t high = a->source_count;
+        while ( high - low > 1 ) {
+            size_t middle = low + ( high - low ) / 2;
+            if ( a->sources[ middle ].first <= first ) {
+                low = middle;
+            }
+            else {
+                high = middle;
+            }
+        }
+        for ( size_t number = first; number < last; number++ ) {
+            while ( low + 1 < a->source_count && a->sources[ low + 1 ].first <= number ) {
+                low++;
+            }
+            source *s = &a->sources[ low ];
+            unsigned char status;
+            game *g = s->db != NULL ? gamedb_game( s->db, number - s->first, &status ) :
+                                      game_load( s->path, true, &status );
+
+            char text[ MAX_PROBLEM_LENGTH ];
+            bool valid = false;
+            if ( g == NULL ) {
+                snprintf( text, sizeof( text ), status == COORDINATE_ERR ?
+                          "a move is on an occupied intersection" : "not a saved game" );
+            }
+            else {
+                valid = game_verify( g, text, sizeof( text ) );
+                game_delete( g );
+            }
+            if ( valid ) {
+                continue;
+            }
+
+            // Double size of problems array if needed.
+            pthread_mutex_lock( &a->lock );
+            if ( a->problem_count >= a->problem_capacity ) {
+                a->problem_capacity *= 2;
+                a->problems = ( problem * )realloc( a->problems,
+                                                    a->problem_capacity * sizeof( problem ) );
+            }
+            a->problems[ a->problem_count ].number = number;
+            strcpy( a->problems[ a->problem_count++ ].text, text );
+            pthread_mutex_unlock( &a->lock );
+        }
+    }
+    return NULL;
+}
+
+/**
+   Orders paths alphabetically.
+   @param a is pointer to first path.
+   @param b is pointer to second path.
+   @return is negative, zero or positive like strcmp.
+*/
+static int comparePaths( const void* a, const void* b )
+{
+    return strcmp( *( char * const * )a, *( char * const * )b );
+}
+
+/**
+   Orders problems by game number.
+   @param a is pointer to first problem.
+   @param b is pointer to second problem.
+   @return is negative, zero or positive like strcmp.
+*/
+static int compareProblems( const void* a, const void* b )
+{
+    size_t first = ( ( const problem * )a )->number;
+    size_t second = ( ( const problem * )b )->number;
+    return first < second ? -1 : first > second;
+}